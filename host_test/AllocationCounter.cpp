@@ -0,0 +1,67 @@
+#include "AllocationCounter.hpp"
+
+#include <stdlib.h>
+
+#include <atomic>
+#include <new>
+
+namespace
+{
+    thread_local bool t_armed = false;
+    std::atomic<uint64_t> g_allocations{0};
+
+    void* allocate(size_t _size)
+    {
+        if (t_armed)
+            g_allocations.fetch_add(1, std::memory_order_relaxed);
+
+        void* ptr = malloc(_size > 0 ? _size : 1);
+        if (ptr == nullptr)
+            throw std::bad_alloc();
+        return ptr;
+    }
+} // namespace
+
+void* operator new(size_t _size)
+{
+    return allocate(_size);
+}
+
+void* operator new[](size_t _size)
+{
+    return allocate(_size);
+}
+
+void operator delete(void* _ptr) noexcept
+{
+    free(_ptr);
+}
+
+void operator delete[](void* _ptr) noexcept
+{
+    free(_ptr);
+}
+
+void operator delete(void* _ptr, size_t) noexcept
+{
+    free(_ptr);
+}
+
+void operator delete[](void* _ptr, size_t) noexcept
+{
+    free(_ptr);
+}
+
+namespace tr::test
+{
+    void armCurrentThread(bool _armed)
+    {
+        t_armed = _armed;
+    }
+
+    uint64_t getAllocationCount()
+    {
+        return g_allocations.load(std::memory_order_relaxed);
+    }
+
+} // namespace tr::test
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace tr::test
+{
+    // Counts the operator new calls of the armed threads, the host twin of tr::heap_guard.
+    // Linking AllocationCounter.cpp replaces the global operator new and delete.
+
+    void armCurrentThread(bool _armed);
+    uint64_t getAllocationCount();
+
+} // namespace tr::test
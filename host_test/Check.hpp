@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdio.h>
+
+namespace tr::test
+{
+    // Minimal checks for the host tests: a failed check is printed and the test fails at the end
+
+    inline int& getFailures()
+    {
+        static int failures = 0;
+        return failures;
+    }
+
+    // The exit code of the test
+    inline int finish()
+    {
+        if (getFailures() > 0)
+            printf("%d checks failed\n", getFailures());
+        return getFailures() > 0 ? 1 : 0;
+    }
+
+} // namespace tr::test
+
+#define TR_CHECK(_condition)                                                                \
+    do                                                                                      \
+    {                                                                                       \
+        if (!(_condition))                                                                  \
+        {                                                                                   \
+            ::tr::test::getFailures()++;                                                    \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #_condition);           \
+        }                                                                                   \
+    } while (0)
@@ -0,0 +1,198 @@
+// The deadline tracker: the buckets and the stall detection on a virtual clock, then stalls
+// injected into a worker thread watched by a monitor thread on the steady clock, as the Main
+// task and the monitor task run on the device
+
+#include "Check.hpp"
+
+#include "tram_run/Deadline.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace
+{
+    using namespace tr::deadline;
+
+    void testBuckets()
+    {
+        TR_CHECK(getBucket(0, 100) == 0);
+        TR_CHECK(getBucket(25, 100) == 0 && getBucket(26, 100) == 1);
+        TR_CHECK(getBucket(50, 100) == 1 && getBucket(51, 100) == 2);
+        TR_CHECK(getBucket(200, 100) == 3 && getBucket(201, 100) == 4);
+        TR_CHECK(getBucket(1600, 100) == 6 && getBucket(1601, 100) == BucketCount - 1);
+        TR_CHECK(getBucket(UINT32_MAX, 100) == BucketCount - 1);
+
+        Tracker tracker;
+        TR_CHECK(!tracker.record(0, 1000));     // Not configured yet
+        tracker.configure(0, "path", 100);
+        TR_CHECK(!tracker.record(0, 10));
+        TR_CHECK(!tracker.record(0, 100));
+        TR_CHECK(tracker.record(0, 101));
+        TR_CHECK(tracker.record(0, 5000));
+
+        const Stats stats = tracker.getStats(0);
+        TR_CHECK(stats.count == 4 && stats.misses == 2 && stats.maxUs == 5000);
+        TR_CHECK(stats.buckets[0] == 1 && stats.buckets[2] == 1 && stats.buckets[3] == 1 && stats.buckets[7] == 1);
+    }
+
+    void testVirtualClock()
+    {
+        Tracker tracker;
+        tracker.configure(1, "task", 1000);
+
+        // A channel not configured is never polled
+        tracker.begin(2, 0);
+        TR_CHECK(tracker.poll(1000000, 4).stalled == 0);
+
+        // An end without a begin records nothing
+        TR_CHECK(!tracker.end(1, 500));
+        TR_CHECK(tracker.getStats(1).count == 0);
+
+        // Busy within the budget
+        tracker.begin(1, 10000);
+        TR_CHECK(tracker.getBusyUs(1, 10600) == 600);
+        TR_CHECK(tracker.poll(11000, 4).stalled == 0);
+        TR_CHECK(!tracker.end(1, 11000));
+        TR_CHECK(tracker.getBusyUs(1, 20000) == 0);
+
+        // Stuck: stalled past the budget, reported new once, starving past the hard limit
+        tracker.begin(1, 20000);
+        Poll poll = tracker.poll(21001, 4);
+        TR_CHECK(poll.stalled == 2 && poll.newlyStalled == 2 && poll.starving == 0);
+        poll = tracker.poll(24000, 4);
+        TR_CHECK(poll.stalled == 2 && poll.newlyStalled == 0 && poll.starving == 0);
+        poll = tracker.poll(24001, 4);
+        TR_CHECK(poll.stalled == 2 && poll.newlyStalled == 0 && poll.starving == 2);
+        TR_CHECK(tracker.end(1, 30000));
+        TR_CHECK(tracker.poll(30001, 4).stalled == 0);
+        TR_CHECK(tracker.getStats(1).maxUs == 10000);
+
+        // Across the wraparound of the microsecond clock
+        tracker.begin(1, UINT32_MAX - 100);
+        TR_CHECK(tracker.poll(500, 4).stalled == 0);
+        poll = tracker.poll(1000, 4);
+        TR_CHECK(poll.stalled == 2 && poll.newlyStalled == 2);
+        TR_CHECK(tracker.end(1, 1000));
+        TR_CHECK(tracker.getStats(1).count == 3 && tracker.getStats(1).misses == 2);
+    }
+
+    enum Phase : int
+    {
+        Normal,
+        Stall,          // Over the budget
+        LongStall,      // Over the hard limit
+        ExcludedWait,   // A long wait kept out of the span, as App::flushPersist() does
+        Done,
+    };
+
+    uint32_t getNowUs()
+    {
+        using namespace std::chrono;
+        return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+    }
+
+    void sleepMs(uint32_t _ms)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(_ms));
+    }
+
+    void testInjectedStalls()
+    {
+        // Wide enough for the sleep jitter of a loaded machine
+        constexpr uint32_t BudgetMs = 50;
+        constexpr uint32_t HardFactor = 5;
+        constexpr uint8_t Channel = 0;
+
+        Tracker tracker;
+        tracker.configure(Channel, "Main", BudgetMs * 1000);
+        std::atomic<int> phase{Normal};
+
+        std::thread worker([&]() {
+            auto run = [&](Phase _phase, uint32_t _spans, uint32_t _workMs) {
+                phase.store(_phase);
+                for (uint32_t i = 0; i < _spans; ++i)
+                {
+                    tracker.begin(Channel, getNowUs());
+                    sleepMs(_workMs);
+                    tracker.end(Channel, getNowUs());
+                    sleepMs(1);
+                }
+                phase.store(Normal);
+            };
+
+            run(Normal, 50, 1);
+            run(Stall, 1, BudgetMs * 3);
+            run(Normal, 20, 1);
+            run(LongStall, 1, BudgetMs * HardFactor * 2);
+            run(Normal, 20, 1);
+
+            phase.store(ExcludedWait);
+            for (int i = 0; i < 3; ++i)
+            {
+                tracker.begin(Channel, getNowUs());
+                sleepMs(1);
+                tracker.end(Channel, getNowUs());
+                sleepMs(BudgetMs * 4);
+                tracker.begin(Channel, getNowUs());
+                sleepMs(1);
+                tracker.end(Channel, getNowUs());
+            }
+            phase.store(Done);
+        });
+
+        uint32_t polls = 0;
+        uint32_t newlyStalled = 0;
+        uint32_t starving = 0;
+        uint32_t unexpected = 0;
+        bool stallSeen = false;
+        bool longStallSeen = false;
+        while (phase.load() != Done)
+        {
+            const int before = phase.load();
+            const Poll poll = tracker.poll(getNowUs(), HardFactor);
+            const int after = phase.load();
+            polls++;
+
+            // Seen while the stall is still going on, and only then
+            const bool inStall = before == Stall || after == Stall;
+            const bool inLongStall = before == LongStall || after == LongStall;
+            if (poll.stalled)
+            {
+                stallSeen |= inStall;
+                longStallSeen |= inLongStall;
+                unexpected += !inStall && !inLongStall;
+            }
+            if (poll.newlyStalled)
+                newlyStalled++;
+            if (poll.starving)
+            {
+                starving++;
+                unexpected += !inLongStall;
+            }
+            sleepMs(2);
+        }
+        worker.join();
+
+        const Stats stats = tracker.getStats(Channel);
+        printf("%u polls, %u spans, %u misses, %u us max\n", (unsigned)polls, (unsigned)stats.count,
+            (unsigned)stats.misses, (unsigned)stats.maxUs);
+
+        TR_CHECK(stallSeen && longStallSeen);
+        TR_CHECK(newlyStalled == 2);
+        TR_CHECK(starving > 0);
+        TR_CHECK(unexpected == 0);
+        TR_CHECK(stats.count == 50 + 1 + 20 + 1 + 20 + 6);
+        TR_CHECK(stats.misses == 2);
+        TR_CHECK(stats.maxUs >= BudgetMs * HardFactor * 2 * 1000);
+    }
+} // namespace
+
+int main()
+{
+    testBuckets();
+    testVirtualClock();
+    testInjectedStalls();
+
+    return tr::test::finish();
+}
@@ -0,0 +1,169 @@
+// The feed record parser, and the incremental top K of the aggregator checked against
+// a full recomputation after every random update and expiry
+
+#include "Check.hpp"
+
+#include "tram_run/Departures.hpp"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace
+{
+    using namespace tr::departures;
+
+    Departure make(uint32_t _vehicleId, uint32_t _time, const char* _line = "17")
+    {
+        Departure departure;
+        departure.vehicleId = _vehicleId;
+        departure.time = _time;
+        memcpy(departure.line, _line, strlen(_line));
+        return departure;
+    }
+
+    void testParse()
+    {
+        Departure departure;
+        departure.source = 2;
+        TR_CHECK(parse("123,17,1700000000\r", departure));
+        TR_CHECK(departure.vehicleId == 123 && departure.time == 1700000000);
+        TR_CHECK(departure.getLine() == "17" && departure.source == 2);
+
+        TR_CHECK(parse("1,N17A,4294967295", departure) && departure.time == UINT32_MAX);
+        TR_CHECK(!parse("1,17,4294967296", departure));
+        TR_CHECK(!parse("1,1234567,100", departure));
+        TR_CHECK(!parse("1,,100", departure));
+        TR_CHECK(!parse("1,17", departure));
+        TR_CHECK(!parse("x,17,100", departure));
+        TR_CHECK(!parse("", departure));
+    }
+
+    void testAggregator()
+    {
+        Aggregator aggregator(2);
+
+        const Departure first[] = {make(1, 300), make(2, 100)};
+        TR_CHECK(aggregator.update(0, first, 2, 0));
+        TR_CHECK(aggregator.getBoard().count == 2);
+        TR_CHECK(aggregator.getBoard().items[0].vehicleId == 2);
+
+        // Later than the visible ones, nothing changes
+        const Departure late[] = {make(3, 500)};
+        TR_CHECK(!aggregator.update(1, late, 1, 0));
+
+        // The same vehicle seen sooner from another stop replaces itself
+        const Departure sooner[] = {make(1, 50), make(3, 500)};
+        TR_CHECK(aggregator.update(1, sooner, 2, 0));
+        TR_CHECK(aggregator.getBoard().items[0].vehicleId == 1 && aggregator.getBoard().items[0].source == 1);
+        TR_CHECK(aggregator.getBoard().items[1].vehicleId == 2);
+
+        // Stop 1 loses the vehicle, stop 0 still sees it later
+        TR_CHECK(aggregator.update(1, late, 1, 0));
+        TR_CHECK(aggregator.getBoard().items[0].vehicleId == 2);
+        TR_CHECK(aggregator.getBoard().items[1].vehicleId == 1 && aggregator.getBoard().items[1].time == 300);
+
+        // A past departure leaves the board and the next one moves up
+        TR_CHECK(!aggregator.expire(100));
+        TR_CHECK(aggregator.expire(101));
+        TR_CHECK(aggregator.getBoard().items[0].vehicleId == 1);
+        TR_CHECK(aggregator.getBoard().items[1].vehicleId == 3);
+    }
+
+    Board recompute(const std::vector<std::vector<Departure>>& _sources, uint8_t _visible, uint32_t _now)
+    {
+        std::vector<Departure> all;
+        for (const auto& source : _sources)
+        {
+            for (const Departure& departure : source)
+            {
+                if (departure.time < _now)
+                    continue;
+                auto same = std::find_if(all.begin(), all.end(),
+                    [&](const Departure& _other) { return _other.vehicleId == departure.vehicleId; });
+                if (same == all.end())
+                    all.push_back(departure);
+                else if (departure.time < same->time)
+                    *same = departure;
+            }
+        }
+        std::sort(all.begin(), all.end(), [](const Departure& _a, const Departure& _b) {
+            return _a.time < _b.time || (_a.time == _b.time && _a.vehicleId < _b.vehicleId);
+        });
+
+        Board board;
+        board.count = std::min<size_t>(all.size(), _visible);
+        std::copy(all.begin(), all.begin() + board.count, board.items);
+        return board;
+    }
+
+    bool isUsed(const std::vector<std::vector<Departure>>& _sources, uint32_t _time)
+    {
+        for (const auto& source : _sources)
+        {
+            for (const Departure& departure : source)
+            {
+                if (departure.time == _time)
+                    return true;
+            }
+        }
+        return false;
+    }
+
+    void testAgainstRecompute()
+    {
+        std::mt19937 random(4242);
+        for (uint8_t visible = 1; visible <= MaxVisible; ++visible)
+        {
+            Aggregator aggregator(visible);
+            std::vector<std::vector<Departure>> sources(MaxSources);
+            uint32_t now = 1000;
+            unsigned changes = 0;
+
+            for (unsigned round = 0; round < 20000; ++round)
+            {
+                const Board before = aggregator.getBoard();
+                bool changed = false;
+                if (random() % 4 > 0)
+                {
+                    const uint8_t source = random() % MaxSources;
+                    const uint8_t count = random() % (MaxPerSource + 1);
+                    Departure list[MaxPerSource];
+                    sources[source].clear();
+                    for (uint8_t i = 0; i < count; ++i)
+                    {
+                        // Few vehicles, so the same one shows up from several stops.
+                        // Distinct times, ties would make the visible set ambiguous.
+                        uint32_t time = 0;
+                        do
+                            time = now + random() % 10000;
+                        while (isUsed(sources, time) || std::any_of(list, list + i, [time](const Departure& _other) { return _other.time == time; }));
+                        list[i] = make(random() % 12, time);
+                        list[i].source = source;
+                        sources[source].push_back(list[i]);
+                    }
+                    changed = aggregator.update(source, list, count, now);
+                }
+                else
+                {
+                    now += random() % 120;
+                    changed = aggregator.expire(now);
+                }
+
+                const Board expected = recompute(sources, visible, now);
+                TR_CHECK(aggregator.getBoard() == expected);
+                TR_CHECK(changed == !(before == aggregator.getBoard()));
+                changes += changed;
+            }
+            TR_CHECK(changes > 1000);
+        }
+    }
+} // namespace
+
+int main()
+{
+    testParse();
+    testAggregator();
+    testAgainstRecompute();
+    return tr::test::finish();
+}
@@ -0,0 +1,148 @@
+// The dial table against the exact piecewise linear curve of its calibration: the error of a
+// lookup stays within half a step of the steepest segment, plus the rounding of the ticks
+
+#include "Check.hpp"
+
+#include "tram_run/Dial.hpp"
+
+#include <math.h>
+#include <random>
+
+namespace
+{
+    using namespace tr::dial;
+
+    // The curve the table samples, in ticks, for any second
+    double exact(const Calibration& _calibration, double _seconds)
+    {
+        const uint8_t last = _calibration.count - 1;
+        if (_seconds <= _calibration.minutes[0] * 60.0)
+            return _calibration.ticks[0];
+        if (_seconds >= _calibration.minutes[last] * 60.0)
+            return _calibration.ticks[last];
+
+        uint8_t segment = 0;
+        while (_calibration.minutes[segment + 1] * 60.0 <= _seconds)
+            ++segment;
+        const double from = _calibration.minutes[segment] * 60.0;
+        const double span = _calibration.minutes[segment + 1] * 60.0 - from;
+        const double rise = _calibration.ticks[segment + 1] - _calibration.ticks[segment];
+        return _calibration.ticks[segment] + rise * (_seconds - from) / span;
+    }
+
+    double getMaxSlope(const Calibration& _calibration)
+    {
+        double slope = 0;
+        for (uint8_t i = 1; i < _calibration.count; ++i)
+        {
+            const double segment = double(_calibration.ticks[i] - _calibration.ticks[i - 1])
+                / ((_calibration.minutes[i] - _calibration.minutes[i - 1]) * 60.0);
+            slope = segment > slope ? segment : slope;
+        }
+        return slope;
+    }
+
+    // Returns the largest error over every second of the hour and past it
+    double checkTable(const Calibration& _calibration)
+    {
+        Table table;
+        table.build(_calibration);
+
+        // A lookup is at most half a step away from the sampled second. The bound is reached
+        // exactly half way between two entries, hence the margin for the doubles.
+        const double bound = getMaxSlope(_calibration) * StepSeconds / 2 + 0.5 + 1e-9;
+        double maxError = 0;
+        uint16_t previous = 0;
+        for (uint32_t seconds = 0; seconds <= MaxSeconds + 10 * StepSeconds; ++seconds)
+        {
+            const uint16_t ticks = table.lookup(seconds);
+            const double error = fabs(ticks - exact(_calibration, seconds));
+            maxError = error > maxError ? error : maxError;
+
+            TR_CHECK(error <= bound);
+            // The table entries themselves are only rounded
+            if (seconds % StepSeconds == 0)
+                TR_CHECK(error <= 0.5);
+            TR_CHECK(ticks >= previous);
+            previous = ticks;
+        }
+
+        // Clamped to the last point after it, whatever the countdown
+        TR_CHECK(table.lookup(UINT32_MAX - StepSeconds) == _calibration.ticks[_calibration.count - 1]);
+        return maxError;
+    }
+
+    Calibration randomCalibration(std::mt19937& _random)
+    {
+        Calibration calibration;
+        // Within the hour of the table and the servo range
+        calibration.count = 2 + _random() % (MaxPoints - 1);
+        uint8_t minute = _random() % 3;
+        uint16_t ticks = tr::servo::MinCompareTicks + _random() % 200;
+        for (uint8_t i = 0; i < calibration.count; ++i)
+        {
+            calibration.minutes[i] = minute;
+            calibration.ticks[i] = ticks;
+            minute += 1 + _random() % 5;
+            ticks += _random() % 150;
+        }
+        return calibration;
+    }
+
+    void testValid()
+    {
+        TR_CHECK(isValid(DefaultCalibration));
+
+        Calibration calibration = DefaultCalibration;
+        calibration.version++;
+        TR_CHECK(!isValid(calibration));
+
+        calibration = DefaultCalibration;
+        calibration.count = 1;
+        TR_CHECK(!isValid(calibration));
+        calibration.count = MaxPoints + 1;
+        TR_CHECK(!isValid(calibration));
+
+        calibration = DefaultCalibration;
+        calibration.minutes[4] = calibration.minutes[3];
+        TR_CHECK(!isValid(calibration));
+
+        calibration = DefaultCalibration;
+        calibration.ticks[4] = calibration.ticks[3] - 1;
+        TR_CHECK(!isValid(calibration));
+
+        calibration = DefaultCalibration;
+        calibration.ticks[11] = tr::servo::MaxCompareTicks + 1;
+        TR_CHECK(!isValid(calibration));
+    }
+} // namespace
+
+int main()
+{
+    testValid();
+
+    // 304 ticks over the first minute: 25.3 ticks away from the curve at most, plus the rounding
+    const double defaultError = checkTable(DefaultCalibration);
+    printf("Default calibration: %.2f ticks at most\n", defaultError);
+    TR_CHECK(defaultError <= 304.0 / 60 * StepSeconds / 2 + 0.5);
+
+    // Before the first point the table holds the first ticks
+    Calibration late = DefaultCalibration;
+    late.minutes[0] = 2;
+    late.minutes[1] = 3;
+    late.ticks[1] = late.ticks[0];
+    late.count = 2;
+    Table table;
+    table.build(late);
+    TR_CHECK(table.lookup(0) == late.ticks[0] && table.lookup(2 * 60) == late.ticks[0]);
+
+    std::mt19937 random(40);
+    for (unsigned iteration = 0; iteration < 200; ++iteration)
+    {
+        const Calibration calibration = randomCalibration(random);
+        TR_CHECK(isValid(calibration));
+        checkTable(calibration);
+    }
+
+    return tr::test::finish();
+}
@@ -0,0 +1,352 @@
+// Three units running the election and the codec over real UDP sockets on 127.0.0.1, the way
+// FanOut.cpp runs them on the LAN, with the multicast replaced by a send to every other unit.
+// A sniffer gets every datagram too, to replay them. The clock is virtual, the packets are not:
+// the lowest unit wins the election, the replays are dropped, a silent fetcher is taken over.
+
+#include "Check.hpp"
+
+#include "tram_run/FanOutProtocol.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <vector>
+
+namespace
+{
+    using namespace tr::fanout;
+    using tr::departures::Board;
+
+    constexpr uint32_t StepMs = 100;
+    constexpr uint32_t ReceiveTimeoutMs = 1000;
+
+    Config makeConfig()
+    {
+        Config config;
+        config.announceMs = 1000;
+        config.takeoverMs = 3000;
+        // Every unit takes over at once, so the lower ones also win by a yield
+        config.staggerMs = 0;
+        return config;
+    }
+
+    struct Endpoint
+    {
+        int fd = -1;
+        uint16_t port = 0;
+        uint32_t pending = 0;   // Datagrams sent to it and not received yet
+    };
+
+    Endpoint openEndpoint()
+    {
+        Endpoint endpoint;
+        endpoint.fd = socket(AF_INET, SOCK_DGRAM, 0);
+        TR_CHECK(endpoint.fd >= 0);
+
+        sockaddr_in local = {};
+        local.sin_family = AF_INET;
+        local.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t size = sizeof(local);
+        TR_CHECK(bind(endpoint.fd, reinterpret_cast<sockaddr*>(&local), sizeof(local)) == 0);
+        TR_CHECK(getsockname(endpoint.fd, reinterpret_cast<sockaddr*>(&local), &size) == 0);
+        endpoint.port = ntohs(local.sin_port);
+        return endpoint;
+    }
+
+    void sendTo(const Endpoint& _from, Endpoint& _to, const uint8_t* _data, size_t _size)
+    {
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(_to.port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        TR_CHECK(sendto(_from.fd, _data, _size, 0, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == ssize_t(_size));
+        _to.pending++;
+    }
+
+    // Every datagram sent to _endpoint so far, in order
+    std::vector<std::vector<uint8_t>> receiveAll(Endpoint& _endpoint)
+    {
+        std::vector<std::vector<uint8_t>> datagrams;
+        while (_endpoint.pending > 0)
+        {
+            pollfd ready = {_endpoint.fd, POLLIN, 0};
+            if (poll(&ready, 1, ReceiveTimeoutMs) != 1)
+            {
+                TR_CHECK(!"datagram lost on the loopback");
+                _endpoint.pending = 0;
+                break;
+            }
+
+            uint8_t message[MaxMessageSize + 1];
+            const ssize_t size = recv(_endpoint.fd, message, sizeof(message), 0);
+            TR_CHECK(size > 0);
+            datagrams.emplace_back(message, message + (size > 0 ? size : 0));
+            _endpoint.pending--;
+        }
+        return datagrams;
+    }
+
+    // What the fetcher would read from its fetcher::readBoard(), changing every 2 s
+    Board makeFetchedBoard(uint32_t _unitId, uint32_t _nowMs)
+    {
+        Board board;
+        board.count = 1;
+        board.items[0].time = 1700000000 + _nowMs / 2000 * 60;
+        board.items[0].vehicleId = _unitId;
+        board.items[0].line[0] = '7';
+        return board;
+    }
+
+    struct Unit
+    {
+        uint32_t id;
+        uint32_t epoch;
+        Endpoint endpoint;
+        Election election{0, 0, {}};
+        bool running = false;
+
+        Board sent;
+        uint32_t sentMs = 0;
+        Board shown;            // What fetcher::publishRemote() got last
+        uint32_t shownFrom = 0;
+    };
+
+    struct Lan
+    {
+        std::vector<Unit> units;
+        Endpoint sniffer;
+        std::vector<std::vector<uint8_t>> captured;
+        uint32_t nowMs = 0;
+
+        Lan()
+        {
+            for (uint32_t id : {10u, 20u, 30u})
+            {
+                Unit unit;
+                unit.id = id;
+                unit.epoch = 0;
+                unit.endpoint = openEndpoint();
+                units.push_back(unit);
+            }
+            sniffer = openEndpoint();
+        }
+
+        ~Lan()
+        {
+            for (Unit& unit : units)
+                close(unit.endpoint.fd);
+            close(sniffer.fd);
+        }
+
+        Unit& get(uint32_t _id)
+        {
+            for (Unit& unit : units)
+            {
+                if (unit.id == _id)
+                    return unit;
+            }
+            return units.front();
+        }
+
+        // A boot with the next epoch, the datagrams that arrived while it was off are lost
+        void boot(uint32_t _id)
+        {
+            Unit& unit = get(_id);
+            receiveAll(unit.endpoint);
+            unit.epoch++;
+            unit.election = Election{unit.id, unit.epoch, makeConfig()};
+            unit.election.start(nowMs, true);
+            unit.running = true;
+        }
+
+        void powerOff(uint32_t _id)
+        {
+            get(_id).running = false;
+        }
+
+        void broadcast(Unit& _from, const uint8_t* _data, size_t _size)
+        {
+            for (Unit& unit : units)
+            {
+                if (&unit != &_from)
+                    sendTo(_from.endpoint, unit.endpoint, _data, _size);
+            }
+            sendTo(_from.endpoint, sniffer, _data, _size);
+        }
+
+        void receive(Unit& _unit)
+        {
+            for (const std::vector<uint8_t>& datagram : receiveAll(_unit.endpoint))
+            {
+                Header header;
+                Board board;
+                if (decode(datagram.data(), datagram.size(), header, board)
+                    && _unit.election.onMessage(header, nowMs) == Verdict::Use)
+                {
+                    _unit.shown = board;
+                    _unit.shownFrom = header.unitId;
+                }
+            }
+        }
+
+        // One turn of the FanOut.cpp task loop
+        void announce(Unit& _unit)
+        {
+            if (_unit.election.poll(nowMs) != Role::Fetcher)
+                return;
+
+            const Board board = makeFetchedBoard(_unit.id, nowMs);
+            if (board == _unit.sent && nowMs - _unit.sentMs < makeConfig().announceMs)
+                return;
+
+            uint8_t message[MaxMessageSize];
+            const size_t size = encode(_unit.election.makeHeader(nowMs / 1000), board, message, sizeof(message));
+            broadcast(_unit, message, size);
+            _unit.sent = board;
+            _unit.sentMs = nowMs;
+            _unit.shown = board;
+            _unit.shownFrom = _unit.id;
+        }
+
+        void runFor(uint32_t _ms)
+        {
+            for (const uint32_t end = nowMs + _ms; nowMs < end;)
+            {
+                nowMs += StepMs;
+                for (Unit& unit : units)
+                {
+                    if (unit.running)
+                        announce(unit);
+                }
+                for (Unit& unit : units)
+                {
+                    if (unit.running)
+                        receive(unit);
+                }
+                for (std::vector<uint8_t>& datagram : receiveAll(sniffer))
+                    captured.push_back(datagram);
+            }
+        }
+
+        // Sends a captured datagram again, from the sniffer, to every running unit
+        void replay(const std::vector<uint8_t>& _datagram)
+        {
+            for (Unit& unit : units)
+            {
+                if (unit.running)
+                    sendTo(sniffer, unit.endpoint, _datagram.data(), _datagram.size());
+            }
+        }
+
+        const std::vector<uint8_t>& findCaptured(uint32_t _unitId, uint32_t _sequence) const
+        {
+            static const std::vector<uint8_t> None;
+            for (const std::vector<uint8_t>& datagram : captured)
+            {
+                Header header;
+                Board board;
+                if (decode(datagram.data(), datagram.size(), header, board)
+                    && header.unitId == _unitId && header.sequence == _sequence)
+                {
+                    return datagram;
+                }
+            }
+            return None;
+        }
+    };
+
+    uint32_t countFetchers(Lan& _lan)
+    {
+        uint32_t fetchers = 0;
+        for (Unit& unit : _lan.units)
+            fetchers += unit.running && unit.election.getRole() == Role::Fetcher;
+        return fetchers;
+    }
+
+    void testElection(Lan& _lan)
+    {
+        for (Unit& unit : _lan.units)
+            _lan.boot(unit.id);
+
+        // Nobody announces before the takeover time, then all at once and the lowest stays
+        _lan.runFor(2900);
+        TR_CHECK(countFetchers(_lan) == 0 && _lan.captured.empty());
+        _lan.runFor(3100);
+        TR_CHECK(countFetchers(_lan) == 1);
+        TR_CHECK(_lan.get(10).election.getRole() == Role::Fetcher);
+        TR_CHECK(_lan.get(20).election.getStats().yields == 1);
+        TR_CHECK(_lan.get(30).election.getStats().yields == 1);
+
+        // The subscribers show the board of the fetcher, the heartbeats are all used
+        for (uint32_t id : {20u, 30u})
+        {
+            const Unit& unit = _lan.get(id);
+            TR_CHECK(unit.shownFrom == 10 && unit.shown == _lan.get(10).sent);
+            TR_CHECK(unit.election.getStats().lost == 0 && unit.election.getStats().duplicates == 0);
+        }
+    }
+
+    void testReplay(Lan& _lan)
+    {
+        const std::vector<uint8_t> first = _lan.findCaptured(10, 1);
+        TR_CHECK(!first.empty());
+        TR_CHECK(!(_lan.get(20).shown == makeFetchedBoard(10, 3000)));
+
+        // An old snapshot of the fetcher replayed does not bring its old board back
+        _lan.replay(first);
+        _lan.runFor(StepMs);
+        for (uint32_t id : {20u, 30u})
+        {
+            TR_CHECK(_lan.get(id).election.getStats().duplicates == 1);
+            TR_CHECK(_lan.get(id).shown == _lan.get(10).sent);
+        }
+        TR_CHECK(_lan.get(10).election.getStats().ignored >= 2);
+        TR_CHECK(countFetchers(_lan) == 1);
+    }
+
+    void testTakeover(Lan& _lan)
+    {
+        const std::vector<uint8_t> old = _lan.findCaptured(10, 3);
+        TR_CHECK(!old.empty());
+
+        // The fetcher dies right after a heartbeat, the next lowest takes over once the takeover
+        // time passed
+        TR_CHECK(_lan.nowMs - _lan.get(10).sentMs == StepMs);
+        _lan.powerOff(10);
+        _lan.runFor(2800);
+        TR_CHECK(countFetchers(_lan) == 0);
+        _lan.runFor(StepMs);
+        TR_CHECK(countFetchers(_lan) == 1);
+        TR_CHECK(_lan.get(20).election.getRole() == Role::Fetcher);
+        TR_CHECK(_lan.get(30).shownFrom == 20 && _lan.get(30).shown == _lan.get(20).sent);
+
+        // A late snapshot of the dead fetcher does not take the role back
+        _lan.replay(old);
+        _lan.runFor(StepMs);
+        TR_CHECK(_lan.get(20).election.getRole() == Role::Fetcher);
+        TR_CHECK(_lan.get(30).shownFrom == 20 && _lan.get(30).shown == _lan.get(20).sent);
+        TR_CHECK(_lan.get(20).election.getStats().duplicates == 2);
+        TR_CHECK(_lan.get(30).election.getStats().duplicates == 2);
+
+        // Rebooted, it subscribes to the new fetcher
+        _lan.boot(10);
+        _lan.runFor(2000);
+        TR_CHECK(countFetchers(_lan) == 1);
+        TR_CHECK(_lan.get(10).election.getRole() == Role::Subscriber);
+        TR_CHECK(_lan.get(10).shownFrom == 20 && _lan.get(10).shown == _lan.get(20).sent);
+    }
+} // namespace
+
+int main()
+{
+    Lan lan;
+    testElection(lan);
+    testReplay(lan);
+    testTakeover(lan);
+
+    printf("%zu datagrams over the loopback\n", lan.captured.size());
+    return tr::test::finish();
+}
@@ -0,0 +1,210 @@
+// The fan-out messages and the fetcher election: the duplicates, the reboots of the fetcher
+// ordered by their boot counter epochs, the late packets of a previous boot, the takeovers,
+// the silent fetchers forgotten, the units without a stored epoch
+
+#include "Check.hpp"
+
+#include "tram_run/FanOutProtocol.hpp"
+
+#include <string.h>
+
+namespace
+{
+    using namespace tr::fanout;
+
+    constexpr uint32_t Self = 20;
+    constexpr uint32_t Leader = 10;
+
+    Config makeConfig()
+    {
+        Config config;
+        config.announceMs = 1000;
+        config.takeoverMs = 3000;
+        config.staggerMs = 0;
+        return config;
+    }
+
+    Header makeHeader(uint32_t _unitId, uint32_t _epoch, uint32_t _sequence)
+    {
+        Header header;
+        header.unitId = _unitId;
+        header.epoch = _epoch;
+        header.sequence = _sequence;
+        return header;
+    }
+
+    void testCodec()
+    {
+        tr::departures::Board board;
+        board.count = 2;
+        board.items[0] = {1700000000, 1234, "17", 1};
+        board.items[1] = {1700000300, 5678, "9A", 3};
+
+        Header header = makeHeader(0xA1B2C3D4, 0xFFFFFFFE, 77);
+        header.sentAt = 1699999999;
+
+        uint8_t message[MaxMessageSize];
+        const size_t size = encode(header, board, message, sizeof(message));
+        TR_CHECK(size == HeaderSize + 2 * DepartureSize);
+        TR_CHECK(encode(header, board, message, size - 1) == 0);
+
+        Header decoded;
+        tr::departures::Board decodedBoard;
+        TR_CHECK(decode(message, size, decoded, decodedBoard));
+        TR_CHECK(decoded.unitId == header.unitId && decoded.epoch == header.epoch);
+        TR_CHECK(decoded.sequence == header.sequence && decoded.sentAt == header.sentAt);
+        TR_CHECK(decodedBoard.count == 2);
+        TR_CHECK(decodedBoard.items[1].time == 1700000300 && decodedBoard.items[1].vehicleId == 5678);
+        TR_CHECK(strcmp(decodedBoard.items[1].line, "9A") == 0 && decodedBoard.items[1].source == 3);
+
+        TR_CHECK(!decode(message, size - 1, decoded, decodedBoard));
+        TR_CHECK(!decode(message, HeaderSize - 1, decoded, decodedBoard));
+        message[5] = tr::departures::MaxVisible + 1;
+        TR_CHECK(!decode(message, size, decoded, decodedBoard));
+        message[5] = 2;
+        message[0] = 'X';
+        TR_CHECK(!decode(message, size, decoded, decodedBoard));
+    }
+
+    void testSequence()
+    {
+        Election election(Self, 1, makeConfig());
+        election.start(0, true);
+
+        TR_CHECK(election.onMessage(makeHeader(Self, 1, 1), 0) == Verdict::Own);
+        TR_CHECK(election.onMessage(makeHeader(Leader, 5, 1), 100) == Verdict::Use);
+        TR_CHECK(election.onMessage(makeHeader(Leader, 5, 1), 200) == Verdict::Duplicate);
+        TR_CHECK(election.onMessage(makeHeader(Leader, 5, 3), 300) == Verdict::Use);
+        TR_CHECK(election.onMessage(makeHeader(Leader, 5, 2), 400) == Verdict::Duplicate);
+
+        // A higher id is ignored, a lower one is followed instead
+        TR_CHECK(election.onMessage(makeHeader(15, 1, 50), 500) == Verdict::Ignored);
+        TR_CHECK(election.onMessage(makeHeader(5, 1, 50), 600) == Verdict::Use);
+        TR_CHECK(election.onMessage(makeHeader(Leader, 5, 4), 700) == Verdict::Ignored);
+
+        const Stats& stats = election.getStats();
+        TR_CHECK(stats.used == 3 && stats.duplicates == 2 && stats.lost == 1 && stats.ignored == 2);
+    }
+
+    void testEpochs()
+    {
+        Election election(Self, 1, makeConfig());
+        election.start(0, true);
+
+        TR_CHECK(election.onMessage(makeHeader(Leader, 5, 40), 100) == Verdict::Use);
+
+        // The fetcher rebooted, its sequence starts over
+        TR_CHECK(election.onMessage(makeHeader(Leader, 6, 1), 200) == Verdict::Use);
+        TR_CHECK(election.onMessage(makeHeader(Leader, 6, 2), 300) == Verdict::Use);
+
+        // Late or replayed packets of the previous boot, whatever their sequence
+        TR_CHECK(election.onMessage(makeHeader(Leader, 5, 41), 400) == Verdict::Duplicate);
+        TR_CHECK(election.onMessage(makeHeader(Leader, 5, 1000), 500) == Verdict::Duplicate);
+        TR_CHECK(election.onMessage(makeHeader(Leader, 4, 1), 600) == Verdict::Duplicate);
+        TR_CHECK(election.onMessage(makeHeader(Leader, 6, 3), 700) == Verdict::Use);
+
+        // The boot counter may wrap
+        Election wrapping(Self, 1, makeConfig());
+        wrapping.start(0, true);
+        TR_CHECK(wrapping.onMessage(makeHeader(Leader, UINT32_MAX, 9), 100) == Verdict::Use);
+        TR_CHECK(wrapping.onMessage(makeHeader(Leader, 0, 1), 200) == Verdict::Use);
+        TR_CHECK(wrapping.onMessage(makeHeader(Leader, UINT32_MAX, 10), 300) == Verdict::Duplicate);
+        TR_CHECK(wrapping.onMessage(makeHeader(Leader, 1, 1), 400) == Verdict::Use);
+    }
+
+    void testTakeover()
+    {
+        Election election(Self, 1, makeConfig());
+        election.start(0, true);
+        TR_CHECK(election.poll(2999) == Role::Subscriber);
+        TR_CHECK(election.poll(3000) == Role::Fetcher);
+        TR_CHECK(!election.hasLeader());
+
+        const Header first = election.makeHeader(100);
+        const Header second = election.makeHeader(200);
+        TR_CHECK(first.unitId == Self && first.epoch == 1 && second.sequence == first.sequence + 1);
+
+        // A lower id takes the role back
+        TR_CHECK(election.onMessage(makeHeader(Leader, 7, 1), 4000) == Verdict::Use);
+        TR_CHECK(election.getRole() == Role::Subscriber);
+        TR_CHECK(election.onMessage(makeHeader(Leader, 7, 2), 5000) == Verdict::Use);
+
+        // It goes silent, we take over again
+        TR_CHECK(election.poll(8000) == Role::Fetcher);
+        TR_CHECK(election.getStats().takeovers == 2 && election.getStats().yields == 1);
+
+        // Its late packets or an old boot replayed do not take the role back
+        TR_CHECK(election.onMessage(makeHeader(Leader, 7, 2), 8100) == Verdict::Duplicate);
+        TR_CHECK(election.onMessage(makeHeader(Leader, 6, 900), 8200) == Verdict::Duplicate);
+        TR_CHECK(election.getRole() == Role::Fetcher);
+
+        // It rebooted or simply came back
+        TR_CHECK(election.onMessage(makeHeader(Leader, 7, 3), 9000) == Verdict::Use);
+        TR_CHECK(election.getRole() == Role::Subscriber);
+        TR_CHECK(election.poll(12000) == Role::Fetcher);
+        TR_CHECK(election.onMessage(makeHeader(Leader, 8, 1), 12100) == Verdict::Use);
+        TR_CHECK(election.getRole() == Role::Subscriber);
+        TR_CHECK(election.getStats().yields == 3);
+    }
+
+    void testExpiry()
+    {
+        Election election(Self, 1, makeConfig());
+        election.start(0, true);
+        TR_CHECK(election.onMessage(makeHeader(Leader, 7, 40), 1000) == Verdict::Use);
+        TR_CHECK(election.poll(4000) == Role::Fetcher);
+
+        // Remembered for a takeover time after the takeover
+        TR_CHECK(election.onMessage(makeHeader(Leader, 7, 40), 6999) == Verdict::Duplicate);
+        TR_CHECK(election.onMessage(makeHeader(Leader, 3, 1), 6999) == Verdict::Duplicate);
+        TR_CHECK(election.getRole() == Role::Fetcher);
+
+        // Then forgotten: back with a lost boot counter, it is followed again
+        TR_CHECK(election.onMessage(makeHeader(Leader, 3, 1), 7000) == Verdict::Use);
+        TR_CHECK(election.getRole() == Role::Subscriber);
+        TR_CHECK(election.onMessage(makeHeader(Leader, 3, 1), 7100) == Verdict::Duplicate);
+        TR_CHECK(election.onMessage(makeHeader(Leader, 7, 41), 7200) == Verdict::Use);
+        TR_CHECK(election.onMessage(makeHeader(Leader, 3, 2), 7300) == Verdict::Duplicate);
+
+        // A subscriber forgets it the same way, even without polling
+        Election subscriber(Self, 1, makeConfig());
+        subscriber.start(0, true);
+        TR_CHECK(subscriber.onMessage(makeHeader(Leader, 9, 5), 1000) == Verdict::Use);
+        TR_CHECK(subscriber.onMessage(makeHeader(Leader, 9, 5), 6999) == Verdict::Duplicate);
+        TR_CHECK(subscriber.onMessage(makeHeader(Leader, 9, 5), 7000) == Verdict::Use);
+    }
+
+    void testEpochNotStored()
+    {
+        Election election(Self, 1, makeConfig());
+        election.start(0, false);
+
+        // Fetches for itself but never announces
+        TR_CHECK(election.poll(2999) == Role::Subscriber);
+        TR_CHECK(election.poll(3000) == Role::Standalone);
+        TR_CHECK(election.getStats().takeovers == 1);
+
+        // Any fetcher is followed, even one with a higher id
+        TR_CHECK(election.onMessage(makeHeader(30, 2, 1), 3500) == Verdict::Use);
+        TR_CHECK(election.getRole() == Role::Subscriber);
+        TR_CHECK(election.getStats().yields == 1);
+
+        // And a lower one still wins over it
+        TR_CHECK(election.onMessage(makeHeader(Leader, 2, 1), 3600) == Verdict::Use);
+        TR_CHECK(election.onMessage(makeHeader(30, 2, 2), 3700) == Verdict::Ignored);
+        TR_CHECK(election.poll(6599) == Role::Subscriber);
+        TR_CHECK(election.poll(6600) == Role::Standalone);
+    }
+} // namespace
+
+int main()
+{
+    testCodec();
+    testSequence();
+    testEpochs();
+    testTakeover();
+    testExpiry();
+    testEpochNotStored();
+
+    return tr::test::finish();
+}
@@ -0,0 +1,166 @@
+// The inbox ordering and coalescing, then several producers, one of them playing an ISR,
+// hammering it while the receiver drains it the way the main task does
+
+#include "Check.hpp"
+
+#include "tram_run/Inbox.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using tr::app::Event;
+    using tr::app::Inbox;
+
+    constexpr unsigned Producers = 4;
+    constexpr unsigned PostsPerProducer = 50000;
+    constexpr unsigned TypeCount = static_cast<unsigned>(Event::Type::Count);
+
+    Event makeEvent(Event::Type _type)
+    {
+        Event event;
+        event.type = _type;
+        return event;
+    }
+
+    void testOrder()
+    {
+        Inbox inbox;
+        Event event;
+
+        // The control lane goes first, each lane in the posting order
+        inbox.post(makeEvent(Event::Type::TimerTick));
+        inbox.post(makeEvent(Event::Type::DeparturesChanged));
+        inbox.post(makeEvent(Event::Type::ButtonPress));
+        TR_CHECK(inbox.pop(event) && event.type == Event::Type::ButtonPress);
+        TR_CHECK(inbox.pop(event) && event.type == Event::Type::TimerTick);
+        TR_CHECK(inbox.pop(event) && event.type == Event::Type::DeparturesChanged);
+        TR_CHECK(!inbox.pop(event));
+
+        // A coalesced event keeps the place of the one already waiting
+        inbox.post(makeEvent(Event::Type::TimerTick));
+        inbox.post(makeEvent(Event::Type::DeparturesChanged));
+        inbox.post(makeEvent(Event::Type::TimerTick));
+        TR_CHECK(inbox.pop(event) && event.type == Event::Type::TimerTick);
+        TR_CHECK(inbox.pop(event) && event.type == Event::Type::DeparturesChanged);
+        TR_CHECK(!inbox.pop(event));
+        TR_CHECK(inbox.getStats(Inbox::Lane::Bulk).coalesced == 1);
+
+        // Once popped the type is queued again
+        inbox.post(makeEvent(Event::Type::TimerTick));
+        TR_CHECK(inbox.pop(event) && event.type == Event::Type::TimerTick);
+
+        // Every press counts, up to the capacity of the lane
+        for (unsigned i = 0; i < Inbox::LaneCapacity; ++i)
+            TR_CHECK(inbox.post(makeEvent(Event::Type::ButtonPress)));
+        TR_CHECK(!inbox.post(makeEvent(Event::Type::ButtonPress)));
+        const Inbox::LaneStats control = inbox.getStats(Inbox::Lane::Control);
+        TR_CHECK(control.overflows == 1);
+        TR_CHECK(control.highWaterMark == Inbox::LaneCapacity);
+        for (unsigned i = 0; i < Inbox::LaneCapacity; ++i)
+            TR_CHECK(inbox.pop(event) && event.type == Event::Type::ButtonPress);
+        TR_CHECK(!inbox.pop(event));
+
+        // So does every long press, two of them before the drain are two calibration points
+        inbox.post(makeEvent(Event::Type::ButtonLongPress));
+        inbox.post(makeEvent(Event::Type::ButtonPress));
+        inbox.post(makeEvent(Event::Type::ButtonLongPress));
+        TR_CHECK(inbox.pop(event) && event.type == Event::Type::ButtonLongPress);
+        TR_CHECK(inbox.pop(event) && event.type == Event::Type::ButtonPress);
+        TR_CHECK(inbox.pop(event) && event.type == Event::Type::ButtonLongPress);
+        TR_CHECK(!inbox.pop(event));
+        TR_CHECK(inbox.getStats(Inbox::Lane::Control).coalesced == 0);
+    }
+
+    void testProducers()
+    {
+        static Inbox inbox;
+        tskTaskControlBlock receiver;
+        inbox.setReceiver(&receiver);
+
+        std::atomic<unsigned> running{Producers};
+        std::atomic<uint32_t> attempts[TypeCount] = {};
+        std::atomic<uint32_t> acceptedPresses{0};
+        std::atomic<uint32_t> acceptedLongPresses{0};
+
+        std::vector<std::thread> producers;
+        for (unsigned p = 0; p < Producers; ++p)
+        {
+            producers.emplace_back([&, p]() {
+                t_stubInIsr = p == 0;
+                for (unsigned i = 0; i < PostsPerProducer; ++i)
+                {
+                    const auto type = static_cast<Event::Type>((i * 7 + p) % TypeCount);
+                    attempts[static_cast<unsigned>(type)]++;
+                    if (inbox.post(makeEvent(type)))
+                    {
+                        acceptedPresses += type == Event::Type::ButtonPress;
+                        acceptedLongPresses += type == Event::Type::ButtonLongPress;
+                    }
+                    if (i % 64 == 0)
+                        std::this_thread::yield();
+                }
+                running--;
+            });
+        }
+
+        uint32_t popped[TypeCount] = {};
+        unsigned lostWakeups = 0;
+        Event event;
+        while (true)
+        {
+            const bool done = running == 0;
+            while (inbox.pop(event))
+                popped[static_cast<unsigned>(event.type)]++;
+            if (done)
+                break;
+
+            // Every queued event notifies the receiver, a timeout with events waiting is a lost one
+            if (ulTaskNotifyTakeFor(&receiver, pdTRUE, 1000) == 0 && inbox.pop(event))
+            {
+                popped[static_cast<unsigned>(event.type)]++;
+                lostWakeups++;
+            }
+        }
+        for (std::thread& producer : producers)
+            producer.join();
+
+        TR_CHECK(lostWakeups == 0);
+        TR_CHECK(!inbox.pop(event));
+
+        // No press lost or duplicated, and every signal seen at least once
+        TR_CHECK(popped[static_cast<unsigned>(Event::Type::ButtonPress)] == acceptedPresses);
+        TR_CHECK(popped[static_cast<unsigned>(Event::Type::ButtonLongPress)] == acceptedLongPresses);
+        for (unsigned type = 0; type < TypeCount; ++type)
+            TR_CHECK(attempts[type] == 0 || popped[type] > 0);
+
+        // The counters add up: every post was queued, coalesced or dropped, every queued one popped
+        uint32_t laneAttempts[2] = {};
+        uint32_t lanePopped[2] = {};
+        for (unsigned type = 0; type < TypeCount; ++type)
+        {
+            const bool control = type == (unsigned)Event::Type::ButtonPress || type == (unsigned)Event::Type::ButtonLongPress
+                || type == (unsigned)Event::Type::OtaDone || type == (unsigned)Event::Type::OtaFail
+                || type == (unsigned)Event::Type::WifiFail || type == (unsigned)Event::Type::WifiReady;
+            laneAttempts[control ? 0 : 1] += attempts[type];
+            lanePopped[control ? 0 : 1] += popped[type];
+        }
+        for (unsigned lane = 0; lane < 2; ++lane)
+        {
+            const Inbox::LaneStats stats = inbox.getStats(static_cast<Inbox::Lane>(lane));
+            TR_CHECK(stats.posted + stats.coalesced + stats.overflows == laneAttempts[lane]);
+            TR_CHECK(stats.posted == lanePopped[lane]);
+            TR_CHECK(stats.highWaterMark <= Inbox::LaneCapacity);
+        }
+        inbox.logStats();
+    }
+} // namespace
+
+int main()
+{
+    testOrder();
+    testProducers();
+    return tr::test::finish();
+}
@@ -0,0 +1,230 @@
+// The OTA decoder against images packed by tools/ota_pack.py (see CMakeLists.txt), fed in chunks
+// of random sizes as they come from the HTTP client, then the broken streams: truncated, a bad
+// magic, references before the start of the data, more data than the header announced
+
+#include "Check.hpp"
+
+#include "tram_run/Lzss.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    using tr::lzss::Decoder;
+    using Bytes = std::vector<uint8_t>;
+
+    const char* const Images[] = {"empty", "runs", "random", "sources", "binary"};
+
+    Bytes readFile(const std::string& _path)
+    {
+        Bytes data;
+        FILE* file = fopen(_path.c_str(), "rb");
+        TR_CHECK(file != nullptr);
+        if (file == nullptr)
+            return data;
+
+        uint8_t buffer[4096];
+        size_t read = 0;
+        while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+            data.insert(data.end(), buffer, buffer + read);
+        fclose(file);
+        return data;
+    }
+
+    struct Output
+    {
+        Bytes data;
+        bool oversized = false;     // A chunk bigger than Decoder::OutputSize
+        bool fail = false;
+    };
+
+    void reset(Decoder& _decoder, Output& _output)
+    {
+        _output = {};
+        Output* output = &_output;
+        _decoder.reset([output](const uint8_t* _data, size_t _size) {
+            output->oversized |= _size > Decoder::OutputSize;
+            output->data.insert(output->data.end(), _data, _data + _size);
+            return !output->fail;
+        });
+    }
+
+    // Stops at the first error, as Ota.cpp does
+    Decoder::Status feed(Decoder& _decoder, const Bytes& _packed, std::mt19937& _random, size_t _maxChunk)
+    {
+        for (size_t offset = 0; offset < _packed.size();)
+        {
+            const size_t chunk = std::min<size_t>(_random() % (_maxChunk + 1), _packed.size() - offset);
+            const Decoder::Status status = _decoder.feed(_packed.data() + offset, chunk);
+            if (status != Decoder::Status::Ok)
+                return status;
+            offset += chunk;
+        }
+        return _decoder.finish();
+    }
+
+    Bytes makeStream(uint32_t _size, const Bytes& _body)
+    {
+        Bytes stream(tr::lzss::Magic, tr::lzss::Magic + sizeof(tr::lzss::Magic));
+        for (unsigned i = 0; i < 4; ++i)
+            stream.push_back(_size >> (8 * i));
+        stream.insert(stream.end(), _body.begin(), _body.end());
+        return stream;
+    }
+
+    uint16_t makeReference(unsigned _distance, unsigned _length)
+    {
+        return ((_distance - 1) << tr::lzss::LengthBits) | (_length - tr::lzss::MinMatch);
+    }
+
+    void testImages(Decoder& _decoder)
+    {
+        std::mt19937 random(33);
+        for (const char* image : Images)
+        {
+            const std::string path = std::string(TR_LZSS_IMAGES_DIR) + "/" + image;
+            const Bytes original = readFile(path);
+            const Bytes packed = readFile(path + ".trz");
+            printf("%s: %zu -> %zu bytes\n", image, original.size(), packed.size());
+
+            // From a byte at a time to chunks bigger than the output buffer, and all at once
+            for (size_t maxChunk : {size_t(1), size_t(7), size_t(300), size_t(4096), packed.size()})
+            {
+                Output output;
+                reset(_decoder, output);
+                TR_CHECK(feed(_decoder, packed, random, maxChunk) == Decoder::Status::Ok);
+                TR_CHECK(_decoder.isComplete() && _decoder.getExpectedSize() == original.size());
+                TR_CHECK(output.data == original);
+                TR_CHECK(!output.oversized);
+            }
+        }
+    }
+
+    void testTruncated(Decoder& _decoder)
+    {
+        const Bytes packed = readFile(std::string(TR_LZSS_IMAGES_DIR) + "/sources.trz");
+        TR_CHECK(packed.size() > 1000);
+
+        // In the header, in a flag byte or a reference, anywhere
+        std::mt19937 random(7);
+        for (size_t size : {size_t(0), size_t(3), size_t(8), size_t(9), packed.size() / 2, packed.size() - 1})
+        {
+            const Bytes cut(packed.begin(), packed.begin() + size);
+            Output output;
+            reset(_decoder, output);
+            TR_CHECK(feed(_decoder, cut, random, 64) == Decoder::Status::Truncated);
+            TR_CHECK(!_decoder.isComplete());
+            TR_CHECK(output.data.size() == _decoder.getProducedSize());
+        }
+    }
+
+    void testBadMagic(Decoder& _decoder)
+    {
+        Bytes packed = readFile(std::string(TR_LZSS_IMAGES_DIR) + "/runs.trz");
+        std::mt19937 random(11);
+        for (size_t byte = 0; byte < sizeof(tr::lzss::Magic); ++byte)
+        {
+            Bytes broken = packed;
+            broken[byte] ^= 0x20;
+            Output output;
+            reset(_decoder, output);
+            TR_CHECK(feed(_decoder, broken, random, 3) == Decoder::Status::BadHeader);
+            TR_CHECK(output.data.empty());
+        }
+    }
+
+    void testBadReference(Decoder& _decoder)
+    {
+        Output output;
+        std::mt19937 random(5);
+
+        // Nothing decoded yet
+        reset(_decoder, output);
+        uint16_t reference = makeReference(1, 3);
+        Bytes stream = makeStream(3, {0x00, uint8_t(reference >> 8), uint8_t(reference)});
+        TR_CHECK(feed(_decoder, stream, random, 2) == Decoder::Status::BadReference);
+
+        // One byte past the two decoded ones, then exactly back to the first one
+        reset(_decoder, output);
+        reference = makeReference(3, 4);
+        stream = makeStream(6, {0x03, 'a', 'b', uint8_t(reference >> 8), uint8_t(reference)});
+        TR_CHECK(feed(_decoder, stream, random, 2) == Decoder::Status::BadReference);
+        TR_CHECK(output.data.empty());
+
+        reset(_decoder, output);
+        reference = makeReference(2, 4);
+        stream = makeStream(6, {0x03, 'a', 'b', uint8_t(reference >> 8), uint8_t(reference)});
+        TR_CHECK(feed(_decoder, stream, random, 2) == Decoder::Status::Ok);
+        TR_CHECK(output.data == Bytes({'a', 'b', 'a', 'b', 'a', 'b'}));
+
+        // The whole window back is fine once that much was decoded
+        reset(_decoder, output);
+        Bytes body;
+        Bytes expected;
+        for (unsigned i = 0; i < tr::lzss::WindowSize; ++i)
+        {
+            if (i % 8 == 0)
+                body.push_back(0xFF);
+            body.push_back(i * 7);
+            expected.push_back(i * 7);
+        }
+        reference = makeReference(tr::lzss::WindowSize, 3);
+        body.push_back(0x00);
+        body.push_back(reference >> 8);
+        body.push_back(reference);
+        expected.insert(expected.end(), expected.begin(), expected.begin() + 3);
+        TR_CHECK(feed(_decoder, makeStream(expected.size(), body), random, 100) == Decoder::Status::Ok);
+        TR_CHECK(output.data == expected);
+    }
+
+    void testOverrun(Decoder& _decoder)
+    {
+        Output output;
+        std::mt19937 random(3);
+
+        // A literal or a reference past the announced size
+        reset(_decoder, output);
+        TR_CHECK(feed(_decoder, makeStream(1, {0x03, 'a', 'b'}), random, 2) == Decoder::Status::Overrun);
+        reset(_decoder, output);
+        const uint16_t reference = makeReference(1, 3);
+        TR_CHECK(feed(_decoder, makeStream(3, {0x01, 'a', uint8_t(reference >> 8), uint8_t(reference)}), random, 2)
+            == Decoder::Status::Overrun);
+
+        // A packed image announcing one byte less than it holds
+        Bytes packed = readFile(std::string(TR_LZSS_IMAGES_DIR) + "/sources.trz");
+        packed[4]--;
+        reset(_decoder, output);
+        TR_CHECK(feed(_decoder, packed, random, 500) == Decoder::Status::Overrun);
+        TR_CHECK(_decoder.getProducedSize() == _decoder.getExpectedSize());
+
+        // Extra bytes after a complete image
+        packed = readFile(std::string(TR_LZSS_IMAGES_DIR) + "/runs.trz");
+        packed.insert(packed.end(), {0xFF, 'x', 'y'});
+        reset(_decoder, output);
+        TR_CHECK(feed(_decoder, packed, random, 500) == Decoder::Status::Overrun);
+
+        // The sink refusing the data stops the stream
+        reset(_decoder, output);
+        output.fail = true;
+        TR_CHECK(feed(_decoder, makeStream(2, {0x03, 'a', 'b'}), random, 2) == Decoder::Status::SinkFailed);
+    }
+} // namespace
+
+int main()
+{
+    // As big as in Ota.cpp, where it is static too
+    static Decoder decoder;
+
+    testImages(decoder);
+    testTruncated(decoder);
+    testBadMagic(decoder);
+    testBadReference(decoder);
+    testOverrun(decoder);
+
+    return tr::test::finish();
+}
@@ -0,0 +1,129 @@
+// The deep sleep decision over the no service window, including the windows crossing midnight,
+// and the modem sleep estimate
+
+#include "Check.hpp"
+
+#include "tram_run/PowerPolicy.hpp"
+
+namespace
+{
+    using namespace tr::power;
+
+    constexpr uint16_t at(uint16_t _hour, uint16_t _minute)
+    {
+        return _hour * 60 + _minute;
+    }
+
+    PolicyInput makeInput(uint16_t _minuteOfDay, uint8_t _second = 0)
+    {
+        PolicyInput input;
+        input.timeValid = true;
+        input.minuteOfDay = _minuteOfDay;
+        input.second = _second;
+        return input;
+    }
+
+    void testWindow()
+    {
+        // Within the day, the end is excluded
+        TR_CHECK(!isInWindow(at(1, 0), at(4, 30), at(0, 59)));
+        TR_CHECK(isInWindow(at(1, 0), at(4, 30), at(1, 0)));
+        TR_CHECK(isInWindow(at(1, 0), at(4, 30), at(4, 29)));
+        TR_CHECK(!isInWindow(at(1, 0), at(4, 30), at(4, 30)));
+
+        // Across midnight
+        TR_CHECK(isInWindow(at(23, 30), at(4, 30), at(23, 30)));
+        TR_CHECK(isInWindow(at(23, 30), at(4, 30), at(0, 0)));
+        TR_CHECK(isInWindow(at(23, 30), at(4, 30), at(4, 29)));
+        TR_CHECK(!isInWindow(at(23, 30), at(4, 30), at(4, 30)));
+        TR_CHECK(!isInWindow(at(23, 30), at(4, 30), at(12, 0)));
+
+        // An empty window never matches
+        for (uint16_t minute = 0; minute < 24 * 60; ++minute)
+            TR_CHECK(!isInWindow(at(2, 0), at(2, 0), minute));
+
+        TR_CHECK(minutesUntil(at(1, 0), at(4, 30)) == 210);
+        TR_CHECK(minutesUntil(at(23, 30), at(4, 30)) == 300);
+        TR_CHECK(minutesUntil(at(4, 30), at(4, 30)) == 0);
+    }
+
+    void testDecide()
+    {
+        PolicyConfig config;
+        config.noServiceStartMinute = at(23, 30);
+        config.noServiceEndMinute = at(4, 30);
+
+        // Outside of the window
+        TR_CHECK(decide(config, makeInput(at(12, 0))).mode == Mode::Awake);
+
+        // The sleep ends exactly at the end of the window, the seconds already gone included
+        Decision decision = decide(config, makeInput(at(23, 30)));
+        TR_CHECK(decision.mode == Mode::DeepSleep);
+        TR_CHECK(decision.sleepSeconds == 5 * 60 * 60);
+
+        decision = decide(config, makeInput(at(2, 0), 42));
+        TR_CHECK(decision.mode == Mode::DeepSleep);
+        TR_CHECK(decision.sleepSeconds == 150 * 60 - 42);
+
+        // Too close to the end of the window for a cold boot to pay off
+        TR_CHECK(decide(config, makeInput(at(4, 20))).mode == Mode::DeepSleep);
+        TR_CHECK(decide(config, makeInput(at(4, 21))).mode == Mode::Awake);
+
+        // Nothing to decide without a synchronized clock
+        PolicyInput input = makeInput(at(2, 0));
+        input.timeValid = false;
+        TR_CHECK(decide(config, input).mode == Mode::Awake);
+
+        // An update or a flash write in progress
+        input = makeInput(at(2, 0));
+        input.busy = true;
+        TR_CHECK(decide(config, input).mode == Mode::Awake);
+
+        // A recent button press holds the device awake
+        input = makeInput(at(2, 0));
+        input.minutesSinceActivity = config.activityHoldMinutes - 1;
+        TR_CHECK(decide(config, input).mode == Mode::Awake);
+        input.minutesSinceActivity = config.activityHoldMinutes;
+        TR_CHECK(decide(config, input).mode == Mode::DeepSleep);
+
+        // The default window is empty, deep sleep is off
+        TR_CHECK(decide(PolicyConfig{}, makeInput(at(2, 0))).mode == Mode::Awake);
+    }
+
+    void testModemSleep()
+    {
+        constexpr int64_t S = 1000000;
+        ModemSleepMeter meter;
+
+        // Nothing before the power save is on, a fetch then does not count either
+        meter.setBusy(true, 1 * S);
+        meter.setBusy(false, 2 * S);
+        TR_CHECK(meter.getSleepUs(5 * S) == 0);
+
+        // A window open when the power save starts only counts from there
+        meter.setBusy(true, 9 * S);
+        meter.start(10 * S);
+        TR_CHECK(meter.getSleepUs(12 * S) == 0);
+        meter.setBusy(false, 12 * S);
+        TR_CHECK(meter.getSleepUs(20 * S) == 8 * S);
+
+        // Started once, the fetch windows are taken out, the one still open too
+        meter.start(30 * S);
+        meter.setBusy(true, 40 * S);
+        meter.setBusy(true, 41 * S);
+        meter.setBusy(false, 43 * S);
+        TR_CHECK(meter.getSleepUs(43 * S) == 28 * S);
+        meter.setBusy(true, 50 * S);
+        TR_CHECK(meter.getSleepUs(55 * S) == 35 * S);
+        meter.setBusy(false, 60 * S);
+        TR_CHECK(meter.getSleepUs(100 * S) == 75 * S);
+    }
+} // namespace
+
+int main()
+{
+    testWindow();
+    testDecide();
+    testModemSleep();
+    return tr::test::finish();
+}
@@ -0,0 +1,188 @@
+// One writer publishing boards while several readers check every view they pin is a complete one,
+// then the cost of a read and of a publish with and without contention
+
+#include "Check.hpp"
+
+#include "tram_run/Departures.hpp"
+#include "tram_run/Snapshot.hpp"
+
+#include <stdio.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using tr::Snapshot;
+    using tr::departures::Board;
+    using tr::departures::MaxVisible;
+
+    constexpr unsigned Readers = 4;
+    constexpr uint32_t Publishes = 200000;
+
+    // Every field of a board published as _version carries the version, a mix is a torn read
+    void fill(Board& _board, uint32_t _version)
+    {
+        _board.count = MaxVisible;
+        for (uint8_t i = 0; i < MaxVisible; ++i)
+        {
+            _board.items[i].time = _version;
+            _board.items[i].vehicleId = _version * 31 + i;
+            memcpy(_board.items[i].line, &_version, sizeof(_version));
+        }
+    }
+
+    bool isComplete(const Board& _board, uint32_t& _version)
+    {
+        if (_board.count == 0)
+        {
+            _version = 0;
+            return true;
+        }
+
+        _version = _board.items[0].time;
+        for (uint8_t i = 0; i < _board.count; ++i)
+        {
+            uint32_t line = 0;
+            memcpy(&line, _board.items[i].line, sizeof(line));
+            if (_board.items[i].time != _version || _board.items[i].vehicleId != _version * 31 + i || line != _version)
+                return false;
+        }
+        return true;
+    }
+
+    void testSingleThread()
+    {
+        Snapshot<Board> snapshot;
+        TR_CHECK(snapshot.read()->count == 0);
+
+        Board* board = snapshot.beginWrite();
+        TR_CHECK(board != nullptr);
+        fill(*board, 1);
+        // Not visible before the publish
+        TR_CHECK(snapshot.read()->count == 0);
+        snapshot.publish();
+        TR_CHECK(snapshot.read()->items[0].time == 1);
+
+        // A pinned buffer is not handed to the writer
+        {
+            const auto pinned = snapshot.read();
+            board = snapshot.beginWrite();
+            TR_CHECK(board != nullptr);
+            fill(*board, 2);
+            snapshot.publish();
+            TR_CHECK(snapshot.beginWrite() == nullptr);
+            TR_CHECK(pinned->items[0].time == 1);
+        }
+        TR_CHECK(snapshot.beginWrite() != nullptr);
+        TR_CHECK(snapshot.read()->items[0].time == 2);
+    }
+
+    void testReaders()
+    {
+        static Snapshot<Board> snapshot;
+        std::atomic<bool> done{false};
+        std::atomic<uint32_t> torn{0};
+        std::atomic<uint32_t> backwards{0};
+        std::atomic<uint64_t> reads{0};
+
+        std::vector<std::thread> readers;
+        for (unsigned r = 0; r < Readers; ++r)
+        {
+            readers.emplace_back([&]() {
+                uint32_t last = 0;
+                uint64_t count = 0;
+                while (!done.load())
+                {
+                    const auto view = snapshot.read();
+                    uint32_t version = 0;
+                    if (!isComplete(*view, version))
+                        torn++;
+                    // A reader never sees an older board after a newer one
+                    if (version < last)
+                        backwards++;
+                    last = version;
+                    count++;
+                }
+                reads += count;
+            });
+        }
+
+        uint32_t waits = 0;
+        for (uint32_t version = 1; version <= Publishes; ++version)
+        {
+            Board* board = nullptr;
+            while ((board = snapshot.beginWrite()) == nullptr)
+            {
+                waits++;
+                std::this_thread::yield();
+            }
+            fill(*board, version);
+            snapshot.publish();
+        }
+        done = true;
+        for (std::thread& reader : readers)
+            reader.join();
+
+        uint32_t version = 0;
+        TR_CHECK(isComplete(*snapshot.read(), version) && version == Publishes);
+        TR_CHECK(torn == 0);
+        TR_CHECK(backwards == 0);
+        printf("%u publishes, %llu reads, the writer waited for the readers %u times\n",
+            (unsigned)Publishes, (unsigned long long)reads.load(), (unsigned)waits);
+    }
+
+    void benchmark()
+    {
+        using Clock = std::chrono::steady_clock;
+        constexpr unsigned Operations = 2000000;
+
+        static Snapshot<Board> snapshot;
+        uint32_t sink = 0;
+
+        auto start = Clock::now();
+        for (unsigned i = 0; i < Operations; ++i)
+            sink += snapshot.read()->count;
+        const double readNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / Operations;
+
+        start = Clock::now();
+        for (unsigned i = 0; i < Operations; ++i)
+        {
+            Board* board = snapshot.beginWrite();
+            board->count = i % MaxVisible;
+            snapshot.publish();
+        }
+        const double publishNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / Operations;
+
+        // The same reads while another thread keeps publishing
+        std::atomic<bool> done{false};
+        std::thread writer([&]() {
+            while (!done.load())
+            {
+                if (snapshot.beginWrite() != nullptr)
+                    snapshot.publish();
+                else
+                    std::this_thread::yield();
+            }
+        });
+        start = Clock::now();
+        for (unsigned i = 0; i < Operations; ++i)
+            sink += snapshot.read()->count;
+        const double contendedNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / Operations;
+        done = true;
+        writer.join();
+
+        printf("read %.1f ns, publish %.1f ns, read under a publishing writer %.1f ns (%u)\n",
+            readNs, publishNs, contendedNs, sink % 10);
+    }
+} // namespace
+
+int main()
+{
+    testSingleThread();
+    testReaders();
+    benchmark();
+    return tr::test::finish();
+}
@@ -0,0 +1,357 @@
+// The host side of the stack sizing of the profiling mode (CONFIG_TR_PROFILE): the work each task
+// does in the profiling scenario runs on a painted stack, and the peak plus the room left for the
+// ESP-IDF calls the host cannot run must fit the Kconfig default of the task.
+//
+// Host frames are not Xtensa frames and the reserves are rough, so this catches a regression in
+// our own code (a large buffer on the stack, a deeper call chain) and does not replace the
+// figures the device prints in the profiling mode.
+
+#include "Check.hpp"
+
+#include "tram_run/BoardView.hpp"
+#include "tram_run/Deadline.hpp"
+#include "tram_run/Departures.hpp"
+#include "tram_run/Dial.hpp"
+#include "tram_run/Display.hpp"
+#include "tram_run/FanOutProtocol.hpp"
+#include "tram_run/Font.hpp"
+#include "tram_run/Inbox.hpp"
+#include "tram_run/Lzss.hpp"
+#include "tram_run/PowerPolicy.hpp"
+#include "tram_run/Profiler.hpp"
+#include "tram_run/Snapshot.hpp"
+#include "tram_run/Store.hpp"
+#include "tram_run/TextField.hpp"
+#include "tram_run/TimerWheel.hpp"
+#include "tram_run/Timetable.hpp"
+#include "tram_run/TimetableEncoder.hpp"
+
+#include <charconv>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+
+namespace
+{
+    using namespace tr;
+
+    constexpr size_t PaintedStackSize = 256 * 1024;
+    constexpr uint8_t Paint = 0xA5;
+    constexpr uint32_t StackMarginPercent = 25;
+    constexpr uint32_t Now = 1700000000;
+
+    // Shared by the tasks as on the device
+    Snapshot<departures::Board> g_board;
+    std::vector<uint8_t> g_timetable;
+    uint32_t g_sink = 0;
+
+    // The display::sendEvent() of the host: the event is copied, as into the queue
+    void queueEvent(const display::Event& _event)
+    {
+        display::Event copy = _event;
+        g_sink += copy.length;
+    }
+
+    // The snprintf() of glibc needs a few KB of stack, the one of newlib far less, so the feed is
+    // put together without it, as the board texts are in BoardView.cpp. What the device spends in
+    // snprintf() and esp_log is in the reserve.
+    size_t append(char* _text, size_t _size, size_t _length, std::string_view _part)
+    {
+        const size_t count = _part.size() < _size - _length ? _part.size() : _size - _length;
+        memcpy(_text + _length, _part.data(), count);
+        return _length + count;
+    }
+
+    size_t append(char* _text, size_t _size, size_t _length, uint32_t _number)
+    {
+        return std::to_chars(_text + _length, _text + _size, _number).ptr - _text;
+    }
+
+    struct NoLock
+    {
+        void lock() {}
+        void unlock() {}
+    };
+
+    // Events, timers and the board as the App task runs them in the scenario, the live board and
+    // the timetable fallback in turn, see App::showBoard()
+    void runMain()
+    {
+        static app::Inbox inbox;
+        static app::TimerWheel<16> wheel;
+        static dial::Table dial;
+        static departures::Aggregator aggregator;
+        static timetable::Reader reader;
+        static app::BoardView view(
+            queueEvent,
+            [](const servo::Event& _event) { g_sink += _event.compareTicks; },
+            [](uint32_t _now, departures::Board& _board) {
+                return reader.collectBoard(3, 600, _now - 600 * 60, _now, aggregator, _board);
+            });
+        static const departures::Board noLive;
+        dial.build(dial::DefaultCalibration);
+        reader.open(g_timetable.data(), g_timetable.size());
+
+        for (uint8_t press = 0; press < 20; ++press)
+        {
+            app::Event event;
+            event.type = app::Event::Type::ButtonPress;
+            inbox.post(event);
+        }
+        wheel.arm(0, 10, 10, 0, 0);
+
+        app::Event event;
+        bool live = true;
+        while (inbox.pop(event))
+        {
+            app::TimerWheel<16>::Expired expired;
+            const uint32_t now = wheel.getNow() + 10;
+            while (wheel.poll(now, expired))
+                g_sink += expired.tag;
+
+            const auto board = g_board.read();
+            view.invalidateScreen();
+            view.invalidateNeedle();
+            view.show(live ? board.get() : noLive, Now, now, dial);
+            live = !live;
+
+            power::PolicyInput input;
+            input.timeValid = true;
+            g_sink += (uint32_t)power::decide(power::PolicyConfig{}, input).mode;
+        }
+    }
+
+    // Every font through the text fields, then the marquee window, see Display.cpp
+    void runDisplay()
+    {
+        static uint8_t panel[8][128];
+        const auto sink = [](uint8_t _page, uint8_t _column, const uint8_t* _bytes, uint8_t _width) {
+            memcpy(&panel[_page % 8][_column], _bytes, _width);
+        };
+
+        const display::font::View* fonts[] = {&display::font::Small, &display::font::Digits16, &display::font::Digits32};
+        for (const display::font::View* font : fonts)
+        {
+            display::TextField field(*font, 0, 0);
+            g_sink += field.draw("88", sink);
+            g_sink += field.draw("17", sink);
+        }
+
+        const display::font::View& font = display::font::Small;
+        const std::string_view text = "17 12  9 15  3 21  17 27  9 33";
+        for (uint8_t page = 0; page < font.pages; ++page)
+        {
+            uint8_t row[128] = {};
+            unsigned column = 0;
+            for (size_t i = 0; i < text.size() && column + font.width <= sizeof(row); ++i)
+            {
+                memcpy(row + column, font.page(font.indexOf(text[i]), page), font.width);
+                column += font.cellWidth();
+            }
+            memcpy(panel[page], row, sizeof(row));
+        }
+    }
+
+    // The HTTP body of every stop parsed into the board, in chunks as the HTTP client hands them
+    // over, see Fetcher.cpp
+    void runFetcher()
+    {
+        static departures::RecordParser parser;
+        static departures::Aggregator aggregator;
+        for (uint8_t source = 0; source < departures::MaxSources; ++source)
+        {
+            char body[departures::MaxPerSource * departures::RecordParser::MaxRecordLength];
+            size_t size = 0;
+            for (uint8_t i = 0; i < departures::MaxPerSource; ++i)
+            {
+                size = append(body, sizeof(body), size, 100u + source * 8 + i);
+                size = append(body, sizeof(body), size, ",");
+                size = append(body, sizeof(body), size, 17u + i);
+                size = append(body, sizeof(body), size, ",");
+                size = append(body, sizeof(body), size, Now + 60 * i);
+                size = append(body, sizeof(body), size, "\n");
+            }
+
+            parser.reset();
+            for (size_t offset = 0; offset < size; offset += 64)
+                parser.feed(body + offset, size - offset < 64 ? size - offset : 64);
+            parser.endRecord();
+            aggregator.update(source, parser.items, parser.count, Now);
+        }
+
+        departures::Board* board = g_board.beginWrite();
+        if (board != nullptr)
+        {
+            *board = aggregator.getBoard();
+            g_board.publish();
+        }
+    }
+
+    // One chunk of a packed image through the decoder, which is static as in Ota.cpp
+    void runOta()
+    {
+        static lzss::Decoder decoder;
+        static uint8_t chunk[1024];
+
+        // Literal groups of 8 bytes, then one reference back 8 bytes for 10 bytes
+        const uint32_t literals = 64;
+        size_t size = 0;
+        memcpy(chunk, lzss::Magic, sizeof(lzss::Magic));
+        size += sizeof(lzss::Magic);
+        const uint32_t decoded = literals + 10;
+        memcpy(chunk + size, &decoded, sizeof(decoded));
+        size += sizeof(decoded);
+        for (uint32_t i = 0; i < literals; ++i)
+        {
+            if (i % 8 == 0)
+                chunk[size++] = 0xFF;
+            chunk[size++] = 'a' + i % 26;
+        }
+        chunk[size++] = 0x00;
+        const uint16_t reference = ((8 - 1) << lzss::LengthBits) | (10 - lzss::MinMatch);
+        chunk[size++] = reference >> 8;
+        chunk[size++] = reference & 0xFF;
+
+        decoder.reset([](const uint8_t* _data, size_t _size) {
+            g_sink += _data[0] + _size;
+            return true;
+        });
+        decoder.feed(chunk, size);
+        decoder.finish();
+        g_sink += decoder.isComplete();
+    }
+
+    // A forced flush of every key through store::flush(), the batch is static as in Persist.cpp
+    void runPersist()
+    {
+        static const char* const names[] = {"a", "b", "c", "d", "e", "f"};
+        static store::Batch batch;
+
+        store::Backend backend;
+        backend.read = [](const char*, void*, size_t&) { return false; };
+        backend.write = [](const char*, const void* _data, size_t _size) {
+            g_sink += static_cast<const uint8_t*>(_data)[0] + _size;
+            return true;
+        };
+        backend.commit = []() { return true; };
+
+        static store::Store store(names, store::MaxKeys, backend, store::Policy{});
+        store.load();
+        for (uint8_t key = 0; key < store::MaxKeys; ++key)
+        {
+            uint8_t value[store::MaxValueSize];
+            memset(value, key + 1, sizeof(value));
+            store.set(key, value, sizeof(value));
+        }
+        NoLock lock;
+        store::flush(store, batch, 0, true, lock, []() { return 1000u; });
+    }
+
+    // A snapshot sent and received, see FanOut.cpp
+    void runFanOut()
+    {
+        static fanout::Election election(1, 1, fanout::Config{});
+        election.start(0, true);
+
+        uint8_t message[fanout::MaxMessageSize];
+        const auto board = g_board.read();
+        const size_t size = fanout::encode(election.makeHeader(Now), *board, message, sizeof(message));
+
+        fanout::Header header;
+        departures::Board received;
+        if (fanout::decode(message, size, header, received))
+            g_sink += static_cast<uint32_t>(election.onMessage(header, 100));
+        g_sink += static_cast<uint32_t>(election.poll(200));
+    }
+
+    void runMonitor()
+    {
+        static deadline::Tracker tracker;
+        for (uint8_t channel = 0; channel < deadline::MaxChannels; ++channel)
+        {
+            tracker.configure(channel, "task", 1000);
+            tracker.begin(channel, 0);
+            tracker.end(channel, 500 * channel);
+        }
+        g_sink += tracker.poll(10000, 10).stalled;
+    }
+
+    void runNothing()
+    {
+    }
+
+    // Runs _work on a thread with a painted stack, returns the bytes of it that were touched
+    size_t measure(void (*_work)())
+    {
+        static uint8_t stack[PaintedStackSize] __attribute__((aligned(64)));
+        memset(stack, Paint, sizeof(stack));
+
+        pthread_attr_t attributes;
+        pthread_attr_init(&attributes);
+        pthread_attr_setstack(&attributes, stack, sizeof(stack));
+
+        pthread_t thread;
+        const int created = pthread_create(&thread, &attributes, [](void* _work) -> void* {
+            reinterpret_cast<void (*)()>(_work)();
+            return nullptr;
+        }, reinterpret_cast<void*>(_work));
+        TR_CHECK(created == 0);
+        pthread_join(thread, nullptr);
+        pthread_attr_destroy(&attributes);
+
+        // The stack grows down
+        size_t untouched = 0;
+        while (untouched < sizeof(stack) && stack[untouched] == Paint)
+            ++untouched;
+        return sizeof(stack) - untouched;
+    }
+
+    struct Task
+    {
+        const char* name;
+        void (*work)();
+        uint32_t stackSize;
+        // Room for what runs on the device only: esp_log, the drivers, lwIP, esp_http_client and TLS
+        uint32_t reserve;
+    };
+} // namespace
+
+int main()
+{
+    timetable::Encoder encoder;
+    std::vector<uint16_t> trips;
+    for (uint16_t minute = 300; minute < 1500; minute += 7)
+        trips.push_back(minute);
+    encoder.addService(0, 0x7F, "17", trips);
+    g_timetable = encoder.build();
+
+    const Task tasks[] = {
+        {"MAIN", runMain, CONFIG_TR_MAIN_TASK_STACK, 1024},
+        {"DISPLAY", runDisplay, CONFIG_TR_DISPLAY_TASK_STACK, 1536},
+        {"FETCHER", runFetcher, CONFIG_TR_FETCHER_TASK_STACK, 4096},
+        {"OTA", runOta, CONFIG_TR_OTA_TASK_STACK, 4096},
+        {"PERSIST", runPersist, CONFIG_TR_PERSIST_TASK_STACK, 1536},
+        {"FANOUT", runFanOut, CONFIG_TR_FANOUT_TASK_STACK, 1536},
+        {"MONITOR", runMonitor, CONFIG_TR_MONITOR_TASK_STACK, 1536},
+    };
+
+    // What the thread start costs on its own, TLS included, is not the task's
+    const size_t baseline = measure(runNothing);
+
+    printf("%-10s %6s %6s %8s %12s\n", "Task", "Stack", "Peak", "Reserve", "Recommended");
+    for (const Task& task : tasks)
+    {
+        // Twice, the first run also takes the one time initialization of the statics
+        measure(task.work);
+        const size_t measured = measure(task.work);
+        const uint32_t peak = measured > baseline ? measured - baseline : 0;
+        printf("%-10s %6u %6u %8u %12u\n", task.name, (unsigned)task.stackSize, (unsigned)peak, (unsigned)task.reserve,
+            (unsigned)profiler::recommendStackSize(peak + task.reserve, StackMarginPercent));
+        TR_CHECK(peak + task.reserve <= task.stackSize);
+    }
+    printf("Thread start %u bytes not counted (%u)\n", (unsigned)baseline, (unsigned)(g_sink % 10));
+
+    return test::finish();
+}
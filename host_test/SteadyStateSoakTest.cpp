@@ -0,0 +1,297 @@
+// Runs the steady state work of the Run state on a virtual clock for a simulated day and checks
+// that none of it touches the heap once the thread is armed, as tr::heap_guard does on the device.
+// It is the firmware code itself: the feed parsed by departures::RecordParser, the board shown by
+// app::BoardView with the timetable fallback of Reader::collectBoard(), the flushes of
+// store::flush(). Only the tasks, the HTTP client and the NVS are replaced.
+//
+// The setup (timetable image, store, dial table) allocates freely, like the boot does.
+
+#include "AllocationCounter.hpp"
+#include "Check.hpp"
+
+#include "tram_run/BoardView.hpp"
+#include "tram_run/Departures.hpp"
+#include "tram_run/Dial.hpp"
+#include "tram_run/PowerPolicy.hpp"
+#include "tram_run/Snapshot.hpp"
+#include "tram_run/Store.hpp"
+#include "tram_run/TimerWheel.hpp"
+#include "tram_run/Timetable.hpp"
+#include "tram_run/TimetableEncoder.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+namespace
+{
+    using namespace tr;
+
+    constexpr uint32_t StepMs = 100;
+    constexpr uint32_t SoakMs = 24 * 60 * 60 * 1000;
+    constexpr uint32_t FetchPeriodMs = 30 * 1000;
+    constexpr uint32_t CountdownPeriodMs = 10 * 1000;
+    constexpr uint32_t FlushPeriodMs = 60 * 1000;
+    // A day in ms wraps the tick counter when started close enough to the end of its range
+    constexpr uint32_t StartMs = UINT32_MAX - 60 * 60 * 1000;
+    constexpr uint32_t Midnight = 1700000000;
+    // The feed answers without departures for a while, the board falls back to the timetable
+    constexpr uint32_t OutageStartMs = 2 * 60 * 60 * 1000;
+    constexpr uint32_t OutageEndMs = 5 * 60 * 60 * 1000;
+    // The HTTP client hands the body over in pieces, a record may span two of them
+    constexpr size_t ChunkSize = 13;
+
+    enum Tag : uint8_t
+    {
+        Fetch,
+        Countdown,
+        Flush,
+    };
+
+    // NVS stand-in, fixed storage so that a flush does not allocate either
+    struct FakeNvs
+    {
+        uint8_t data[store::MaxKeys][store::MaxValueSize] = {};
+        size_t sizes[store::MaxKeys] = {};
+        uint32_t writes = 0;
+
+        int find(const char* _name) const
+        {
+            return _name[0] - 'a';
+        }
+    };
+
+    const char* const Names[] = {"a", "b"};
+
+    store::Backend makeBackend(FakeNvs& _nvs)
+    {
+        store::Backend backend;
+        backend.read = [&_nvs](const char* _name, void* _data, size_t& _size) {
+            const int index = _nvs.find(_name);
+            if (_nvs.sizes[index] == 0 || _nvs.sizes[index] > _size)
+                return false;
+            memcpy(_data, _nvs.data[index], _nvs.sizes[index]);
+            _size = _nvs.sizes[index];
+            return true;
+        };
+        backend.write = [&_nvs](const char* _name, const void* _data, size_t _size) {
+            const int index = _nvs.find(_name);
+            memcpy(_nvs.data[index], _data, _size);
+            _nvs.sizes[index] = _size;
+            _nvs.writes++;
+            return true;
+        };
+        backend.commit = []() { return true; };
+        return backend;
+    }
+
+    std::vector<uint8_t> buildTimetable()
+    {
+        timetable::Encoder encoder;
+        for (uint8_t stop = 0; stop < departures::MaxSources; ++stop)
+        {
+            std::vector<uint16_t> trips;
+            for (uint16_t minute = 5 * 60 + stop; minute < 25 * 60; minute += 7)
+                trips.push_back(minute);
+            encoder.addService(stop, 0x7F, "17", trips);
+        }
+        return encoder.build();
+    }
+
+    // The feed of one stop as the HTTP client gets it, the last record without its newline
+    size_t makeBody(char* _body, size_t _size, uint32_t _fetch, uint8_t _source, uint32_t _now)
+    {
+        size_t length = 0;
+        for (uint8_t i = 0; i < departures::MaxPerSource; ++i)
+        {
+            length += snprintf(_body + length, _size - length, "%s%u,%u,%u", i > 0 ? "\n" : "",
+                (unsigned)(_fetch * 64 + _source * 8 + i), 17 + _source, (unsigned)(_now + 60 + i * 97 + _source * 13));
+        }
+        return length;
+    }
+
+    // What reaches display::sendEvent() and servo::sendEvent()
+    struct Screen
+    {
+        uint32_t clears = 0;
+        uint32_t draws = 0;
+        uint32_t scrolls = 0;
+        uint32_t scheduled = 0;     // Line draws of the timetable fallback
+        uint32_t needleMoves = 0;
+        display::Event countdown;
+    };
+
+    // The timetable as schedule::getBoard() reads it, with an aggregator of its own
+    struct Fallback
+    {
+        const timetable::Reader* reader;
+        departures::Aggregator* aggregator;
+    };
+
+    struct NoLock
+    {
+        void lock() {}
+        void unlock() {}
+    };
+} // namespace
+
+int main()
+{
+    // The counter itself must see an allocation of an armed thread
+    test::armCurrentThread(true);
+    const uint64_t before = test::getAllocationCount();
+    int* volatile probe = new int(1);   // volatile so that the compiler cannot elide the pair
+    delete probe;
+    TR_CHECK(test::getAllocationCount() == before + 1);
+    test::armCurrentThread(false);
+
+    const std::vector<uint8_t> image = buildTimetable();
+    timetable::Reader reader;
+    TR_CHECK(reader.open(image.data(), image.size()));
+
+    FakeNvs nvs;
+    store::Store store(Names, 2, makeBackend(nvs), store::Policy{});
+    store.load();
+
+    dial::Table dial;
+    dial.build(dial::DefaultCalibration);
+
+    static Snapshot<departures::Board> board;
+    departures::Aggregator aggregator;
+    static departures::RecordParser parser;
+
+    departures::Aggregator scheduleAggregator;
+    const Fallback fallback = {&reader, &scheduleAggregator};
+    Screen screen;
+    Screen* shown = &screen;
+    app::BoardView view(
+        [shown](const display::Event& _event) {
+            switch (_event.type)
+            {
+                case display::Event::Type::Clear:
+                    shown->clears++;
+                    break;
+                case display::Event::Type::Draw:
+                    shown->draws++;
+                    if (_event.pos == app::BoardView::CountdownPage)
+                        shown->countdown = _event;
+                    else if (_event.getText().size() > 6 && _event.getText().substr(_event.getText().size() - 6) == " sched")
+                        shown->scheduled++;
+                    break;
+                case display::Event::Type::Scroll:
+                    shown->scrolls++;
+                    break;
+                default:
+                    break;
+            }
+        },
+        [shown](const servo::Event&) { shown->needleMoves++; },
+        [fallback](uint32_t _now, departures::Board& _board) {
+            const uint32_t minute = (_now - Midnight) / 60;
+            return fallback.reader->collectBoard(0, minute, Midnight, _now, *fallback.aggregator, _board);
+        });
+    store::Batch batch;
+    NoLock lock;
+    uint32_t clockUs = 0;
+    const auto getNowUs = [&clockUs]() { return clockUs += 700; };
+    app::TimerWheel<16> wheel(StartMs);
+    wheel.arm(StartMs, FetchPeriodMs, FetchPeriodMs, 0, Fetch);
+    wheel.arm(StartMs, CountdownPeriodMs, CountdownPeriodMs, 0, Countdown);
+    wheel.arm(StartMs, FlushPeriodMs, FlushPeriodMs, 0, Flush);
+
+    const power::PolicyConfig policy = {60, 4 * 60, 10, 5};
+
+    test::armCurrentThread(true);
+    const uint64_t armedAt = test::getAllocationCount();
+
+    uint32_t fetches = 0;
+    uint32_t countdowns = 0;
+    uint32_t flushes = 0;
+    for (uint32_t elapsed = StepMs; elapsed <= SoakMs; elapsed += StepMs)
+    {
+        const uint32_t now = StartMs + elapsed;
+        const uint32_t unixTime = Midnight + elapsed / 1000;
+
+        app::TimerWheel<16>::Expired expired;
+        while (wheel.poll(now, expired))
+        {
+            switch (expired.tag)
+            {
+                case Fetch:
+                {
+                    // What the fetcher task does with the HTTP bodies, then the main task with
+                    // the DeparturesChanged event
+                    const bool outage = elapsed >= OutageStartMs && elapsed < OutageEndMs;
+                    for (uint8_t source = 0; source < departures::MaxSources; ++source)
+                    {
+                        char body[departures::MaxPerSource * departures::RecordParser::MaxRecordLength];
+                        const size_t size = outage ? 0 : makeBody(body, sizeof(body), fetches, source, unixTime);
+                        parser.reset();
+                        for (size_t offset = 0; offset < size; offset += ChunkSize)
+                            parser.feed(body + offset, size - offset < ChunkSize ? size - offset : ChunkSize);
+                        parser.endRecord();
+                        TR_CHECK(parser.count == (outage ? 0 : departures::MaxPerSource));
+                        aggregator.update(source, parser.items, parser.count, unixTime);
+                    }
+                    aggregator.expire(unixTime);
+
+                    departures::Board* next = board.beginWrite();
+                    TR_CHECK(next != nullptr);
+                    *next = aggregator.getBoard();
+                    board.publish();
+                    fetches++;
+
+                    view.show(board.read().get(), unixTime, now, dial);
+                    break;
+                }
+                case Countdown:
+                {
+                    view.show(board.read().get(), unixTime, 0, dial);
+
+                    // The sleep decision runs on the countdown too
+                    const uint32_t secondsOfDay = elapsed / 1000;
+                    power::PolicyInput input;
+                    input.timeValid = true;
+                    input.minuteOfDay = secondsOfDay / 60;
+                    input.second = secondsOfDay % 60;
+                    power::decide(policy, input);
+
+                    store.set(0, &secondsOfDay, sizeof(secondsOfDay));
+                    countdowns++;
+                    break;
+                }
+                case Flush:
+                {
+                    store::flush(store, batch, now, false, lock, getNowUs);
+                    flushes++;
+                    break;
+                }
+            }
+        }
+    }
+
+    const uint64_t allocations = test::getAllocationCount() - armedAt;
+    test::armCurrentThread(false);
+
+    printf("%u fetches, %u countdowns, %u flushes, %u NVS writes, %llu allocations\n",
+        (unsigned)fetches, (unsigned)countdowns, (unsigned)flushes, (unsigned)nvs.writes,
+        (unsigned long long)allocations);
+    printf("%u draws (%u scheduled), %u scrolls, %u needle moves\n",
+        (unsigned)screen.draws, (unsigned)screen.scheduled, (unsigned)screen.scrolls, (unsigned)screen.needleMoves);
+
+    TR_CHECK(fetches == SoakMs / FetchPeriodMs);
+    TR_CHECK(countdowns == SoakMs / CountdownPeriodMs);
+    TR_CHECK(flushes == SoakMs / FlushPeriodMs);
+    TR_CHECK(nvs.writes > 0);
+    TR_CHECK(store.getStats().lastFlushUs == 700);
+
+    // Every fetch and countdown drew the three texts, from the timetable during the outage
+    TR_CHECK(screen.clears == 1);
+    TR_CHECK(screen.draws == 2 * (fetches + countdowns) && screen.scrolls == fetches + countdowns);
+    const uint32_t outageShows = (OutageEndMs - OutageStartMs) / FetchPeriodMs + (OutageEndMs - OutageStartMs) / CountdownPeriodMs;
+    TR_CHECK(screen.scheduled >= outageShows - 2 && screen.scheduled <= outageShows + 2);
+    TR_CHECK(screen.needleMoves > 0);
+    TR_CHECK(screen.countdown.font == display::Font::Digits32 && screen.countdown.getText().size() == 2);
+    TR_CHECK(allocations == 0);
+
+    return test::finish();
+}
@@ -0,0 +1,272 @@
+// The persistent value store on an NVS fake: the shadow, the coalesced flushes, the interval,
+// the bytes per hour cap, the forced flushes, the failed writes and the flash wear estimates
+
+#include "Check.hpp"
+
+#include "tram_run/Store.hpp"
+
+#include <string.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace
+{
+    using namespace tr::store;
+
+    constexpr uint32_t MinuteMs = 60 * 1000;
+    constexpr uint32_t HourMs = 60 * MinuteMs;
+
+    // NVS stand-in: blobs by name, written values only show up after the commit
+    struct FakeNvs
+    {
+        std::map<std::string, std::vector<uint8_t>> committed;
+        std::map<std::string, std::vector<uint8_t>> pending;
+        bool failWrites = false;
+        uint32_t writes = 0;
+        uint32_t commits = 0;
+
+        Backend makeBackend()
+        {
+            Backend backend;
+            backend.read = [this](const char* _name, void* _data, size_t& _size) {
+                auto found = committed.find(_name);
+                if (found == committed.end() || found->second.size() > _size)
+                    return false;
+                memcpy(_data, found->second.data(), found->second.size());
+                _size = found->second.size();
+                return true;
+            };
+            backend.write = [this](const char* _name, const void* _data, size_t _size) {
+                writes++;
+                if (failWrites)
+                    return false;
+                const uint8_t* bytes = static_cast<const uint8_t*>(_data);
+                pending[_name].assign(bytes, bytes + _size);
+                return true;
+            };
+            backend.commit = [this]() {
+                commits++;
+                for (auto& [name, data] : pending)
+                    committed[name] = data;
+                pending.clear();
+                return !failWrites;
+            };
+            return backend;
+        }
+    };
+
+    const char* const Names[] = {"state", "board", "servo"};
+
+    // What the persist task does, without the lock
+    bool flush(Store& _store, uint32_t _nowMs, bool _force = false)
+    {
+        Batch batch;
+        if (!_store.collect(_nowMs, _force, batch))
+            return false;
+        _store.complete(batch, _store.write(batch), 1000 + batch.count);
+        return true;
+    }
+
+    void testShadow()
+    {
+        FakeNvs nvs;
+        const uint32_t stored = 42;
+        nvs.committed["state"].assign(reinterpret_cast<const uint8_t*>(&stored),
+            reinterpret_cast<const uint8_t*>(&stored) + sizeof(stored));
+
+        Store store(Names, 3, nvs.makeBackend(), Policy{});
+        store.load();
+
+        uint32_t value = 0;
+        TR_CHECK(store.get(0, &value, sizeof(value)) && value == 42);
+        TR_CHECK(!store.isDirty());
+
+        // Missing, stored with another size, out of range
+        TR_CHECK(!store.get(1, &value, sizeof(value)));
+        uint16_t small = 0;
+        TR_CHECK(!store.get(0, &small, sizeof(small)));
+        TR_CHECK(!store.get(3, &value, sizeof(value)));
+
+        // An unchanged value is dropped, a changed one waits for the flush
+        store.set(0, &stored, sizeof(stored));
+        TR_CHECK(!store.isDirty());
+        TR_CHECK(store.getStats().sets == 1 && store.getStats().unchanged == 1);
+
+        value = 43;
+        store.set(0, &value, sizeof(value));
+        TR_CHECK(store.isDirty());
+        TR_CHECK(nvs.writes == 0);
+
+        // Too big and out of range values are refused
+        uint8_t big[MaxValueSize + 1] = {};
+        store.set(1, big, sizeof(big));
+        store.set(3, &value, sizeof(value));
+        TR_CHECK(store.getStats().sets == 2);
+        TR_CHECK(!store.get(1, big, sizeof(big)));
+    }
+
+    void testInterval()
+    {
+        FakeNvs nvs;
+        Policy policy;
+        policy.minIntervalMs = MinuteMs;
+        policy.maxBytesPerHour = 64 * 1024;
+        Store store(Names, 3, nvs.makeBackend(), policy);
+        store.load();
+
+        // Nothing to write
+        TR_CHECK(!flush(store, 0));
+
+        // The first flush goes through at once, whatever the clock
+        uint32_t now = 123456;
+        uint32_t value = 1;
+        store.set(0, &value, sizeof(value));
+        TR_CHECK(flush(store, now));
+        TR_CHECK(!store.isDirty());
+        TR_CHECK(nvs.commits == 1 && nvs.committed.count("state") == 1);
+
+        // Several sets within the interval coalesce into one write of the last value
+        for (value = 2; value <= 10; ++value)
+        {
+            store.set(0, &value, sizeof(value));
+            TR_CHECK(!flush(store, now + value * 1000));
+        }
+        TR_CHECK(!flush(store, now + MinuteMs - 1));
+        TR_CHECK(flush(store, now + MinuteMs));
+        TR_CHECK(nvs.writes == 2);
+
+        Store reloaded(Names, 3, nvs.makeBackend(), policy);
+        reloaded.load();
+        TR_CHECK(reloaded.get(0, &value, sizeof(value)) && value == 10);
+
+        // Across the wraparound of the ms clock
+        now = UINT32_MAX - 1000;
+        store.set(0, &now, sizeof(now));
+        TR_CHECK(flush(store, now));
+        store.set(0, &value, sizeof(value));
+        TR_CHECK(!flush(store, now + MinuteMs / 2));
+        TR_CHECK(flush(store, now + MinuteMs));
+
+        const Stats& stats = store.getStats();
+        TR_CHECK(stats.flushes == 4 && stats.writes == 4 && stats.forcedFlushes == 0);
+        TR_CHECK(stats.lastFlushUs == 1001 && stats.maxFlushUs == 1001);
+    }
+
+    void testCap()
+    {
+        FakeNvs nvs;
+        Policy policy;
+        policy.minIntervalMs = MinuteMs;
+        policy.maxBytesPerHour = 300;
+        Store store(Names, 3, nvs.makeBackend(), policy);
+        store.load();
+
+        // 40 bytes take 4 entries, 128 bytes of flash
+        uint8_t value[40] = {};
+        TR_CHECK(getNvsEntries(sizeof(value)) == 4);
+
+        store.set(1, value, sizeof(value));
+        TR_CHECK(flush(store, 0));
+        value[0] = 1;
+        store.set(1, value, sizeof(value));
+        TR_CHECK(flush(store, MinuteMs));
+
+        // The third one would pass 300 bytes within the hour
+        value[0] = 2;
+        store.set(1, value, sizeof(value));
+        TR_CHECK(!flush(store, 2 * MinuteMs));
+        TR_CHECK(!flush(store, 30 * MinuteMs));
+        TR_CHECK(store.getStats().deferred == 2);
+        TR_CHECK(store.isDirty());
+
+        // A forced flush skips the cap and the interval
+        TR_CHECK(flush(store, 30 * MinuteMs + 1, true));
+        TR_CHECK(store.getStats().forcedFlushes == 1);
+
+        // A new hour starts a new window
+        value[0] = 3;
+        store.set(1, value, sizeof(value));
+        TR_CHECK(!flush(store, 45 * MinuteMs));
+        TR_CHECK(flush(store, HourMs));
+
+        // A flush bigger than the whole cap still goes through once per hour
+        uint8_t big[MaxValueSize] = {};
+        store.set(0, big, sizeof(big));
+        store.set(2, big, sizeof(big));
+        TR_CHECK(!flush(store, HourMs + MinuteMs));
+        TR_CHECK(flush(store, 2 * HourMs));
+        TR_CHECK(nvs.writes == 6);
+    }
+
+    void testFailure()
+    {
+        FakeNvs nvs;
+        Policy policy;
+        policy.minIntervalMs = MinuteMs;
+        Store store(Names, 3, nvs.makeBackend(), policy);
+        store.load();
+
+        uint32_t value = 7;
+        store.set(0, &value, sizeof(value));
+        store.set(2, &value, sizeof(value));
+
+        // A failed write leaves both values dirty for the next flush
+        nvs.failWrites = true;
+        TR_CHECK(flush(store, 0));
+        TR_CHECK(store.getStats().failures == 1);
+        TR_CHECK(store.isDirty());
+
+        // A newer value set in between is the one written by the retry
+        value = 8;
+        store.set(0, &value, sizeof(value));
+        nvs.failWrites = false;
+        TR_CHECK(!flush(store, MinuteMs - 1));
+        TR_CHECK(flush(store, MinuteMs));
+        TR_CHECK(!store.isDirty());
+
+        Store reloaded(Names, 3, nvs.makeBackend(), policy);
+        reloaded.load();
+        TR_CHECK(reloaded.get(0, &value, sizeof(value)) && value == 8);
+        TR_CHECK(reloaded.get(2, &value, sizeof(value)) && value == 7);
+        TR_CHECK(store.getStats().failures == 1);
+    }
+
+    void testWear()
+    {
+        TR_CHECK(getNvsEntries(1) == 3);
+        TR_CHECK(getNvsEntries(32) == 3);
+        TR_CHECK(getNvsEntries(33) == 4);
+        TR_CHECK(getNvsEntries(MaxValueSize) == 5);
+
+        FakeNvs nvs;
+        Policy policy;
+        policy.minIntervalMs = 0;
+        policy.maxBytesPerHour = UINT32_MAX;
+        Store store(Names, 3, nvs.makeBackend(), policy);
+        store.load();
+
+        // 3 entries per write, 126 entries per page
+        for (uint32_t value = 1; value <= 420; ++value)
+        {
+            store.set(0, &value, sizeof(value));
+            TR_CHECK(flush(store, value));
+        }
+        TR_CHECK(store.getStats().nvsEntries == 1260);
+        TR_CHECK(store.getEstimatedEraseCycles(2) == 10);
+        TR_CHECK(store.getEstimatedEraseCycles(6) == 2);
+        TR_CHECK(store.getEstimatedEraseCycles(0) == 10);
+    }
+} // namespace
+
+int main()
+{
+    testShadow();
+    testInterval();
+    testCap();
+    testFailure();
+    testWear();
+
+    return tr::test::finish();
+}
@@ -0,0 +1,169 @@
+// The timer service on the esp_timer stand-in: the timeouts arrive on time through the inbox,
+// a start only reprograms the esp_timer for an earlier deadline, a cancel never does.
+// Ends with a benchmark of the service path with thousands of timers armed.
+
+#include "Check.hpp"
+
+#include "tram_run/TimerService.hpp"
+
+#include <stdio.h>
+
+#include <chrono>
+#include <vector>
+
+namespace
+{
+    using tr::app::Event;
+    using tr::app::Inbox;
+    using tr::app::Timer;
+    using tr::app::TimerService;
+
+    constexpr int64_t MsUs = 1000;
+
+    struct Fired
+    {
+        Timer timer;
+        uint8_t owner;
+        int64_t atMs;
+    };
+
+    // What the main task does with the inbox
+    void drain(Inbox& _inbox, TimerService& _service, std::vector<Fired>& _fired)
+    {
+        Event event;
+        while (_inbox.pop(event))
+        {
+            if (event.type != Event::Type::TimerTick)
+                continue;
+
+            Event timeout;
+            uint8_t owner = 0;
+            while (_service.poll(timeout, owner))
+                _fired.push_back({timeout.timer, owner, esp_timer_get_time() / MsUs});
+        }
+    }
+
+    // Runs the clock ms by ms, the way the esp_timer task and the main task take turns
+    void runUntil(int64_t _ms, Inbox& _inbox, TimerService& _service, std::vector<Fired>& _fired)
+    {
+        for (int64_t ms = esp_timer_get_time() / MsUs + 1; ms <= _ms; ++ms)
+        {
+            tr_stubAdvanceTime(ms * MsUs);
+            drain(_inbox, _service, _fired);
+        }
+    }
+
+    esp_timer* getEspTimer()
+    {
+        return tr_stubTimers().back();
+    }
+
+    void testDeadlines()
+    {
+        static Inbox inbox;
+        static TimerService service;
+        service.init(inbox);
+        esp_timer* espTimer = getEspTimer();
+        std::vector<Fired> fired;
+
+        tr_stubAdvanceTime(1000 * MsUs);
+        service.startOneShot(Timer::InitDone, 500, 1);
+        TR_CHECK(espTimer->starts == 1);
+
+        // Later deadlines leave the esp_timer alone, an earlier one moves it
+        service.startPeriodic(Timer::Countdown, 1000, 2);
+        service.startOneShot(Timer::Reboot, 2000, 2);
+        TR_CHECK(espTimer->starts == 1);
+        service.startOneShot(Timer::Fetch, 100, 1);
+        TR_CHECK(espTimer->starts == 2);
+        TR_CHECK(espTimer->deadlineUs == 1100 * MsUs);
+
+        runUntil(1600, inbox, service, fired);
+        TR_CHECK(fired.size() == 2);
+        TR_CHECK(fired[0].timer == Timer::Fetch && fired[0].atMs == 1100);
+        TR_CHECK(fired[1].timer == Timer::InitDone && fired[1].atMs == 1500);
+
+        // A cancel does not touch the esp_timer, its TimerTick finds nothing and moves on
+        const uint32_t startsBefore = espTimer->starts;
+        service.cancelOwner(2);
+        TR_CHECK(espTimer->starts == startsBefore);
+        TR_CHECK(espTimer->armed && espTimer->deadlineUs == 2000 * MsUs);
+        runUntil(2001, inbox, service, fired);
+        TR_CHECK(fired.size() == 2);
+        TR_CHECK(!espTimer->armed);
+
+        // A periodic timer keeps its phase, a cancelled one stops
+        const TimerService::Id id = service.startPeriodic(Timer::Housekeeping, 300, TimerService::GlobalOwner);
+        const TimerService::Id other = service.startOneShot(Timer::Profile, 450, 3);
+        service.cancel(other);
+        runUntil(3000, inbox, service, fired);
+        TR_CHECK(fired.size() == 5);
+        for (size_t i = 2; i < fired.size(); ++i)
+            TR_CHECK(fired[i].timer == Timer::Housekeeping && fired[i].atMs == 2001 + 300 * int64_t(i - 1));
+        service.cancel(id);
+        runUntil(4000, inbox, service, fired);
+        TR_CHECK(fired.size() == 5);
+    }
+
+    void benchmark()
+    {
+        using Clock = std::chrono::steady_clock;
+        constexpr unsigned Armed = 4000;
+        constexpr unsigned Operations = 200000;
+        static_assert(Armed < CONFIG_TR_TIMER_CAPACITY);
+
+        static Inbox inbox;
+        static TimerService service;
+        service.init(inbox);
+        esp_timer* espTimer = getEspTimer();
+        std::vector<Fired> fired;
+        tr_stubAdvanceTime(10000 * MsUs);
+
+        // Thousands of timers spread over the wheel and over the owners
+        for (unsigned i = 0; i < Armed; ++i)
+            service.startOneShot(Timer::Countdown, 60000 + i * 37, 16 + i % 200);
+        const uint32_t startsArmed = espTimer->starts;
+
+        auto start = Clock::now();
+        for (unsigned i = 0; i < Operations; ++i)
+            service.cancel(service.startOneShot(Timer::Fetch, 70000 + i % 5000, 1));
+        const double startCancelNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / Operations;
+        TR_CHECK(espTimer->starts == startsArmed);
+
+        // A state exit with a few timers of its own among the thousands
+        start = Clock::now();
+        for (unsigned i = 0; i < Operations / 10; ++i)
+        {
+            service.startOneShot(Timer::CalibrationIdle, 60000, 2);
+            service.startPeriodic(Timer::Countdown, 10000, 2);
+            service.startOneShot(Timer::Reboot, 5000, 2);
+            service.cancelOwner(2);
+        }
+        const double exitNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / (Operations / 10);
+
+        // Only the first Countdown and Reboot timers were earlier than everything armed
+        TR_CHECK(espTimer->starts == startsArmed + 2);
+
+        // Every timer still fires once, on time, rounded up to the resolution
+        runUntil(10000 + 60000 + Armed * 37 + TimerService::ResolutionMs, inbox, service, fired);
+        TR_CHECK(fired.size() == Armed);
+        bool onTime = true;
+        for (size_t i = 0; i < fired.size(); ++i)
+        {
+            const int64_t delayMs = 60000 + int64_t(i) * 37;
+            const int64_t resolution = TimerService::ResolutionMs;
+            onTime &= fired[i].atMs == 10000 + (delayMs + resolution - 1) / resolution * resolution;
+        }
+        TR_CHECK(onTime);
+
+        printf("%u timers armed: start + cancel %.1f ns, 3 starts + cancelOwner %.1f ns\n",
+            Armed, startCancelNs, exitNs);
+    }
+} // namespace
+
+int main()
+{
+    testDeadlines();
+    benchmark();
+    return tr::test::finish();
+}
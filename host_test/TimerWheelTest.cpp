@@ -0,0 +1,209 @@
+// Timers fire on the exact tick, also across the wraparound of the tick counter, checked against
+// a plain list of deadlines. Ends with a rough benchmark of arm, cancel and poll.
+
+#include "Check.hpp"
+
+#include "tram_run/TimerWheel.hpp"
+
+#include <stdio.h>
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+namespace
+{
+    using tr::app::TimerWheel;
+
+    constexpr uint32_t NearWrap = UINT32_MAX - 5;
+
+    void testExactTick()
+    {
+        const uint32_t starts[] = {0, 1000, NearWrap, UINT32_MAX};
+        const uint32_t delays[] = {1, 2, 7, 255, 256, 257, 511, 512, 3 * 256 + 7, 100000};
+        for (uint32_t start : starts)
+        {
+            for (uint32_t delay : delays)
+            {
+                TimerWheel<4> wheel(start);
+                const auto id = wheel.arm(start, delay, 0, 1, 2);
+                TR_CHECK(wheel.getTicksToNext() == delay);
+
+                TimerWheel<4>::Expired expired;
+                TR_CHECK(!wheel.poll(start + delay - 1, expired));
+                TR_CHECK(wheel.getTicksToNext() == 1);
+                TR_CHECK(wheel.poll(start + delay, expired));
+                TR_CHECK(expired.id == id && expired.owner == 1 && expired.tag == 2);
+                TR_CHECK(!wheel.poll(start + delay, expired));
+                TR_CHECK(wheel.getArmedCount() == 0);
+                TR_CHECK(wheel.getTicksToNext() == UINT32_MAX);
+            }
+        }
+
+        // A zero delay fires on the next tick
+        TimerWheel<4> wheel(NearWrap);
+        TimerWheel<4>::Expired expired;
+        wheel.arm(NearWrap, 0, 0, 0, 0);
+        TR_CHECK(!wheel.poll(NearWrap, expired));
+        TR_CHECK(wheel.poll(NearWrap + 1, expired));
+    }
+
+    void testPeriodic()
+    {
+        // Ticks one by one across the wraparound, a period of 3 fires on every third one
+        TimerWheel<4, 8> wheel(NearWrap);
+        TimerWheel<4, 8>::Expired expired;
+        wheel.arm(NearWrap, 3, 3, 0, 0);
+
+        uint32_t fired = 0;
+        for (uint32_t step = 1; step <= 30; ++step)
+        {
+            const uint32_t now = NearWrap + step;
+            bool any = false;
+            while (wheel.poll(now, expired))
+            {
+                any = true;
+                fired++;
+            }
+            TR_CHECK(any == (step % 3 == 0));
+        }
+        TR_CHECK(fired == 10);
+
+        // A late poll returns each missed period once and keeps the phase
+        TimerWheel<4> late(0);
+        TimerWheel<4>::Expired lateExpired;
+        late.arm(0, 10, 10, 0, 0);
+        fired = 0;
+        while (late.poll(35, lateExpired))
+            fired++;
+        TR_CHECK(fired == 3);
+        TR_CHECK(late.getTicksToNext() == 5);
+    }
+
+    void testCancel()
+    {
+        TimerWheel<2> wheel(NearWrap);
+        TimerWheel<2>::Expired expired;
+
+        const auto a = wheel.arm(NearWrap, 10, 0, 1, 0);
+        const auto b = wheel.arm(NearWrap, 10, 0, 2, 0);
+        TR_CHECK(wheel.arm(NearWrap, 10, 0, 3, 0) == TimerWheel<2>::InvalidId);
+
+        wheel.cancel(a);
+        TR_CHECK(wheel.poll(NearWrap + 10, expired) && expired.id == b);
+        TR_CHECK(!wheel.poll(NearWrap + 10, expired));
+
+        // The pool slot of b comes back with another id, the stale one does not cancel it
+        const auto c = wheel.arm(NearWrap + 10, 5, 0, 2, 0);
+        TR_CHECK(c != b);
+        wheel.cancel(b);
+        TR_CHECK(wheel.poll(NearWrap + 15, expired) && expired.id == c);
+
+        wheel.arm(NearWrap + 15, 5, 5, 7, 0);
+        wheel.arm(NearWrap + 15, 6, 0, 7, 0);
+        wheel.cancelOwner(7);
+        TR_CHECK(wheel.getArmedCount() == 0);
+        TR_CHECK(!wheel.poll(NearWrap + 100, expired));
+    }
+
+    // Random arms, cancels and polls against a list of deadlines
+    void testAgainstModel()
+    {
+        struct Armed
+        {
+            TimerWheel<64>::Id id;
+            uint32_t deadline;
+            uint32_t period;
+        };
+
+        std::mt19937 random(12345);
+        uint32_t now = UINT32_MAX - 50000;
+        TimerWheel<64> wheel(now);
+        std::vector<Armed> model;
+        unsigned fired = 0;
+
+        for (unsigned round = 0; round < 20000; ++round)
+        {
+            const unsigned action = random() % 10;
+            if (action < 4 && model.size() < 64)
+            {
+                const uint32_t delay = random() % 3 == 0 ? random() % 2000 : random() % 40;
+                const uint32_t period = random() % 4 == 0 ? 1 + random() % 300 : 0;
+                const auto id = wheel.arm(now, delay, period, 0, 0);
+                TR_CHECK(id != TimerWheel<64>::InvalidId);
+                model.push_back({id, now + (delay == 0 ? 1 : delay), period});
+            }
+            else if (action < 5 && !model.empty())
+            {
+                const size_t index = random() % model.size();
+                wheel.cancel(model[index].id);
+                model.erase(model.begin() + index);
+            }
+            else
+            {
+                now += random() % 50;
+                TimerWheel<64>::Expired expired;
+                while (wheel.poll(now, expired))
+                {
+                    fired++;
+                    bool found = false;
+                    for (size_t i = 0; i < model.size() && !found; ++i)
+                    {
+                        if (model[i].id != expired.id)
+                            continue;
+                        found = true;
+                        TR_CHECK(model[i].deadline == wheel.getNow());
+                        if (model[i].period > 0)
+                            model[i].deadline += model[i].period;
+                        else
+                            model.erase(model.begin() + i);
+                    }
+                    TR_CHECK(found);
+                }
+
+                // Nothing overdue is left behind
+                for (const Armed& armed : model)
+                    TR_CHECK(armed.deadline - now - 1 < UINT32_MAX / 2);
+            }
+            TR_CHECK(wheel.getArmedCount() == model.size());
+        }
+        TR_CHECK(fired > 1000);
+    }
+
+    void benchmark()
+    {
+        using Clock = std::chrono::steady_clock;
+        constexpr unsigned Operations = 1000000;
+
+        TimerWheel<32> wheel(NearWrap);
+        TimerWheel<32>::Expired expired;
+
+        auto start = Clock::now();
+        for (unsigned i = 0; i < Operations; ++i)
+            wheel.cancel(wheel.arm(NearWrap, 1 + i % 1000, 0, 0, 0));
+        const double armNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / Operations;
+
+        for (unsigned i = 0; i < 16; ++i)
+            wheel.arm(NearWrap, 1 + i * 37, 100 + i, 0, 0);
+        unsigned fired = 0;
+        start = Clock::now();
+        for (unsigned tick = 1; tick <= Operations; ++tick)
+        {
+            while (wheel.poll(NearWrap + tick, expired))
+                fired++;
+        }
+        const double pollNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / Operations;
+
+        printf("arm + cancel %.1f ns, poll %.1f ns per tick with 16 periodic timers (%u fired)\n", armNs, pollNs, fired);
+    }
+} // namespace
+
+int main()
+{
+    testExactTick();
+    testPeriodic();
+    testCancel();
+    testAgainstModel();
+    benchmark();
+    return tr::test::finish();
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <stdlib.h>
+
+typedef int esp_err_t;
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_INVALID_STATE 0x103
+
+#define ESP_ERROR_CHECK(_expression) do { if ((_expression) != ESP_OK) abort(); } while (0)
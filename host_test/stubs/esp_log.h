@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stdarg.h>
+#include <stdio.h>
+
+// Not checked as a format on purpose: the firmware prints uint32_t with %lu, as it is on the device
+inline void tr_stubLog(char _level, const char* _tag, const char* _format, ...)
+{
+    va_list args;
+    va_start(args, _format);
+    printf("%c %s: ", _level, _tag);
+    vprintf(_format, args);
+    printf("\n");
+    va_end(args);
+}
+
+#define ESP_LOGE(_tag, ...) tr_stubLog('E', _tag, __VA_ARGS__)
+#define ESP_LOGW(_tag, ...) tr_stubLog('W', _tag, __VA_ARGS__)
+#define ESP_LOGI(_tag, ...) tr_stubLog('I', _tag, __VA_ARGS__)
+#define ESP_LOGD(_tag, ...) do { } while (0)
@@ -0,0 +1,96 @@
+#pragma once
+
+// esp_timer on a virtual microsecond clock. The timers only fire from tr_stubAdvanceTime(),
+// on the calling thread, in place of the esp_timer task.
+
+#include "esp_err.h"
+
+#include <stdint.h>
+
+#include <vector>
+
+typedef void (*esp_timer_cb_t)(void* _arg);
+
+typedef enum
+{
+    ESP_TIMER_TASK,
+} esp_timer_dispatch_t;
+
+typedef struct
+{
+    esp_timer_cb_t callback;
+    void* arg;
+    esp_timer_dispatch_t dispatch_method;
+    const char* name;
+    bool skip_unhandled_events;
+} esp_timer_create_args_t;
+
+struct esp_timer
+{
+    esp_timer_cb_t callback = nullptr;
+    void* arg = nullptr;
+    bool armed = false;
+    int64_t deadlineUs = 0;
+    uint32_t starts = 0;    // esp_timer_start_once() calls, the reprogramming cost
+};
+
+typedef esp_timer* esp_timer_handle_t;
+
+inline int64_t& tr_stubTimeUs()
+{
+    static int64_t timeUs = 0;
+    return timeUs;
+}
+
+inline std::vector<esp_timer*>& tr_stubTimers()
+{
+    static std::vector<esp_timer*> timers;
+    return timers;
+}
+
+inline int64_t esp_timer_get_time()
+{
+    return tr_stubTimeUs();
+}
+
+inline esp_err_t esp_timer_create(const esp_timer_create_args_t* _args, esp_timer_handle_t* _handle)
+{
+    esp_timer* timer = new esp_timer;
+    timer->callback = _args->callback;
+    timer->arg = _args->arg;
+    tr_stubTimers().push_back(timer);
+    *_handle = timer;
+    return ESP_OK;
+}
+
+inline esp_err_t esp_timer_start_once(esp_timer_handle_t _timer, uint64_t _timeoutUs)
+{
+    if (_timer->armed)
+        return ESP_ERR_INVALID_STATE;
+    _timer->armed = true;
+    _timer->deadlineUs = tr_stubTimeUs() + _timeoutUs;
+    _timer->starts++;
+    return ESP_OK;
+}
+
+inline esp_err_t esp_timer_stop(esp_timer_handle_t _timer)
+{
+    if (!_timer->armed)
+        return ESP_ERR_INVALID_STATE;
+    _timer->armed = false;
+    return ESP_OK;
+}
+
+// Moves the clock to _timeUs and fires the timers due by then
+inline void tr_stubAdvanceTime(int64_t _timeUs)
+{
+    tr_stubTimeUs() = _timeUs;
+    for (esp_timer* timer : tr_stubTimers())
+    {
+        if (timer->armed && timer->deadlineUs <= _timeUs)
+        {
+            timer->armed = false;
+            timer->callback(timer->arg);
+        }
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+// The few FreeRTOS definitions the host tests need, on top of std::thread. One tick is one ms.
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <thread>
+
+typedef int BaseType_t;
+typedef uint32_t UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define portMAX_DELAY ((TickType_t)0xFFFFFFFF)
+#define pdMS_TO_TICKS(_ms) ((TickType_t)(_ms))
+#define configASSERT(_condition) do { if (!(_condition)) abort(); } while (0)
+
+// A spinlock, as on the device
+struct portMUX_TYPE
+{
+    std::atomic<bool> locked;
+};
+
+#define portMUX_INITIALIZER_UNLOCKED {}
+
+inline void tr_stubEnterCritical(portMUX_TYPE* _mux)
+{
+    while (_mux->locked.exchange(true, std::memory_order_acquire))
+        std::this_thread::yield();
+}
+
+inline void tr_stubExitCritical(portMUX_TYPE* _mux)
+{
+    _mux->locked.store(false, std::memory_order_release);
+}
+
+#define taskENTER_CRITICAL(_mux) tr_stubEnterCritical(_mux)
+#define taskEXIT_CRITICAL(_mux) tr_stubExitCritical(_mux)
+#define taskENTER_CRITICAL_ISR(_mux) tr_stubEnterCritical(_mux)
+#define taskEXIT_CRITICAL_ISR(_mux) tr_stubExitCritical(_mux)
+
+// A test thread sets it to play an interrupt handler
+inline thread_local bool t_stubInIsr = false;
+
+inline BaseType_t xPortInIsrContext()
+{
+    return t_stubInIsr ? pdTRUE : pdFALSE;
+}
+
+#define portYIELD_FROM_ISR(_woken) (void)(_woken)
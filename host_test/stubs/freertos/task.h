@@ -0,0 +1,50 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+// The task notification value of a host thread, the only part of a task the host tests need
+struct tskTaskControlBlock
+{
+    std::mutex mutex;
+    std::condition_variable changed;
+    uint32_t notifications = 0;
+};
+
+typedef tskTaskControlBlock* TaskHandle_t;
+
+inline BaseType_t xTaskNotifyGive(TaskHandle_t _task)
+{
+    {
+        std::lock_guard<std::mutex> lock(_task->mutex);
+        _task->notifications++;
+    }
+    _task->changed.notify_one();
+    return pdTRUE;
+}
+
+inline void vTaskNotifyGiveFromISR(TaskHandle_t _task, BaseType_t* _higherPriorityTaskWoken)
+{
+    xTaskNotifyGive(_task);
+    if (_higherPriorityTaskWoken != nullptr)
+        *_higherPriorityTaskWoken = pdTRUE;
+}
+
+// Unlike the device, the task is passed explicitly: a host thread has no handle of its own
+inline uint32_t ulTaskNotifyTakeFor(TaskHandle_t _task, BaseType_t _clear, TickType_t _timeout)
+{
+    std::unique_lock<std::mutex> lock(_task->mutex);
+    const auto ready = [_task]() { return _task->notifications > 0; };
+    if (_timeout == portMAX_DELAY)
+        _task->changed.wait(lock, ready);
+    else
+        _task->changed.wait_for(lock, std::chrono::milliseconds(_timeout), ready);
+
+    const uint32_t value = _task->notifications;
+    if (value > 0)
+        _task->notifications = _clear ? 0 : value - 1;
+    return value;
+}
@@ -0,0 +1,3 @@
+#pragma once
+
+// The CONFIG_ values the host tests need come from compile definitions, see CMakeLists.txt
@@ -1,36 +1,112 @@
 #include "App.hpp"
 
+#include "tram_run/Dial.hpp"
 #include "tram_run/Display.hpp"
+#include "tram_run/FanOut.hpp"
+#include "tram_run/Fetcher.hpp"
+#include "tram_run/Font.hpp"
+#include "tram_run/HeapGuard.hpp"
 #include "tram_run/Input.hpp"
+#include "tram_run/Monitor.hpp"
+#include "tram_run/Persist.hpp"
+#include "tram_run/Power.hpp"
+#include "tram_run/Profiler.hpp"
+#include "tram_run/Rtos.hpp"
+#include "tram_run/Schedule.hpp"
 #include "tram_run/Servo.hpp"
 #include "tram_run/Wifi.hpp"
 
+#include "sdkconfig.h"
+
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
 #include "esp_system.h"
 #include "esp_log.h"
+#include "esp_ota_ops.h"
 #include "esp_wifi.h"
 
+#include <stdio.h>
+#include <time.h>
+
 namespace
 {
     static const char* TAG = "TR_APP";
 
-    const char* INIT_TEXT = "Init";
-    const char* WIFI_TEXT = "Wifi";
-    const char* RUN_TEXT = "Run";
+    constexpr const char* INIT_TEXT = "Init";
+    constexpr const char* WIFI_TEXT = "Wifi";
+    constexpr const char* RUN_TEXT = "Run";
+    constexpr const char* UPDATE_TEXT = "Update";
+    constexpr const char* REBOOT_TEXT = "Reboot";
+
+    constexpr uint8_t StateTextPage = 3;
+    constexpr uint8_t INIT_TEXT_COLUMN = tr::display::font::Small.centerColumn(INIT_TEXT);
+    constexpr uint8_t WIFI_TEXT_COLUMN = tr::display::font::Small.centerColumn(WIFI_TEXT);
+    constexpr uint8_t RUN_TEXT_COLUMN = tr::display::font::Small.centerColumn(RUN_TEXT);
+    constexpr uint8_t UPDATE_TEXT_COLUMN = tr::display::font::Small.centerColumn(UPDATE_TEXT);
+    constexpr uint8_t REBOOT_TEXT_COLUMN = tr::display::font::Small.centerColumn(REBOOT_TEXT);
+
+    // Calibration: a press nudges the needle, a long press accepts the point
+    constexpr uint8_t CalibrationValuePage = 5;
+    constexpr uint16_t CalibrationStepTicks = 20;
+    constexpr uint16_t CalibrationStartBackSteps = 5;
+    constexpr uint32_t CalibrationIdleMs = 60 * 1000;
 
     constexpr gpio_num_t ButtonGpio = GPIO_NUM_19;
+    constexpr uint32_t InitSplashMs = 5000;
+    constexpr uint32_t RebootDelayMs = 2000;
+    constexpr uint32_t FetchPeriodMs = CONFIG_TR_FETCH_PERIOD_S * 1000;
+    constexpr uint32_t CountdownPeriodMs = 10 * 1000;
+
+    // Deadline budgets, see Monitor.hpp. An event may wait for room in the display queue.
+    constexpr uint32_t MainBudgetMs = 500;
+    constexpr uint32_t ScreenBudgetMs = 300;
+    constexpr uint32_t PointerBudgetMs = 200;
+
+    // Profiling scenario, it starts once the boot and the Wi-Fi connection had the time to happen
+    enum class ProfileStep : uint8_t
+    {
+        Buttons,
+        Display,
+        Servo,
+        Fetch,
+        Report,
+        Done,
+    };
+    constexpr uint32_t ProfileStartMs = 30 * 1000;
+    constexpr uint32_t ProfileStepMs = 2000;
+    constexpr uint32_t ProfileSettleMs = 15 * 1000;
+    constexpr uint8_t ProfileButtonPresses = 20;
+    constexpr const char* PROFILE_SCROLL_TEXT = "17 12  9 15  3 21  17 27  9 33";
+    constexpr uint32_t HousekeepingPeriodMs = 60 * 1000;
+    constexpr uint32_t ReportPeriodMs = 60 * 60 * 1000;
+
+    uint8_t toOwner(tr::state::Id _state)
+    {
+        return static_cast<uint8_t>(_state);
+    }
+
+    static tr::rtos::StaticTask<CONFIG_TR_MAIN_TASK_STACK> g_mainTaskStorage;
 } // namespace
 
 namespace tr::app
 {
-    App::App() = default;
+    App::App()
+        : m_boardView{display::sendEvent, servo::sendEvent, [](uint32_t _now, departures::Board& _board) {
+            return schedule::getBoard(_now, _board);
+        }}
+    {
+    }
+
     App::~App() = default;
 
     void App::start()
     {
-        // TODO make the stack size smaller by measuring the watermark
+        power::init();
+        monitor::init();
+        monitor::addPath(monitor::Path::Screen, ScreenBudgetMs);
+        monitor::addPath(monitor::Path::Pointer, PointerBudgetMs);
+        persist::init();
 
         ESP_ERROR_CHECK(esp_netif_init());
         ESP_ERROR_CHECK(esp_event_loop_create_default());
@@ -59,38 +135,134 @@ namespace tr::app
             }
         );
         servo::init();
+        if (!persist::get(persist::Key::ServoCalibration, m_calibration) || !dial::isValid(m_calibration))
+            m_calibration = dial::DefaultCalibration;
+        m_dial.build(m_calibration);
+        schedule::init();
+        fetcher::init(
+            [this](){
+                this->onDeparturesChanged();
+            }
+        );
 
-        configASSERT(m_queue == nullptr);
-        m_queue = xQueueCreate(5, sizeof(Event));
-        configASSERT(m_queue != nullptr);
-
-        BaseType_t ret = xTaskCreate(&mainTask, "mainTask", 2048, this, 6, NULL);
-        configASSERT(ret == pdPASS);
+        m_timers.init(m_inbox);
+        const TaskHandle_t task = g_mainTaskStorage.create(&mainTask, "mainTask", this, 6);
+        monitor::addTask(monitor::Task::Main, task, nullptr, MainBudgetMs);
     }
 
     void App::mainTask(void* _pvParameter)
     {
-        TickType_t xLastWakeTime = xTaskGetTickCount();
-        const TickType_t xFrequency = pdMS_TO_TICKS(1000);
-
         App& app = *static_cast<App*>(_pvParameter);
-
-        app.m_state = state::Id::Init;
+        app.m_inbox.setReceiver(xTaskGetCurrentTaskHandle());
+
+        app.m_timers.startPeriodic(Timer::Housekeeping, HousekeepingPeriodMs, TimerService::GlobalOwner);
+        app.m_timers.startPeriodic(Timer::Report, ReportPeriodMs, TimerService::GlobalOwner);
+#if CONFIG_TR_PROFILE
+        app.m_timers.startOneShot(Timer::Profile, ProfileStartMs, TimerService::GlobalOwner);
+#endif
+
+        // Waking up from the overnight deep sleep (the state is in RTC memory) or reset while running
+        // (watchdog, update, the state is in NVS), the hardware is known to be fine. A power-on always
+        // shows the splash, it is the way into Calibrate.
+        state::Id lastState = power::getRetained().state;
+        if (!power::isWarmBoot() && !power::isPowerOnReset())
+            persist::get(persist::Key::State, lastState);
+        const bool resume = lastState == state::Id::Run || lastState == state::Id::ConnectingToWifi;
+        app.m_state = resume ? state::Id::ConnectingToWifi : state::Id::Init;
         app.transit(state::Transit::Enter);
-    
+
         while (true)
         {
-            Event event;
-            while (xQueueReceive(app.m_queue, &event, 0))
+            app.handleInbox();
+            // Nothing runs periodically here, the task sleeps until a post or a timer
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        }
+    }
+
+    void App::handleInbox()
+    {
+        Event event;
+        while (m_inbox.pop(event))
+        {
+            ESP_LOGI(TAG, "Handling %d ", (int)event.type);
+            if (event.type == Event::Type::ButtonPress || event.type == Event::Type::ButtonLongPress)
+                power::notifyActivity();
+
+            if (event.type != Event::Type::TimerTick)
+            {
+                beginSpan();
+                dispatchAndTransit(event);
+                endSpan();
+                continue;
+            }
+
+            Event timeout;
+            uint8_t owner = 0;
+            while (m_timers.poll(timeout, owner))
             {
-                ESP_LOGI(TAG, "Handling %d ", (int)event.type);
-                app.dispatchAndTransit(event);
+                beginSpan();
+                if (owner == TimerService::GlobalOwner)
+                    handleGlobalTimeout(timeout);
+                else if (owner == toOwner(m_state))
+                    dispatchAndTransit(timeout);
+                endSpan();
             }
+        }
+    }
+
+    void App::beginSpan()
+    {
+        monitor::begin(monitor::Task::Main);
+        m_inSpan = true;
+    }
+
+    void App::endSpan()
+    {
+        m_inSpan = false;
+        monitor::end(monitor::Task::Main);
+    }
+
+    void App::flushPersist()
+    {
+        // The forced flush waits up to 2 s for the persist task, that wait is not the work of
+        // the event and stays out of the Main span
+        if (m_inSpan)
+            monitor::end(monitor::Task::Main);
+        persist::flush();
+        if (m_inSpan)
+            monitor::begin(monitor::Task::Main);
+    }
+
+    void App::handleGlobalTimeout(const Event& _event)
+    {
+        switch (_event.timer)
+        {
+            case Timer::Housekeeping:
+            {
+                const power::Decision decision = power::evaluate();
+                if (decision.mode == power::Mode::DeepSleep)
+                    enterDeepSleep(decision.sleepSeconds);
 
-            event.type = Event::Type::Tick;
-            app.dispatchAndTransit(event);
-            
-            vTaskDelayUntil( &xLastWakeTime, xFrequency );
+                if (heap_guard::getViolationCount() != m_heapViolations)
+                {
+                    m_heapViolations = heap_guard::getViolationCount();
+                    ESP_LOGW(TAG, "Heap allocations after boot: %lu", m_heapViolations);
+                }
+                break;
+            }
+            case Timer::Report:
+                power::report();
+                persist::report();
+                fanout::report();
+                monitor::report();
+                m_inbox.logStats();
+                break;
+            case Timer::Profile:
+                runProfileStep();
+                break;
+            default:
+                configASSERT(false);
+                break;
         }
     }
 
@@ -112,6 +284,12 @@ namespace tr::app
         case state::Id::Run:
             transitRunState(_transit);
             break;
+        case state::Id::Update:
+            transitUpdateState(_transit);
+            break;
+        case state::Id::Calibrate:
+            transitCalibrateState(_transit);
+            break;
         }
     }
 
@@ -121,15 +299,19 @@ namespace tr::app
         {
             case state::Transit::Enter:
                 {
+                    m_timers.startOneShot(Timer::InitDone, InitSplashMs, toOwner(state::Id::Init));
+
                     display::Event event;
                     event.type = display::Event::Type::DrawAndClear;
-                    event.text = INIT_TEXT;
-                    event.length = 4;
+                    event.setText(INIT_TEXT);
+                    event.font = display::Font::Small;
+                    event.pos = StateTextPage;
+                    event.column = INIT_TEXT_COLUMN;
                     display::sendEvent(event);
                 }
                 {
                     servo::Event event;
-                    event.desiredRotationDeg = 10;
+                    event.compareTicks = servo::toCompareTicks(10);
                     servo::sendEvent(event);
                 }
                 break;
@@ -148,9 +330,13 @@ namespace tr::app
 
                 display::Event event;
                 event.type = display::Event::Type::DrawAndClear;
-                event.text = WIFI_TEXT;
-                event.length = 4;
+                event.setText(WIFI_TEXT);
+                event.font = display::Font::Small;
+                event.pos = StateTextPage;
+                event.column = WIFI_TEXT_COLUMN;
                 display::sendEvent(event);
+                m_boardView.invalidateScreen();
+                m_boardView.invalidateNeedle();
                 break;
             }
             case state::Transit::Exit:
@@ -164,19 +350,81 @@ namespace tr::app
         {
             case state::Transit::Enter:
                 {
+                    // Reaching Run proves the new image works, otherwise the bootloader rolls it back
+                    esp_ota_mark_app_valid_cancel_rollback();
+
                     display::Event event;
                     event.type = display::Event::Type::DrawAndClear;
-                    event.text = RUN_TEXT;
-                    event.length = 3;
+                    event.setText(RUN_TEXT);
+                    event.font = display::Font::Small;
+                    event.pos = StateTextPage;
+                    event.column = RUN_TEXT_COLUMN;
                     display::sendEvent(event);
                 }
                 {
                     servo::Event event;
-                    event.desiredRotationDeg = 70;
+                    event.compareTicks = servo::toCompareTicks(70);
                     servo::sendEvent(event);
                 }
+                m_boardView.invalidateScreen();
+                m_boardView.invalidateNeedle();
+
+                fetcher::request();
+                m_timers.startPeriodic(Timer::Fetch, FetchPeriodMs, toOwner(state::Id::Run));
+                m_timers.startPeriodic(Timer::Countdown, CountdownPeriodMs, toOwner(state::Id::Run));
+
+                // The Wi-Fi start and the SNTP init on the way here allocate from this task,
+                // from now on nothing should
+                heap_guard::armCurrentTask();
+                break;
+            case state::Transit::Exit:
+                break;
+        }
+    }
+
+    void App::transitUpdateState(state::Transit _transit)
+    {
+        switch (_transit)
+        {
+            case state::Transit::Enter:
+            {
+                power::setBusy(true);
+                // The update ends with a reboot, nothing pending may be lost
+                flushPersist();
+                ota::start(
+                    [this](ota::Result _result){
+                        this->onOtaDone(_result);
+                    }
+                );
+
+                display::Event event;
+                event.type = display::Event::Type::DrawAndClear;
+                event.setText(UPDATE_TEXT);
+                event.font = display::Font::Small;
+                event.pos = StateTextPage;
+                event.column = UPDATE_TEXT_COLUMN;
+                display::sendEvent(event);
+                break;
+            }
+            case state::Transit::Exit:
+                power::setBusy(false);
+                break;
+        }
+    }
+
+    void App::transitCalibrateState(state::Transit _transit)
+    {
+        switch (_transit)
+        {
+            case state::Transit::Enter:
+                // The current calibration gives the starting positions
+                m_calibrationPoint = 0;
+                m_calibrationIdleTimer = m_timers.startOneShot(Timer::CalibrationIdle, CalibrationIdleMs, toOwner(state::Id::Calibrate));
+                startCalibrationPoint();
                 break;
             case state::Transit::Exit:
+                // Aborted or done, either way the needle positions come from the table again
+                m_boardView.invalidateNeedle();
                 break;
         }
     }
@@ -195,32 +443,61 @@ namespace tr::app
             case state::Id::Run:
                 status = dispatchRunState(_event);
                 break;
+            case state::Id::Update:
+                status = dispatchUpdateState(_event);
+                break;
+            case state::Id::Calibrate:
+                status = dispatchCalibrateState(_event);
+                break;
         }
         if (status.isTransitRequested())
         {
             ESP_LOGI(TAG, "Transiting %d ", (int)status.nextState);
             configASSERT(m_state != status.nextState);
             transit(state::Transit::Exit);
+            m_timers.cancelOwner(toOwner(m_state));
             m_state = status.nextState;
             transit(state::Transit::Enter);
+
+            power::getRetained().state = m_state;
+            persist::set(persist::Key::State, m_state);
         }
     }
 
+    void App::enterDeepSleep(uint32_t _seconds)
+    {
+        transit(state::Transit::Exit);
+
+        display::Event event;
+        event.type = display::Event::Type::Clear;
+        display::sendEvent(event);
+        // Give the display task the time to blank the panel
+        vTaskDelay(pdMS_TO_TICKS(100));
+
+        // Shown again right after the wake-up, before the first fetch
+        power::getRetained().board = *fetcher::readBoard();
+
+        power::report();
+        flushPersist();
+        power::enterDeepSleep(_seconds);
+    }
+
     state::Status App::dispatchInitState(const Event& _event)
     {
         state::Status status;
 
         switch (_event.type)
         {
-            case Event::Type::Tick:
+            case Event::Type::ButtonPress:
             {
-                static int ii = 5;
-                --ii;
-                if (ii < 0)
-                {
-                    ii = 5;
+                // A press during the splash calibrates the dial
+                status = state::Status(state::Id::Calibrate);
+                break;
+            }
+            case Event::Type::Timeout:
+            {
+                if (_event.timer == Timer::InitDone)
                     status = state::Status(state::Id::ConnectingToWifi);
-                }
                 break;
             }
             default:
@@ -236,12 +513,24 @@ namespace tr::app
         {
             case Event::Type::WifiReady:
             {
+                power::onNetworkReady();
+                fanout::start();
                 status = state::Status(state::Id::Run);
                 break;
             }
             case Event::Type::WifiFail:
             {
                 ESP_LOGE(TAG, "Unable to connect to WIFI!");
+
+                // Fall back to the timetable in flash
+                showBoard(0);
+                m_timers.startPeriodic(Timer::Countdown, CountdownPeriodMs, toOwner(state::Id::ConnectingToWifi));
+                break;
+            }
+            case Event::Type::Timeout:
+            {
+                if (_event.timer == Timer::Countdown)
+                    showBoard(0);
                 break;
             }
             default:
@@ -253,7 +542,122 @@ namespace tr::app
     state::Status App::dispatchRunState(const Event& _event)
     {
         state::Status status;
+        switch (_event.type)
+        {
+            case Event::Type::ButtonLongPress:
+            {
+                status = state::Status(state::Id::Update);
+                break;
+            }
+            case Event::Type::DeparturesChanged:
+            {
+                showBoard(fetcher::getArrivalUs());
+                break;
+            }
+            case Event::Type::Timeout:
+            {
+                if (_event.timer == Timer::Fetch)
+                    fetcher::request();
+                else if (_event.timer == Timer::Countdown)
+                    showBoard(0);
+                break;
+            }
+            default:
+                break;
+        }
+        return status;
+    }
 
+    state::Status App::dispatchUpdateState(const Event& _event)
+    {
+        state::Status status;
+        switch (_event.type)
+        {
+            case Event::Type::OtaDone:
+            {
+                display::Event event;
+                event.type = display::Event::Type::DrawAndClear;
+                event.setText(REBOOT_TEXT);
+                event.font = display::Font::Small;
+                event.pos = StateTextPage;
+                event.column = REBOOT_TEXT_COLUMN;
+                display::sendEvent(event);
+
+                m_timers.startOneShot(Timer::Reboot, RebootDelayMs, toOwner(state::Id::Update));
+                break;
+            }
+            case Event::Type::OtaFail:
+            {
+                ESP_LOGE(TAG, "Update failed!");
+                status = state::Status(state::Id::Run);
+                break;
+            }
+            case Event::Type::Timeout:
+            {
+                if (_event.timer == Timer::Reboot)
+                    esp_restart();
+                break;
+            }
+            default:
+                break;
+        }
+        return status;
+    }
+
+    state::Status App::dispatchCalibrateState(const Event& _event)
+    {
+        state::Status status;
+        switch (_event.type)
+        {
+            case Event::Type::ButtonPress:
+            {
+                // Past the end of the servo range the needle wraps back to the previous point
+                m_calibrationTicks += CalibrationStepTicks;
+                if (m_calibrationTicks > servo::MaxCompareTicks)
+                    m_calibrationTicks = getCalibrationLowestTicks();
+                showCalibrationPoint();
+                break;
+            }
+            case Event::Type::ButtonLongPress:
+            {
+                m_calibration.ticks[m_calibrationPoint++] = m_calibrationTicks;
+                if (m_calibrationPoint < m_calibration.count)
+                {
+                    startCalibrationPoint();
+                    break;
+                }
+
+                configASSERT(dial::isValid(m_calibration));
+                persist::set(persist::Key::ServoCalibration, m_calibration);
+                flushPersist();
+                m_dial.build(m_calibration);
+                ESP_LOGI(TAG, "Dial calibrated");
+                status = state::Status(state::Id::ConnectingToWifi);
+                break;
+            }
+            case Event::Type::Timeout:
+            {
+                if (_event.timer == Timer::CalibrationIdle)
+                {
+                    // Keep the previous calibration
+                    ESP_LOGW(TAG, "Calibration abandoned");
+                    if (!persist::get(persist::Key::ServoCalibration, m_calibration) || !dial::isValid(m_calibration))
+                        m_calibration = dial::DefaultCalibration;
+                    status = state::Status(state::Id::ConnectingToWifi);
+                }
+                break;
+            }
+            default:
+                break;
+        }
+
+        if (_event.type == Event::Type::ButtonPress || _event.type == Event::Type::ButtonLongPress)
+        {
+            // Stale ids are ignored by cancel()
+            m_timers.cancel(m_calibrationIdleTimer);
+            if (!status.isTransitRequested())
+                m_calibrationIdleTimer = m_timers.startOneShot(Timer::CalibrationIdle, CalibrationIdleMs, toOwner(state::Id::Calibrate));
+        }
         return status;
     }
 
@@ -261,28 +665,156 @@ namespace tr::app
     {
         Event event;
         event.type = Event::Type::ButtonPress;
-        xQueueSend(m_queue, &event, portMAX_DELAY);
+        m_inbox.post(event);
     }
 
     void App::onButtonLongPress()
     {
         Event event;
         event.type = Event::Type::ButtonLongPress;
-        xQueueSend(m_queue, &event, portMAX_DELAY);
+        m_inbox.post(event);
     }
 
     void App::onWifiReady()
     {
         Event event;
         event.type = Event::Type::WifiReady;
-        xQueueSend(m_queue, &event, portMAX_DELAY);
+        m_inbox.post(event);
     }
 
     void App::onWifiFail()
     {
         Event event;
         event.type = Event::Type::WifiFail;
-        xQueueSend(m_queue, &event, portMAX_DELAY);
+        m_inbox.post(event);
+    }
+
+    void App::onDeparturesChanged()
+    {
+        Event event;
+        event.type = Event::Type::DeparturesChanged;
+        m_inbox.post(event);
+    }
+
+    void App::showBoard(uint32_t _originUs)
+    {
+        const auto live = fetcher::readBoard();
+        m_boardView.show(live.get(), time(nullptr), _originUs, m_dial);
+    }
+
+    uint16_t App::getCalibrationLowestTicks() const
+    {
+        return m_calibrationPoint == 0 ? servo::MinCompareTicks : m_calibration.ticks[m_calibrationPoint - 1];
+    }
+
+    void App::startCalibrationPoint()
+    {
+        // A few steps before the current calibration, the needle is usually close
+        const uint16_t lowest = getCalibrationLowestTicks();
+        const uint16_t back = CalibrationStartBackSteps * CalibrationStepTicks;
+        const uint16_t previous = m_calibration.ticks[m_calibrationPoint];
+        m_calibrationTicks = previous > lowest + back ? previous - back : lowest;
+        showCalibrationPoint();
+    }
+
+    void App::showCalibrationPoint()
+    {
+        {
+            char text[display::MaxTextLength + 1];
+            snprintf(text, sizeof(text), "Dial %u min", m_calibration.minutes[m_calibrationPoint]);
+
+            display::Event event;
+            event.type = display::Event::Type::DrawAndClear;
+            event.setText(text);
+            event.font = display::Font::Small;
+            event.pos = StateTextPage;
+            event.column = display::font::Small.centerColumn(text);
+            display::sendEvent(event);
+
+            snprintf(text, sizeof(text), "%u us", m_calibrationTicks);
+            event.type = display::Event::Type::Draw;
+            event.setText(text);
+            event.pos = CalibrationValuePage;
+            event.column = display::font::Small.centerColumn(text);
+            display::sendEvent(event);
+        }
+        {
+            servo::Event event;
+            event.compareTicks = m_calibrationTicks;
+            servo::sendEvent(event);
+        }
+    }
+
+    void App::runProfileStep()
+    {
+        const ProfileStep step = static_cast<ProfileStep>(m_profileStep++);
+        ESP_LOGI(TAG, "Profile step %u", static_cast<unsigned>(step));
+
+        uint32_t nextStepMs = ProfileStepMs;
+        switch (step)
+        {
+            case ProfileStep::Buttons:
+                // The input task delivers them one per poll
+                input::injectPresses(ProfileButtonPresses);
+                nextStepMs = ProfileButtonPresses * input::PollPeriodMs + ProfileStepMs;
+                break;
+            case ProfileStep::Display:
+            {
+                // Every font and the marquee, the board is redrawn from scratch afterwards
+                display::Event event;
+                event.type = display::Event::Type::Clear;
+                display::sendEvent(event);
+
+                event.type = display::Event::Type::Draw;
+                event.setText("88");
+                event.font = display::Font::Digits32;
+                event.pos = BoardView::CountdownPage;
+                event.column = BoardView::CountdownColumn;
+                display::sendEvent(event);
+
+                event.font = display::Font::Digits16;
+                event.pos = BoardView::LinePage - 1;
+                event.column = BoardView::LineColumn;
+                display::sendEvent(event);
+
+                event.type = display::Event::Type::Scroll;
+                event.setText(PROFILE_SCROLL_TEXT);
+                event.font = display::Font::Small;
+                event.pos = BoardView::LaterPage;
+                display::sendEvent(event);
+
+                m_boardView.invalidateScreen();
+                break;
+            }
+            case ProfileStep::Servo:
+            {
+                for (int deg : {0, 45, 90, 45, 0})
+                {
+                    servo::Event event;
+                    event.compareTicks = servo::toCompareTicks(deg);
+                    servo::sendEvent(event);
+                }
+                m_boardView.invalidateNeedle();
+                break;
+            }
+            case ProfileStep::Fetch:
+                fetcher::request();
+                nextStepMs = ProfileSettleMs;
+                break;
+            case ProfileStep::Report:
+                profiler::report();
+                return;
+            case ProfileStep::Done:
+                return;
+        }
+        m_timers.startOneShot(Timer::Profile, nextStepMs, TimerService::GlobalOwner);
+    }
+
+    void App::onOtaDone(ota::Result _result)
+    {
+        Event event;
+        event.type = _result == ota::Result::Done ? Event::Type::OtaDone : Event::Type::OtaFail;
+        m_inbox.post(event);
     }
 
 } // namespace tr::app
@@ -1,25 +1,15 @@
 #pragma once
 
-#include "freertos/FreeRTOS.h"
-#include "freertos/queue.h"
-
+#include "tram_run/BoardView.hpp"
+#include "tram_run/Dial.hpp"
+#include "tram_run/Event.hpp"
+#include "tram_run/Inbox.hpp"
+#include "tram_run/Ota.hpp"
 #include "tram_run/State.hpp"
+#include "tram_run/TimerService.hpp"
 
 namespace tr::app
 {
-    struct Event
-    {
-        enum class Type : uint8_t
-        {
-            ButtonPress,
-            ButtonLongPress,
-            Tick,
-            WifiFail,
-            WifiReady,
-        };
-        Type type = Type::ButtonPress;
-    };
-
     class App final
     {
     public:
@@ -31,6 +21,13 @@ namespace tr::app
 
     private:
         static void mainTask(void* _pvParameter);
+        void handleInbox();
+        // The Main monitor span of a dispatched event
+        void beginSpan();
+        void endSpan();
+        // persist::flush() with its wait left out of the span
+        void flushPersist();
+        void handleGlobalTimeout(const Event& _event);
 
         state::Id getStateSafe() const;
 
@@ -38,19 +35,43 @@ namespace tr::app
         void transitInitState(state::Transit _transit);
         void transitConnectingToWifi(state::Transit _transit);
         void transitRunState(state::Transit _transit);
+        void transitUpdateState(state::Transit _transit);
+        void transitCalibrateState(state::Transit _transit);
 
         void dispatchAndTransit(const Event& _event);
+        [[noreturn]] void enterDeepSleep(uint32_t _seconds);
         state::Status dispatchInitState(const Event& _event);
         state::Status dispatchConnectingToWifi(const Event& _event);
         state::Status dispatchRunState(const Event& _event);
+        state::Status dispatchUpdateState(const Event& _event);
+        state::Status dispatchCalibrateState(const Event& _event);
 
         void onButtonPress();
         void onButtonLongPress();
         void onWifiReady();
         void onWifiFail();
+        void onOtaDone(ota::Result _result);
+        void onDeparturesChanged();
+
+        // _originUs is the arrival of new departures to time the way to the screen, 0 otherwise
+        void showBoard(uint32_t _originUs);
+        void runProfileStep();
+        uint16_t getCalibrationLowestTicks() const;
+        void startCalibrationPoint();
+        void showCalibrationPoint();
 
         state::Id m_state = state::Id::Init;
-        QueueHandle_t m_queue = nullptr;
+        Inbox m_inbox;
+        TimerService m_timers;
+        uint32_t m_heapViolations = 0;
+        bool m_inSpan = false;
+        BoardView m_boardView;
+        dial::Calibration m_calibration;
+        dial::Table m_dial;
+        uint8_t m_calibrationPoint = 0;
+        uint16_t m_calibrationTicks = 0;
+        TimerService::Id m_calibrationIdleTimer = TimerService::InvalidId;
+        uint8_t m_profileStep = 0;
     };
 
 } // namespace tr::app
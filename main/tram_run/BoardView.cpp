@@ -0,0 +1,131 @@
+#include "tram_run/BoardView.hpp"
+
+#include <string.h>
+
+#include <charconv>
+#include <string_view>
+
+namespace
+{
+    constexpr std::string_view ScheduledSuffix = " sched";
+    constexpr uint32_t MaxShownMinutes = 99;
+
+    uint32_t getMinutesLeft(const tr::departures::Departure& _departure, uint32_t _now)
+    {
+        const uint32_t minutes = _departure.time > _now ? (_departure.time - _now) / 60 : 0;
+        return minutes < MaxShownMinutes ? minutes : MaxShownMinutes;
+    }
+
+    // The texts are put together without snprintf(), by far the deepest call of the main task
+    // otherwise. Both cut the text off at _size.
+    size_t append(char* _text, size_t _size, size_t _length, std::string_view _part)
+    {
+        const size_t count = _part.size() < _size - _length ? _part.size() : _size - _length;
+        memcpy(_text + _length, _part.data(), count);
+        return _length + count;
+    }
+
+    size_t append(char* _text, size_t _size, size_t _length, uint32_t _number)
+    {
+        char digits[10];
+        const char* end = std::to_chars(digits, digits + sizeof(digits), _number).ptr;
+        return append(_text, _size, _length, std::string_view(digits, end - digits));
+    }
+} // namespace
+
+namespace tr::app
+{
+    BoardView::BoardView(DisplaySink _display, ServoSink _servo, ScheduleSource _schedule)
+        : m_display{_display}
+        , m_servo{_servo}
+        , m_schedule{_schedule}
+    {
+    }
+
+    void BoardView::show(const departures::Board& _live, uint32_t _now, uint32_t _originUs, const dial::Table& _dial)
+    {
+        if (_live.count > 0)
+        {
+            show(_live, false, _now, _originUs, _dial);
+            return;
+        }
+
+        departures::Board scheduled;
+        if (m_schedule(_now, scheduled))
+            show(scheduled, true, _now, 0, _dial);
+    }
+
+    void BoardView::show(const departures::Board& _board, bool _scheduled, uint32_t _now, uint32_t _originUs, const dial::Table& _dial)
+    {
+        const departures::Departure& next = _board.items[0];
+
+        if (!m_screenShown)
+        {
+            display::Event event;
+            event.type = display::Event::Type::Clear;
+            m_display(event);
+            m_screenShown = true;
+        }
+
+        // The display only repaints the cells that changed, so resending the same text is cheap
+        {
+            const uint32_t minutes = getMinutesLeft(next, _now);
+            char text[2];
+            size_t length = append(text, sizeof(text), 0, minutes < 10 ? " " : "");
+            length = append(text, sizeof(text), length, minutes);
+
+            display::Event event;
+            event.type = display::Event::Type::Draw;
+            event.setText(std::string_view(text, length));
+            event.font = display::Font::Digits32;
+            event.pos = CountdownPage;
+            event.column = CountdownColumn;
+            event.originUs = _originUs;
+            m_display(event);
+        }
+        {
+            char text[display::MaxTextLength];
+            size_t length = append(text, sizeof(text), 0, next.getLine());
+            length = append(text, sizeof(text), length, _scheduled ? ScheduledSuffix : "");
+
+            display::Event event;
+            event.type = display::Event::Type::Draw;
+            event.setText(std::string_view(text, length));
+            event.font = display::Font::Small;
+            event.pos = LinePage;
+            event.column = LineColumn;
+            m_display(event);
+        }
+        {
+            char text[display::MaxScrollTextLength];
+            size_t length = 0;
+            for (uint8_t i = 1; i < _board.count && length < sizeof(text); ++i)
+            {
+                const departures::Departure& later = _board.items[i];
+                length = append(text, sizeof(text), length, later.getLine());
+                length = append(text, sizeof(text), length, " ");
+                length = append(text, sizeof(text), length, getMinutesLeft(later, _now));
+                length = append(text, sizeof(text), length, "  ");
+            }
+
+            display::Event event;
+            event.type = display::Event::Type::Scroll;
+            event.setText(std::string_view(text, length));
+            event.font = display::Font::Small;
+            event.pos = LaterPage;
+            m_display(event);
+        }
+
+        const uint16_t dialTicks = _dial.lookup(next.time > _now ? next.time - _now : 0);
+        if (dialTicks != m_dialTicks)
+        {
+            m_dialTicks = dialTicks;
+
+            servo::Event event;
+            event.compareTicks = dialTicks;
+            event.originUs = _originUs;
+            m_servo(event);
+        }
+    }
+
+} // namespace tr::app
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "tram_run/Delegate.hpp"
+#include "tram_run/Departures.hpp"
+#include "tram_run/Dial.hpp"
+#include "tram_run/Display.hpp"
+#include "tram_run/Font.hpp"
+#include "tram_run/Servo.hpp"
+
+#include <stdint.h>
+
+namespace tr::app
+{
+    // The Run screen and the needle: the minutes to the next departure, its line, the later
+    // departures scrolling and the dial position, from the live board or else the timetable.
+    // Free of ESP-IDF so that the host tests run this very code, the events go to the sinks,
+    // display::sendEvent() and servo::sendEvent() on the device.
+    class BoardView final
+    {
+    public:
+        using DisplaySink = Delegate<void(const display::Event&)>;
+        using ServoSink = Delegate<void(const servo::Event&)>;
+        // The timetable board at a unix time, false without one
+        using ScheduleSource = Delegate<bool(uint32_t, departures::Board&)>;
+
+        static constexpr uint8_t CountdownPage = 0;
+        static constexpr uint8_t CountdownColumn = display::font::Digits32.centerColumn("00");
+        static constexpr uint8_t LinePage = 5;
+        static constexpr uint8_t LineColumn = 2;
+        static constexpr uint8_t LaterPage = 7;
+
+        BoardView(DisplaySink _display, ServoSink _servo, ScheduleSource _schedule);
+
+        // Another state drew on the screen, the next show() starts from a clear one
+        void invalidateScreen() { m_screenShown = false; }
+        // Something else moved the needle, the next show() positions it again
+        void invalidateNeedle() { m_dialTicks = 0; }
+
+        // _originUs is the arrival of the live departures to time the way to the screen, 0 otherwise.
+        // Shows nothing when neither the live board nor the timetable has a departure.
+        void show(const departures::Board& _live, uint32_t _now, uint32_t _originUs, const dial::Table& _dial);
+
+    private:
+        void show(const departures::Board& _board, bool _scheduled, uint32_t _now, uint32_t _originUs, const dial::Table& _dial);
+
+        DisplaySink m_display;
+        ServoSink m_servo;
+        ScheduleSource m_schedule;
+        bool m_screenShown = false;
+        uint16_t m_dialTicks = 0;   // 0 until the needle is positioned from the table
+    };
+
+} // namespace tr::app
@@ -0,0 +1,93 @@
+#include "tram_run/Deadline.hpp"
+
+namespace tr::deadline
+{
+    void Tracker::configure(uint8_t _channel, const char* _name, uint32_t _budgetUs)
+    {
+        if (_channel >= MaxChannels)
+            return;
+
+        m_channels[_channel].name = _name;
+        m_channels[_channel].budgetUs = _budgetUs > 0 ? _budgetUs : 1;
+        // Publishes the filled channel to the monitor
+        m_channels[_channel].enabled.store(true);
+    }
+
+    void Tracker::begin(uint8_t _channel, uint32_t _nowUs)
+    {
+        if (_channel >= MaxChannels)
+            return;
+
+        // The monitor reads busy first, at worst it sees the new start of a later span
+        m_channels[_channel].busySinceUs.store(_nowUs);
+        m_channels[_channel].busy.store(true);
+    }
+
+    bool Tracker::end(uint8_t _channel, uint32_t _nowUs)
+    {
+        if (_channel >= MaxChannels)
+            return false;
+
+        if (!m_channels[_channel].busy.exchange(false))
+            return false;
+        return record(_channel, _nowUs - m_channels[_channel].busySinceUs.load(std::memory_order_relaxed));
+    }
+
+    bool Tracker::record(uint8_t _channel, uint32_t _latencyUs)
+    {
+        if (!isEnabled(_channel))
+            return false;
+
+        Channel& channel = m_channels[_channel];
+        const uint8_t bucket = getBucket(_latencyUs, channel.budgetUs);
+        // Single writer, no read-modify-write needed
+        channel.buckets[bucket].store(channel.buckets[bucket].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if (_latencyUs > channel.maxUs.load(std::memory_order_relaxed))
+            channel.maxUs.store(_latencyUs, std::memory_order_relaxed);
+        return bucket >= FirstMissBucket;
+    }
+
+    Poll Tracker::poll(uint32_t _nowUs, uint32_t _hardFactor)
+    {
+        Poll result;
+        for (uint8_t i = 0; i < MaxChannels; ++i)
+        {
+            if (!isEnabled(i))
+                continue;
+
+            const uint32_t busyUs = getBusyUs(i, _nowUs);
+            const uint64_t budgetUs = m_channels[i].budgetUs;
+            if (busyUs > budgetUs)
+                result.stalled |= 1u << i;
+            if (busyUs > budgetUs * _hardFactor)
+                result.starving |= 1u << i;
+        }
+        result.newlyStalled = result.stalled & ~m_stalled;
+        m_stalled = result.stalled;
+        return result;
+    }
+
+    uint32_t Tracker::getBusyUs(uint8_t _channel, uint32_t _nowUs) const
+    {
+        const Channel& channel = m_channels[_channel];
+        if (!channel.busy.load())
+            return 0;
+        return _nowUs - channel.busySinceUs.load();
+    }
+
+    Stats Tracker::getStats(uint8_t _channel) const
+    {
+        Stats stats;
+        const Channel& channel = m_channels[_channel];
+        for (uint8_t i = 0; i < BucketCount; ++i)
+        {
+            stats.buckets[i] = channel.buckets[i].load(std::memory_order_relaxed);
+            stats.count += stats.buckets[i];
+            if (i >= FirstMissBucket)
+                stats.misses += stats.buckets[i];
+        }
+        stats.maxUs = channel.maxUs.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+} // namespace tr::deadline
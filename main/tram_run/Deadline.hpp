@@ -0,0 +1,93 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+
+namespace tr::deadline
+{
+    // Busy spans and end-to-end latencies checked against their budgets.
+    //
+    // A task channel is a heartbeat: the task marks the start and the end of every unit of work,
+    // a task waiting on its queue is idle and never late. The monitor polls the channels and
+    // sees a task that has been busy for longer than its budget while it is still stuck.
+    // A latency channel only records the measured values.
+    //
+    // Every value goes to a histogram whose buckets are relative to the budget, so the misses
+    // of all the channels read the same way. No RTOS in here, the clock is passed in.
+    // Each channel has a single writer, the monitor and the reports only read.
+
+    constexpr uint8_t MaxChannels = 8;
+    // Up to 1/4, 1/2, 1, 2, 4, 8 and 16 budgets, then anything longer
+    constexpr uint8_t BucketCount = 8;
+    constexpr uint8_t FirstMissBucket = 3;
+
+    constexpr uint8_t getBucket(uint32_t _value, uint32_t _budget)
+    {
+        uint64_t limit = _budget / 4;
+        uint8_t bucket = 0;
+        while (bucket < BucketCount - 1 && _value > limit)
+        {
+            limit = bucket == 0 ? _budget / 2 : (bucket == 1 ? _budget : limit * 2);
+            ++bucket;
+        }
+        return bucket;
+    }
+    static_assert(getBucket(100, 100) == 2 && getBucket(101, 100) == FirstMissBucket);
+
+    struct Stats
+    {
+        uint32_t buckets[BucketCount] = {};
+        uint32_t count = 0;
+        uint32_t misses = 0;
+        uint32_t maxUs = 0;
+    };
+
+    struct Poll
+    {
+        uint32_t stalled = 0;       // Channels busy for longer than their budget
+        uint32_t newlyStalled = 0;  // The ones among them that were not stalled at the previous poll
+        uint32_t starving = 0;      // Busy for longer than the hard limit
+    };
+
+    class Tracker final
+    {
+    public:
+        // Enables the channel, the monitor ignores it until then
+        void configure(uint8_t _channel, const char* _name, uint32_t _budgetUs);
+
+        // Task channels, from the task itself
+        void begin(uint8_t _channel, uint32_t _nowUs);
+        // True when the span went over the budget, false without a begin()
+        bool end(uint8_t _channel, uint32_t _nowUs);
+
+        // Latency channels, true when the latency went over the budget
+        bool record(uint8_t _channel, uint32_t _latencyUs);
+
+        // Monitor only. _hardFactor times the budget is the hard limit.
+        Poll poll(uint32_t _nowUs, uint32_t _hardFactor);
+
+        bool isEnabled(uint8_t _channel) const { return _channel < MaxChannels && m_channels[_channel].enabled.load(); }
+        const char* getName(uint8_t _channel) const { return m_channels[_channel].name; }
+        uint32_t getBudgetUs(uint8_t _channel) const { return m_channels[_channel].budgetUs; }
+        // 0 when idle
+        uint32_t getBusyUs(uint8_t _channel, uint32_t _nowUs) const;
+        Stats getStats(uint8_t _channel) const;
+
+    private:
+        struct Channel
+        {
+            const char* name = nullptr;
+            uint32_t budgetUs = 0;
+            std::atomic<bool> enabled{false};
+            std::atomic<bool> busy{false};
+            std::atomic<uint32_t> busySinceUs{0};
+            std::atomic<uint32_t> buckets[BucketCount] = {};
+            std::atomic<uint32_t> maxUs{0};
+        };
+
+        Channel m_channels[MaxChannels];
+        uint32_t m_stalled = 0;     // Monitor only
+    };
+
+} // namespace tr::deadline
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stddef.h>
+#include <string.h>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace tr
+{
+    template <typename Signature, size_t Capacity = 2 * sizeof(void*)>
+    class Delegate;
+
+    // A fixed-capacity replacement for std::function that never touches the heap.
+    // The callable is stored inline, so it has to fit into Capacity and be trivially copyable
+    // (a lambda capturing `this` or a couple of pointers is the typical case).
+    template <typename R, typename... Args, size_t Capacity>
+    class Delegate<R(Args...), Capacity> final
+    {
+    public:
+        Delegate() = default;
+
+        template <typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, Delegate>>>
+        Delegate(F&& _callable)
+        {
+            using Callable = std::decay_t<F>;
+            static_assert(sizeof(Callable) <= Capacity, "The callable doesn't fit into the delegate");
+            static_assert(alignof(Callable) <= alignof(void*), "The callable is over-aligned");
+            static_assert(std::is_trivially_copyable_v<Callable>, "The callable must be trivially copyable");
+
+            new (m_storage) Callable(std::forward<F>(_callable));
+            m_invoke = [](const void* _storage, Args... _args) -> R {
+                return (*static_cast<const Callable*>(_storage))(std::forward<Args>(_args)...);
+            };
+        }
+
+        R operator()(Args... _args) const
+        {
+            return m_invoke(m_storage, std::forward<Args>(_args)...);
+        }
+
+        explicit operator bool() const { return m_invoke != nullptr; }
+
+    private:
+        using Invoke = R (*)(const void*, Args...);
+
+        alignas(void*) unsigned char m_storage[Capacity] = {};
+        Invoke m_invoke = nullptr;
+    };
+
+} // namespace tr
@@ -0,0 +1,272 @@
+#include "tram_run/Departures.hpp"
+
+namespace
+{
+    bool parseNumber(std::string_view _text, uint32_t& _value)
+    {
+        if (_text.empty() || _text.size() > 10)
+            return false;
+
+        uint64_t value = 0;
+        for (char c : _text)
+        {
+            if (c < '0' || c > '9')
+                return false;
+            value = value * 10 + (c - '0');
+        }
+        if (value > UINT32_MAX)
+            return false;
+
+        _value = static_cast<uint32_t>(value);
+        return true;
+    }
+} // namespace
+
+namespace tr::departures
+{
+    bool parse(std::string_view _record, Departure& _departure)
+    {
+        while (!_record.empty() && (_record.back() == '\r' || _record.back() == ' '))
+            _record.remove_suffix(1);
+
+        const size_t first = _record.find(',');
+        const size_t second = first == std::string_view::npos ? first : _record.find(',', first + 1);
+        if (second == std::string_view::npos)
+            return false;
+
+        const std::string_view line = _record.substr(first + 1, second - first - 1);
+        if (line.empty() || line.size() > MaxLineLength)
+            return false;
+
+        Departure departure;
+        if (!parseNumber(_record.substr(0, first), departure.vehicleId)
+            || !parseNumber(_record.substr(second + 1), departure.time))
+            return false;
+        memcpy(departure.line, line.data(), line.size());
+
+        departure.source = _departure.source;
+        _departure = departure;
+        return true;
+    }
+
+    void RecordParser::reset()
+    {
+        count = 0;
+        recordSize = 0;
+        overlong = false;
+    }
+
+    void RecordParser::feed(const char* _data, size_t _size)
+    {
+        for (size_t i = 0; i < _size; ++i)
+        {
+            if (_data[i] == '\n')
+                endRecord();
+            else if (recordSize < sizeof(record))
+                record[recordSize++] = _data[i];
+            else
+                overlong = true;
+        }
+    }
+
+    void RecordParser::endRecord()
+    {
+        Departure departure;
+        if (!overlong && count < MaxPerSource && parse(std::string_view(record, recordSize), departure))
+            items[count++] = departure;
+        recordSize = 0;
+        overlong = false;
+    }
+
+    Aggregator::Aggregator(uint8_t _visible)
+        : m_visible{_visible < MaxVisible ? _visible : MaxVisible}
+    {
+    }
+
+    bool Aggregator::update(uint8_t _source, const Departure* _departures, uint8_t _count, uint32_t _now)
+    {
+        if (_source >= MaxSources)
+            return false;
+
+        // The entries of the old list may be gone from the new one, so they leave the heap first and
+        // the other sources fill the holes. Only then the new list competes for the top K, otherwise
+        // a late new departure could take a hole that belongs to a sooner one of another source.
+        evict(_source, _now);
+        refill(_now, _source);
+
+        Source& source = m_sources[_source];
+        source.count = _count < MaxPerSource ? _count : MaxPerSource;
+        for (uint8_t i = 0; i < source.count; ++i)
+        {
+            // Insertion sort, the lists are short and usually ordered already
+            Departure departure = _departures[i];
+            departure.source = _source;
+            uint8_t j = i;
+            for (; j > 0 && source.items[j - 1].time > departure.time; --j)
+                source.items[j] = source.items[j - 1];
+            source.items[j] = departure;
+        }
+
+        for (uint8_t i = 0; i < source.count; ++i)
+        {
+            if (source.items[i].time >= _now)
+                offer(source.items[i]);
+        }
+        return publish();
+    }
+
+    bool Aggregator::expire(uint32_t _now)
+    {
+        if (m_board.count == 0 || m_board.items[0].time >= _now)
+            return false;
+
+        evict(MaxSources, _now);
+        refill(_now, MaxSources);
+        return publish();
+    }
+
+    void Aggregator::evict(uint8_t _source, uint32_t _now)
+    {
+        for (uint8_t i = 0; i < m_heapSize;)
+        {
+            if (m_heap[i].source == _source || m_heap[i].time < _now)
+                remove(i);
+            else
+                ++i;
+        }
+    }
+
+    void Aggregator::refill(uint32_t _now, uint8_t _skipSource)
+    {
+        while (m_heapSize < m_visible)
+        {
+            const Departure* best = nullptr;
+            for (uint8_t index = 0; index < MaxSources; ++index)
+            {
+                if (index == _skipSource)
+                    continue;
+
+                // The first eligible departure of a list is the soonest one of its source
+                const Source& source = m_sources[index];
+                for (uint8_t i = 0; i < source.count; ++i)
+                {
+                    const Departure& departure = source.items[i];
+                    if (departure.time < _now || contains(departure.vehicleId))
+                        continue;
+                    if (best == nullptr || departure.time < best->time)
+                        best = &departure;
+                    break;
+                }
+            }
+            if (best == nullptr)
+                return;
+
+            m_heap[m_heapSize] = *best;
+            siftUp(m_heapSize++);
+        }
+    }
+
+    bool Aggregator::contains(uint32_t _vehicleId) const
+    {
+        for (uint8_t i = 0; i < m_heapSize; ++i)
+        {
+            if (m_heap[i].vehicleId == _vehicleId)
+                return true;
+        }
+        return false;
+    }
+
+    bool Aggregator::publish()
+    {
+        // Ordered by time, ties by vehicle so that the same top K always gives the same board
+        Board board;
+        board.count = m_heapSize;
+        for (uint8_t i = 0; i < m_heapSize; ++i)
+        {
+            const Departure departure = m_heap[i];
+            uint8_t j = i;
+            for (; j > 0 && (board.items[j - 1].time > departure.time
+                || (board.items[j - 1].time == departure.time && board.items[j - 1].vehicleId > departure.vehicleId)); --j)
+                board.items[j] = board.items[j - 1];
+            board.items[j] = departure;
+        }
+
+        if (board == m_board)
+            return false;
+        m_board = board;
+        return true;
+    }
+
+    void Aggregator::offer(const Departure& _departure)
+    {
+        // The same vehicle seen from another stop only counts once, with its soonest departure
+        for (uint8_t i = 0; i < m_heapSize; ++i)
+        {
+            if (m_heap[i].vehicleId != _departure.vehicleId)
+                continue;
+
+            if (_departure.time < m_heap[i].time)
+            {
+                m_heap[i] = _departure;
+                siftDown(i);
+            }
+            return;
+        }
+
+        if (m_heapSize < m_visible)
+        {
+            m_heap[m_heapSize] = _departure;
+            siftUp(m_heapSize++);
+        }
+        else if (m_visible > 0 && _departure.time < m_heap[0].time)
+        {
+            m_heap[0] = _departure;
+            siftDown(0);
+        }
+    }
+
+    void Aggregator::remove(uint8_t _index)
+    {
+        m_heap[_index] = m_heap[--m_heapSize];
+        if (_index < m_heapSize)
+        {
+            siftDown(_index);
+            siftUp(_index);
+        }
+    }
+
+    void Aggregator::siftUp(uint8_t _index)
+    {
+        while (_index > 0)
+        {
+            const uint8_t parent = (_index - 1) / 2;
+            if (m_heap[parent].time >= m_heap[_index].time)
+                break;
+            const Departure tmp = m_heap[parent];
+            m_heap[parent] = m_heap[_index];
+            m_heap[_index] = tmp;
+            _index = parent;
+        }
+    }
+
+    void Aggregator::siftDown(uint8_t _index)
+    {
+        while (true)
+        {
+            const uint8_t left = 2 * _index + 1;
+            const uint8_t right = left + 1;
+            uint8_t largest = _index;
+            if (left < m_heapSize && m_heap[left].time > m_heap[largest].time)
+                largest = left;
+            if (right < m_heapSize && m_heap[right].time > m_heap[largest].time)
+                largest = right;
+            if (largest == _index)
+                break;
+            const Departure tmp = m_heap[largest];
+            m_heap[largest] = m_heap[_index];
+            m_heap[_index] = tmp;
+            _index = largest;
+        }
+    }
+
+} // namespace tr::departures
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <string_view>
+
+namespace tr::departures
+{
+    constexpr size_t MaxLineLength = 6;
+    constexpr uint8_t MaxSources = 4;
+    constexpr uint8_t MaxPerSource = 8;
+    constexpr uint8_t MaxVisible = 4;
+
+    struct Departure
+    {
+        uint32_t time = 0;          // Unix time
+        uint32_t vehicleId = 0;     // The same vehicle seen from several stops has the same id
+        char line[MaxLineLength] = {};
+        uint8_t source = 0;         // Index of the configured stop
+
+        std::string_view getLine() const { return std::string_view(line, strnlen(line, sizeof(line))); }
+
+        bool operator==(const Departure& _other) const
+        {
+            return time == _other.time && vehicleId == _other.vehicleId && source == _other.source
+                && memcmp(line, _other.line, sizeof(line)) == 0;
+        }
+    };
+
+    // The soonest departures, ordered by time
+    struct Board
+    {
+        Departure items[MaxVisible];
+        uint8_t count = 0;
+
+        bool operator==(const Board& _other) const
+        {
+            if (count != _other.count)
+                return false;
+            for (uint8_t i = 0; i < count; ++i)
+            {
+                if (!(items[i] == _other.items[i]))
+                    return false;
+            }
+            return true;
+        }
+    };
+
+    // Parses one "vehicleId,line,unixTime" record of the departures feed
+    bool parse(std::string_view _record, Departure& _departure);
+
+    // The departures of one stop from its feed, one record per line, fed in chunks as they arrive.
+    // Overlong and malformed records are skipped, the records past MaxPerSource are dropped.
+    struct RecordParser
+    {
+        static constexpr size_t MaxRecordLength = 48;
+
+        Departure items[MaxPerSource];
+        uint8_t count = 0;
+        char record[MaxRecordLength];
+        size_t recordSize = 0;
+        bool overlong = false;
+
+        void reset();
+        void feed(const char* _data, size_t _size);
+        // Ends the last record, which may miss its newline
+        void endRecord();
+    };
+
+    // Merges the per-source departure lists into the K soonest ones.
+    // Each source keeps its last list ordered by time, and the top K live in a bounded max-heap
+    // across the updates. An update only evicts the entries of its own source, refills the holes
+    // with the soonest remaining departures of the other sources and offers its new ones.
+    // An update that does not reach the top K costs one comparison per departure,
+    // the worst case is O(N log K), with no allocation.
+    class Aggregator final
+    {
+    public:
+        explicit Aggregator(uint8_t _visible = MaxVisible);
+
+        // Returns true when the visible board changed
+        bool update(uint8_t _source, const Departure* _departures, uint8_t _count, uint32_t _now);
+        // Drops the departures in the past, returns true when the visible board changed
+        bool expire(uint32_t _now);
+
+        const Board& getBoard() const { return m_board; }
+
+    private:
+        struct Source
+        {
+            Departure items[MaxPerSource];
+            uint8_t count = 0;
+        };
+
+        // Drops the heap entries of the source and the ones in the past, MaxSources for none
+        void evict(uint8_t _source, uint32_t _now);
+        // Fills the heap up with the soonest departures not in it yet, skipping _skipSource
+        void refill(uint32_t _now, uint8_t _skipSource);
+        void offer(const Departure& _departure);
+        bool contains(uint32_t _vehicleId) const;
+        bool publish();
+        void remove(uint8_t _index);
+        void siftUp(uint8_t _index);
+        void siftDown(uint8_t _index);
+
+        Source m_sources[MaxSources];
+        Departure m_heap[MaxVisible];   // Max-heap by time, the root is the latest of the K
+        uint8_t m_heapSize = 0;
+        uint8_t m_visible = MaxVisible;
+        Board m_board;
+    };
+
+} // namespace tr::departures
@@ -0,0 +1,43 @@
+#include "tram_run/Dial.hpp"
+
+namespace tr::dial
+{
+    bool isValid(const Calibration& _calibration)
+    {
+        if (_calibration.version != Calibration::Version || _calibration.count < 2 || _calibration.count > MaxPoints)
+            return false;
+
+        for (uint8_t i = 0; i < _calibration.count; ++i)
+        {
+            if (_calibration.ticks[i] < servo::MinCompareTicks || _calibration.ticks[i] > servo::MaxCompareTicks)
+                return false;
+            if (i > 0 && (_calibration.minutes[i] <= _calibration.minutes[i - 1] || _calibration.ticks[i] < _calibration.ticks[i - 1]))
+                return false;
+        }
+        return true;
+    }
+
+    void Table::build(const Calibration& _calibration)
+    {
+        const uint8_t last = _calibration.count - 1;
+        uint8_t segment = 0;
+        for (uint16_t index = 0; index < TableSize; ++index)
+        {
+            const uint32_t seconds = index * StepSeconds;
+            while (segment < last && _calibration.minutes[segment + 1] * 60u <= seconds)
+                ++segment;
+
+            const uint32_t from = _calibration.minutes[segment] * 60u;
+            if (segment == last || seconds <= from)
+            {
+                m_ticks[index] = _calibration.ticks[segment];
+                continue;
+            }
+
+            const uint32_t span = _calibration.minutes[segment + 1] * 60u - from;
+            const uint32_t rise = _calibration.ticks[segment + 1] - _calibration.ticks[segment];
+            m_ticks[index] = _calibration.ticks[segment] + (rise * (seconds - from) + span / 2) / span;
+        }
+    }
+
+} // namespace tr::dial
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "tram_run/Servo.hpp"
+
+#include <stdint.h>
+
+namespace tr::dial
+{
+    // Minutes to servo compare ticks for the dial.
+    //
+    // The dial face is not linear: the first minutes are spread wide and the scale compresses
+    // towards the hour, and every unit is a bit different. A unit is described by a calibration,
+    // the ticks measured at a few reference minutes. It is expanded once into a table with one
+    // entry per Step seconds, so that a lookup on the countdown path is a single read.
+    constexpr uint8_t MaxPoints = 12;
+    constexpr uint32_t StepSeconds = 10;
+    constexpr uint32_t MaxSeconds = 60 * 60;
+    constexpr uint16_t TableSize = MaxSeconds / StepSeconds + 1;
+
+    // Persisted as is, bump Version when the layout changes
+    struct Calibration
+    {
+        static constexpr uint8_t Version = 1;
+
+        uint8_t version = Version;
+        uint8_t count = 0;
+        uint8_t minutes[MaxPoints] = {};
+        uint16_t ticks[MaxPoints] = {};
+    };
+
+    // Measured on the reference dial face, log like spacing
+    constexpr Calibration DefaultCalibration = {
+        Calibration::Version,
+        12,
+        {0, 1, 2, 3, 5, 7, 10, 15, 20, 30, 45, 60},
+        {600, 904, 1081, 1207, 1385, 1511, 1650, 1814, 1933, 2104, 2276, 2400},
+    };
+
+    // Minutes strictly increasing, ticks not decreasing and within the servo range
+    bool isValid(const Calibration& _calibration);
+
+    class Table final
+    {
+    public:
+        // Interpolates linearly between the points, clamps before the first and after the last one
+        void build(const Calibration& _calibration);
+
+        uint16_t lookup(uint32_t _secondsLeft) const
+        {
+            const uint32_t index = (_secondsLeft + StepSeconds / 2) / StepSeconds;
+            return m_ticks[index < TableSize ? index : TableSize - 1];
+        }
+
+    private:
+        uint16_t m_ticks[TableSize] = {};
+    };
+
+} // namespace tr::dial
@@ -1,10 +1,19 @@
 #include "tram_run/Display.hpp"
+#include "tram_run/HeapGuard.hpp"
+#include "tram_run/Monitor.hpp"
+#include "tram_run/Rtos.hpp"
+#include "tram_run/TextField.hpp"
+
+#include "sdkconfig.h"
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
 
 #include "esp_log.h"
+#include "driver/i2c_master.h"
+
+#include <string.h>
 
 extern "C"
 {
@@ -14,6 +23,17 @@ extern "C"
 namespace
 {
     static const char* TAG = "TR_DISPLAY";
+
+    // A full redraw over I2C, with room for the scroll window rewrite
+    constexpr uint32_t MonitorBudgetMs = 250;
+
+    // The bus the ssd1306 component creates, see its Kconfig
+#if CONFIG_I2C_PORT_1
+    constexpr i2c_port_num_t PanelPort = I2C_NUM_1;
+#else
+    constexpr i2c_port_num_t PanelPort = I2C_NUM_0;
+#endif
+    constexpr uint32_t PanelSpeedHz = 400000;
     
     class Display final
     {
@@ -22,12 +42,67 @@ namespace
         ~Display();
 
         void drawText(const char* _text, int _length, int _pos);
+        void drawText(tr::display::Font _font, std::string_view _text, uint8_t _page, uint8_t _column);
         void clear();
+
+        void setScroll(tr::display::Font _font, std::string_view _text, uint8_t _page);
+        // Time until the scrolling text has to be rewritten, portMAX_DELAY if never
+        TickType_t getScrollTimeout() const;
+        void onScrollTimeout();
     
     private:
+        static constexpr unsigned MaxFields = 4;
+        static constexpr unsigned Width = 128;
+
+        // The panel steps the scroll one column every ScrollFrames frames, see the SSD1306 datasheet
+        static constexpr uint8_t ScrollFramesCode = 0x00;
+        static constexpr unsigned ScrollFrames = 5;
+        static constexpr unsigned FrameRateHz = 105;
+        static constexpr TickType_t ScrollWrapTime = pdMS_TO_TICKS(Width * ScrollFrames * 1000 / FrameRateHz);
+
+        struct Marquee
+        {
+            const tr::display::font::View* font = nullptr;
+            char text[tr::display::MaxScrollTextLength];
+            uint8_t length = 0;
+            uint8_t offset = 0;     // First character of the window currently in the panel RAM
+            uint8_t page = 0;
+            TickType_t writtenAt = 0;
+        };
+
+        tr::display::TextField& getField(const tr::display::font::View& _font, uint8_t _page, uint8_t _column);
+
+        // Writing the RAM is not allowed while scrolling, so a write stops the scroll and restarts it
+        // after. The scrolled region keeps its shifted content meanwhile and the scroll goes on from
+        // there, only a new text or a wrap around rewrites the window.
+        void stopScroll();
+        void startScroll();
+        void writeScrollWindow();
+        // The component only scrolls the whole panel, the scroll of a page range is sent directly
+        void sendCommands(const uint8_t* _commands, size_t _size);
+
         SSD1306_t m_display;
+        i2c_master_dev_handle_t m_commandDevice = nullptr;
+        bool m_scrolling = false;
+        TickType_t m_stoppedAt = 0;
+        tr::display::TextField m_fields[MaxFields];
+        unsigned m_nextField = 0;
+        Marquee m_marquee;
     };
 
+    const tr::display::font::View& toView(tr::display::Font _font)
+    {
+        switch (_font)
+        {
+        case tr::display::Font::Digits16:
+            return tr::display::font::Digits16;
+        case tr::display::Font::Digits32:
+            return tr::display::font::Digits32;
+        default:
+            return tr::display::font::Small;
+        }
+    }
+
     Display::Display()
     {
         i2c_master_init(&m_display, CONFIG_SDA_GPIO, CONFIG_SCL_GPIO, CONFIG_RESET_GPIO);
@@ -35,6 +110,15 @@ namespace
         ESP_LOGI(TAG, "Init display");
         ssd1306_init(&m_display, 128, 64);
 
+        // A second handle on the panel for the raw commands, the component does not expose its own
+        i2c_master_bus_handle_t bus = nullptr;
+        ESP_ERROR_CHECK(i2c_master_get_bus_handle(PanelPort, &bus));
+        i2c_device_config_t device = {};
+        device.dev_addr_length = I2C_ADDR_BIT_LEN_7;
+        device.device_address = I2C_ADDRESS;
+        device.scl_speed_hz = PanelSpeedHz;
+        ESP_ERROR_CHECK(i2c_master_bus_add_device(bus, &device, &m_commandDevice));
+
         ssd1306_clear_screen(&m_display, false);
         ssd1306_contrast(&m_display, 0xff);
     }
@@ -45,26 +129,198 @@ namespace
 
     void Display::drawText(const char* _text, int _length, int _pos)
     {
+        stopScroll();
         ssd1306_display_text(&m_display, _pos, _text, _length, false);
+        startScroll();
+    }
+
+    void Display::drawText(tr::display::Font _font, std::string_view _text, uint8_t _page, uint8_t _column)
+    {
+        if (_font == tr::display::Font::System)
+        {
+            drawText(_text.data(), _text.size(), _page);
+            return;
+        }
+
+        // The scroll is only stopped for an actual write, an unchanged field leaves it running
+        tr::display::TextField& field = getField(toView(_font), _page, _column);
+        const unsigned written = field.draw(_text,
+            [this](uint8_t _page, uint8_t _column, const uint8_t* _bytes, uint8_t _width) {
+                stopScroll();
+                ssd1306_display_image(&m_display, _page, _column, const_cast<uint8_t*>(_bytes), _width);
+            }
+        );
+        ESP_LOGD(TAG, "Text field %u:%u, %u bytes", _page, _column, written);
+        if (written > 0)
+            startScroll();
     }
 
     void Display::clear()
     {
+        stopScroll();
         ssd1306_clear_screen(&m_display, false);
+
+        for (tr::display::TextField& field : m_fields)
+            field.markBlank();
+
+        m_marquee.font = nullptr;
+    }
+
+    void Display::setScroll(tr::display::Font _font, std::string_view _text, uint8_t _page)
+    {
+        const tr::display::font::View& font = toView(_font);
+        if (_text.size() > sizeof(m_marquee.text))
+            _text = _text.substr(0, sizeof(m_marquee.text));
+
+        const bool same = m_marquee.font == &font && m_marquee.page == _page
+            && std::string_view(m_marquee.text, m_marquee.length) == _text;
+        if (same)
+            return;
+
+        stopScroll();
+        if (m_marquee.font != nullptr)
+        {
+            const uint8_t blank[Width] = {};
+            for (uint8_t page = 0; page < m_marquee.font->pages; ++page)
+                ssd1306_display_image(&m_display, m_marquee.page + page, 0, const_cast<uint8_t*>(blank), Width);
+        }
+
+        m_marquee.font = _text.empty() ? nullptr : &font;
+        memcpy(m_marquee.text, _text.data(), _text.size());
+        m_marquee.length = _text.size();
+        m_marquee.offset = 0;
+        m_marquee.page = _page;
+        if (m_marquee.font != nullptr)
+            writeScrollWindow();
+        startScroll();
+    }
+
+    TickType_t Display::getScrollTimeout() const
+    {
+        if (m_marquee.font == nullptr || m_marquee.font->measure(std::string_view(m_marquee.text, m_marquee.length)) <= Width)
+            return portMAX_DELAY;
+
+        const TickType_t elapsed = xTaskGetTickCount() - m_marquee.writtenAt;
+        return elapsed >= ScrollWrapTime ? 0 : ScrollWrapTime - elapsed;
+    }
+
+    void Display::onScrollTimeout()
+    {
+        // The text is wider than the panel, so once the window has wrapped around show the next part of it
+        const uint8_t shown = Width / m_marquee.font->cellWidth();
+        m_marquee.offset = m_marquee.offset + shown >= m_marquee.length ? 0 : m_marquee.offset + shown;
+
+        stopScroll();
+        writeScrollWindow();
+        startScroll();
     }
 
+    void Display::stopScroll()
+    {
+        if (!m_scrolling)
+            return;
+
+        ssd1306_hardware_scroll(&m_display, SCROLL_STOP);
+        m_scrolling = false;
+        m_stoppedAt = xTaskGetTickCount();
+    }
+
+    void Display::startScroll()
+    {
+        if (m_marquee.font == nullptr || m_scrolling)
+            return;
+
+        // The window does not move while stopped, so the wrap around is that much later
+        if (m_stoppedAt != 0)
+            m_marquee.writtenAt += xTaskGetTickCount() - m_stoppedAt;
+        m_stoppedAt = 0;
+
+        const uint8_t endPage = m_marquee.page + m_marquee.font->pages - 1;
+        const uint8_t commands[] = {
+            0x27,               // Left horizontal scroll
+            0x00,
+            m_marquee.page,     // Start page
+            ScrollFramesCode,
+            endPage,            // End page
+            0x00,
+            0xFF,
+            0x2F                // Activate scroll
+        };
+        sendCommands(commands, sizeof(commands));
+        m_scrolling = true;
+    }
+
+    void Display::writeScrollWindow()
+    {
+        const tr::display::font::View& font = *m_marquee.font;
+
+        // Characters are laid out once across the full width, the gap at the end separates the repeats
+        for (uint8_t page = 0; page < font.pages; ++page)
+        {
+            uint8_t row[Width] = {};
+            unsigned column = 0;
+            for (uint8_t i = m_marquee.offset; i < m_marquee.length && column + font.width <= Width; ++i)
+            {
+                memcpy(row + column, font.page(font.indexOf(m_marquee.text[i]), page), font.width);
+                column += font.cellWidth();
+            }
+            ssd1306_display_image(&m_display, m_marquee.page + page, 0, row, Width);
+        }
+        m_marquee.writtenAt = xTaskGetTickCount();
+        m_stoppedAt = 0;
+    }
+
+    void Display::sendCommands(const uint8_t* _commands, size_t _size)
+    {
+        uint8_t buffer[16];
+        configASSERT(_size < sizeof(buffer));
+
+        buffer[0] = 0x00; // Control byte, command stream
+        memcpy(buffer + 1, _commands, _size);
+        ESP_ERROR_CHECK(i2c_master_transmit(m_commandDevice, buffer, _size + 1, -1));
+    }
+
+    tr::display::TextField& Display::getField(const tr::display::font::View& _font, uint8_t _page, uint8_t _column)
+    {
+        for (tr::display::TextField& field : m_fields)
+        {
+            if (field.isAt(_font, _page, _column))
+                return field;
+        }
+
+        // A new field may overlap an old one whose cache would then be stale, so drop them all
+        for (tr::display::TextField& field : m_fields)
+            field.invalidate();
+
+        tr::display::TextField& field = m_fields[m_nextField];
+        m_nextField = (m_nextField + 1) % MaxFields;
+        field = tr::display::TextField(_font, _page, _column);
+        return field;
+    }
+
+    static tr::rtos::StaticTask<CONFIG_TR_DISPLAY_TASK_STACK> g_taskStorage;
+    static tr::rtos::StaticQueue<tr::display::Event, 3> g_queueStorage;
+
     static QueueHandle_t g_queue = nullptr;
     static TaskHandle_t g_task = nullptr;
 
     void task(void* _pvParameter)
     {
         Display display;
+        tr::heap_guard::armCurrentTask();
 
         tr::display::Event event;
         while (true)
         {
-            if (xQueueReceive(g_queue, &event, portMAX_DELAY))
+            if (!xQueueReceive(g_queue, &event, display.getScrollTimeout()))
+            {
+                tr::monitor::begin(tr::monitor::Task::Display);
+                display.onScrollTimeout();
+                tr::monitor::end(tr::monitor::Task::Display);
+            }
+            else
             {
+                tr::monitor::begin(tr::monitor::Task::Display);
                 switch (event.type)
                 {
                 case tr::display::Event::Type::Clear:
@@ -73,13 +329,20 @@ namespace
                     break;
                 case tr::display::Event::Type::Draw:
                     ESP_LOGI(TAG, "Text");
-                    display.drawText(event.text, event.length, event.pos);
+                    display.drawText(event.font, event.getText(), event.pos, event.column);
                     break;
                 case tr::display::Event::Type::DrawAndClear:
                     display.clear();
-                    display.drawText(event.text, event.length, event.pos);
+                    display.drawText(event.font, event.getText(), event.pos, event.column);
+                    break;
+                case tr::display::Event::Type::Scroll:
+                    ESP_LOGI(TAG, "Scroll");
+                    display.setScroll(event.font, event.getText(), event.pos);
                     break;
                 }
+                // The pixels are on the panel once the I2C transfer returns
+                tr::monitor::record(tr::monitor::Path::Screen, event.originUs);
+                tr::monitor::end(tr::monitor::Task::Display);
             }
         }
     }
@@ -96,19 +359,10 @@ namespace tr::display
             ESP_ERROR_CHECK(ESP_FAIL);
         }
 
-        g_queue = xQueueCreate(3, sizeof(Event));
-
-        if (g_queue == nullptr)
-        {
-            ESP_ERROR_CHECK(ESP_FAIL);
-        }
-
-        // TODO the stack size is higher that it could be because the initialization needs more memory
-        BaseType_t ret = xTaskCreate(task, "DisplayTask", 4096, NULL, 8, &g_task);
-        if (ret != pdPASS)
-        {
-            ESP_ERROR_CHECK(ESP_FAIL);
-        }
+        g_queue = g_queueStorage.create();
+        ESP_LOGI(TAG, "Event %u bytes, queue storage %u bytes", (unsigned)sizeof(Event), (unsigned)sizeof(g_queueStorage));
+        g_task = g_taskStorage.create(task, "DisplayTask", NULL, 8);
+        tr::monitor::addTask(tr::monitor::Task::Display, g_task, g_queue, MonitorBudgetMs);
     }
 
     void deinit()
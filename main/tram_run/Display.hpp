@@ -1,22 +1,54 @@
 #pragma once
 #include <stdint.h>
+#include <string.h>
+
+#include <string_view>
 
 namespace tr::display
 {
     constexpr unsigned MaxTextLength = 16;
+    constexpr unsigned MaxScrollTextLength = 32;
+
+    enum class Font : uint8_t
+    {
+        System,     // 8x8 font of the ssd1306 component, always redrawn as a whole
+        Small,      // 5x7 font for line names, only changed cells are redrawn
+        Digits16,   // 16 px high countdown digits, only changed cells are redrawn
+        Digits32,   // 32 px high countdown digits, only changed cells are redrawn
+    };
+
     struct Event
     {
         enum class Type : uint8_t
         {
             Clear,
             Draw,
-            DrawAndClear
+            DrawAndClear,
+            // Declares the scrolling region: the pages covered by the font starting at pos.
+            // The panel scrolls it by itself, the text is only resent when it changes.
+            // There is one region, a new Scroll replaces it and an empty text removes it.
+            Scroll
         };
-        const char* text;
-        uint8_t pos = 0;
+
+        // The text is copied into the event, so it can be built on the stack of the sender.
+        // Anything longer than the buffer is cut off.
+        void setText(std::string_view _text)
+        {
+            length = _text.size() < sizeof(text) ? _text.size() : sizeof(text);
+            memcpy(text, _text.data(), length);
+        }
+
+        std::string_view getText() const { return std::string_view(text, length); }
+
+        char text[MaxScrollTextLength];
+        uint32_t originUs = 0;  // monitor::now() when the data shown arrived, 0 when not timed
+        uint8_t pos = 0;        // Page, the top page for the multi-page fonts
+        uint8_t column = 0;     // Ignored by Font::System, which always starts at the left edge
         uint8_t length = 0;
         Type type = Type::Clear;
+        Font font = Font::System;
     };
+    static_assert(sizeof(Event) <= MaxScrollTextLength + 12, "The event is copied through the queue, keep it small");
 
     void init();
     void deinit();
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace tr::app
+{
+    enum class Timer : uint8_t
+    {
+        Housekeeping,
+        Report,
+        InitDone,
+        Reboot,
+        Fetch,
+        Countdown,
+        Profile,
+        CalibrationIdle,
+    };
+
+    struct Event
+    {
+        enum class Type : uint8_t
+        {
+            ButtonPress,
+            ButtonLongPress,
+            DeparturesChanged,
+            OtaDone,
+            OtaFail,
+            Timeout,
+            TimerTick,
+            WifiFail,
+            WifiReady,
+
+            Count // Keep last
+        };
+        Type type = Type::ButtonPress;
+        Timer timer = Timer::Housekeeping;  // Type::Timeout only
+    };
+
+} // namespace tr::app
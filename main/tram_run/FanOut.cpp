@@ -0,0 +1,211 @@
+#include "tram_run/FanOut.hpp"
+#include "tram_run/FanOutProtocol.hpp"
+#include "tram_run/Fetcher.hpp"
+#include "tram_run/Persist.hpp"
+#include "tram_run/Rtos.hpp"
+
+#include "sdkconfig.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "esp_timer.h"
+
+#include "lwip/sockets.h"
+
+#include <errno.h>
+#include <time.h>
+
+namespace
+{
+    [[maybe_unused]] static const char* TAG = "TR_FANOUT";
+
+#if CONFIG_TR_FANOUT
+    constexpr uint32_t ReceiveTimeoutMs = 500;
+
+    static tr::rtos::StaticTask<CONFIG_TR_FANOUT_TASK_STACK> g_taskStorage;
+    static TaskHandle_t g_task = nullptr;
+    static tr::fanout::Election g_election{0, 0, {}};
+
+    uint32_t getNowMs()
+    {
+        return esp_timer_get_time() / 1000;
+    }
+
+    uint32_t getUnitId()
+    {
+        uint8_t mac[6];
+        ESP_ERROR_CHECK(esp_read_mac(mac, ESP_MAC_WIFI_STA));
+        return (uint32_t(mac[2]) << 24) | (mac[3] << 16) | (mac[4] << 8) | mac[5];
+    }
+
+    // One more than in the previous boot, so that the receivers can tell the late packets of
+    // the previous boots from the new ones. Stored before the first snapshot goes out, false
+    // when it could not be: the next boot would then announce with the same epoch.
+    bool nextEpoch(uint32_t& _epoch)
+    {
+        _epoch = 0;
+        tr::persist::get(tr::persist::Key::FanOutEpoch, _epoch);
+        _epoch++;
+        tr::persist::set(tr::persist::Key::FanOutEpoch, _epoch);
+        return tr::persist::flush();
+    }
+
+    const char* getRoleName(tr::fanout::Role _role)
+    {
+        switch (_role)
+        {
+        case tr::fanout::Role::Subscriber:
+            return "Subscriber";
+        case tr::fanout::Role::Fetcher:
+            return "Fetcher";
+        case tr::fanout::Role::Standalone:
+            return "Standalone";
+        }
+        return "?";
+    }
+
+    int openSocket(sockaddr_in& _group)
+    {
+        const int fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+        if (fd < 0)
+            return -1;
+
+        const int reuse = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+        sockaddr_in local = {};
+        local.sin_family = AF_INET;
+        local.sin_port = htons(CONFIG_TR_FANOUT_PORT);
+        local.sin_addr.s_addr = htonl(INADDR_ANY);
+
+        ip_mreq membership = {};
+        membership.imr_multiaddr.s_addr = inet_addr(CONFIG_TR_FANOUT_GROUP);
+        membership.imr_interface.s_addr = htonl(INADDR_ANY);
+
+        // The snapshots stay on the LAN and our own ones are not looped back
+        const uint8_t ttl = 1;
+        const uint8_t loop = 0;
+        timeval timeout = {};
+        timeout.tv_usec = ReceiveTimeoutMs * 1000;
+
+        if (bind(fd, reinterpret_cast<sockaddr*>(&local), sizeof(local)) < 0
+            || setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) < 0
+            || setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) < 0
+            || setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)) < 0
+            || setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) < 0)
+        {
+            close(fd);
+            return -1;
+        }
+
+        _group = {};
+        _group.sin_family = AF_INET;
+        _group.sin_port = htons(CONFIG_TR_FANOUT_PORT);
+        _group.sin_addr.s_addr = membership.imr_multiaddr.s_addr;
+        return fd;
+    }
+
+    void task(void* _pvParameter)
+    {
+        sockaddr_in group;
+        const int fd = openSocket(group);
+        if (fd < 0)
+        {
+            // Every unit then fetches on its own, as without the fan-out
+            ESP_LOGE(TAG, "Unable to join %s:%d, errno %d", CONFIG_TR_FANOUT_GROUP, CONFIG_TR_FANOUT_PORT, errno);
+            vTaskDelete(NULL);
+            return;
+        }
+
+        tr::fanout::Config config;
+        config.announceMs = CONFIG_TR_FANOUT_ANNOUNCE_S * 1000;
+        config.takeoverMs = 3 * config.announceMs;
+        uint32_t epoch = 0;
+        const bool epochStored = nextEpoch(epoch);
+        if (!epochStored)
+            ESP_LOGE(TAG, "Epoch %lu not stored, never announcing in this boot", epoch);
+        g_election = tr::fanout::Election{getUnitId(), epoch, config};
+        g_election.start(getNowMs(), epochStored);
+        tr::fetcher::setRemote(true);
+        tr::fanout::Role role = tr::fanout::Role::Subscriber;
+        ESP_LOGI(TAG, "Unit %08lx epoch %lu listening on %s:%d", getUnitId(), epoch, CONFIG_TR_FANOUT_GROUP, CONFIG_TR_FANOUT_PORT);
+
+        tr::departures::Board sent;
+        uint32_t sentMs = 0;
+        uint8_t message[tr::fanout::MaxMessageSize];
+        while (true)
+        {
+            const int size = recv(fd, message, sizeof(message), 0);
+            if (size > 0)
+            {
+                tr::fanout::Header header;
+                tr::departures::Board board;
+                if (tr::fanout::decode(message, size, header, board)
+                    && g_election.onMessage(header, getNowMs()) == tr::fanout::Verdict::Use)
+                {
+                    tr::fetcher::publishRemote(board);
+                }
+            }
+
+            const uint32_t now = getNowMs();
+            const tr::fanout::Role newRole = g_election.poll(now);
+            if (newRole != role)
+            {
+                role = newRole;
+                ESP_LOGI(TAG, "Now %s", getRoleName(role));
+
+                const bool remote = role == tr::fanout::Role::Subscriber;
+                tr::fetcher::setRemote(remote);
+                if (!remote)
+                {
+                    tr::fetcher::request();
+                    sentMs = now - config.announceMs;
+                }
+            }
+
+            if (role != tr::fanout::Role::Fetcher)
+                continue;
+
+            // A snapshot on every change and at least every announce period, as the heartbeat
+            const auto board = tr::fetcher::readBoard();
+            if (board.get() == sent && now - sentMs < config.announceMs)
+                continue;
+
+            const size_t length = tr::fanout::encode(g_election.makeHeader(time(nullptr)), board.get(), message, sizeof(message));
+            if (sendto(fd, message, length, 0, reinterpret_cast<const sockaddr*>(&group), sizeof(group)) < 0)
+                ESP_LOGW(TAG, "Send failed, errno %d", errno);
+            sent = board.get();
+            sentMs = now;
+        }
+    }
+#endif
+} // namespace
+
+namespace tr::fanout
+{
+    void start()
+    {
+#if CONFIG_TR_FANOUT
+        if (g_task == nullptr)
+            g_task = g_taskStorage.create(task, "FanOutTask", NULL, 4);
+#endif
+    }
+
+    void report()
+    {
+#if CONFIG_TR_FANOUT
+        if (g_task == nullptr)
+            return;
+
+        // Read without a lock, the counters are only informative
+        const Stats stats = g_election.getStats();
+        ESP_LOGI(TAG, "%s: used %lu, duplicates %lu, lost %lu, ignored %lu, takeovers %lu, yields %lu",
+            getRoleName(g_election.getRole()),
+            stats.used, stats.duplicates, stats.lost, stats.ignored, stats.takeovers, stats.yields);
+#endif
+    }
+
+} // namespace tr::fanout
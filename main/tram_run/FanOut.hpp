@@ -0,0 +1,11 @@
+#pragma once
+
+namespace tr::fanout
+{
+    // Starts the LAN fan-out once the network is up, see FanOutProtocol.hpp.
+    // Does nothing without CONFIG_TR_FANOUT.
+    void start();
+
+    void report();
+
+} // namespace tr::fanout
@@ -0,0 +1,248 @@
+#include "tram_run/FanOutProtocol.hpp"
+
+#include <string.h>
+
+namespace
+{
+    constexpr uint32_t StaggerSlots = 16;
+
+    void writeU32(uint8_t* _data, uint32_t _value)
+    {
+        _data[0] = _value & 0xFF;
+        _data[1] = (_value >> 8) & 0xFF;
+        _data[2] = (_value >> 16) & 0xFF;
+        _data[3] = _value >> 24;
+    }
+
+    uint32_t readU32(const uint8_t* _data)
+    {
+        return _data[0] | (_data[1] << 8) | (_data[2] << 16) | (uint32_t(_data[3]) << 24);
+    }
+} // namespace
+
+namespace tr::fanout
+{
+    size_t encode(const Header& _header, const departures::Board& _board, uint8_t* _data, size_t _size)
+    {
+        const uint8_t count = _board.count < departures::MaxVisible ? _board.count : departures::MaxVisible;
+        const size_t size = HeaderSize + count * DepartureSize;
+        if (_size < size)
+            return 0;
+
+        memset(_data, 0, size);
+        memcpy(_data, Magic, sizeof(Magic));
+        _data[4] = static_cast<uint8_t>(_header.type);
+        _data[5] = count;
+        writeU32(_data + 8, _header.unitId);
+        writeU32(_data + 12, _header.epoch);
+        writeU32(_data + 16, _header.sequence);
+        writeU32(_data + 20, _header.sentAt);
+
+        uint8_t* item = _data + HeaderSize;
+        for (uint8_t i = 0; i < count; ++i, item += DepartureSize)
+        {
+            const departures::Departure& departure = _board.items[i];
+            writeU32(item, departure.time);
+            writeU32(item + 4, departure.vehicleId);
+            memcpy(item + 8, departure.line, sizeof(departure.line));
+            item[14] = departure.source;
+        }
+        return size;
+    }
+
+    bool decode(const uint8_t* _data, size_t _size, Header& _header, departures::Board& _board)
+    {
+        if (_size < HeaderSize || memcmp(_data, Magic, sizeof(Magic)) != 0)
+            return false;
+        if (_data[4] != static_cast<uint8_t>(Type::Snapshot))
+            return false;
+
+        const uint8_t count = _data[5];
+        if (count > departures::MaxVisible || _size != HeaderSize + count * DepartureSize)
+            return false;
+
+        _header.type = Type::Snapshot;
+        _header.unitId = readU32(_data + 8);
+        _header.epoch = readU32(_data + 12);
+        _header.sequence = readU32(_data + 16);
+        _header.sentAt = readU32(_data + 20);
+
+        departures::Board board;
+        board.count = count;
+        const uint8_t* item = _data + HeaderSize;
+        for (uint8_t i = 0; i < count; ++i, item += DepartureSize)
+        {
+            departures::Departure& departure = board.items[i];
+            departure.time = readU32(item);
+            departure.vehicleId = readU32(item + 4);
+            memcpy(departure.line, item + 8, sizeof(departure.line));
+            departure.source = item[14];
+        }
+        _board = board;
+        return true;
+    }
+
+    Election::Election(uint32_t _unitId, uint32_t _epoch, Config _config)
+        : m_unitId{_unitId}
+        , m_epoch{_epoch}
+        , m_config{_config}
+    {
+    }
+
+    void Election::start(uint32_t _nowMs, bool _epochStored)
+    {
+        m_role = Role::Subscriber;
+        m_epochStored = _epochStored;
+        m_hasLeader = false;
+        m_lastHeardMs = _nowMs;
+    }
+
+    Verdict Election::onMessage(const Header& _header, uint32_t _nowMs)
+    {
+        if (_header.unitId == m_unitId)
+            return Verdict::Own;
+
+        if (isStale(_header, _nowMs))
+        {
+            m_stats.duplicates++;
+            return Verdict::Duplicate;
+        }
+
+        if (m_role == Role::Fetcher)
+        {
+            if (_header.unitId > m_unitId)
+            {
+                // It yields as soon as it hears us
+                m_stats.ignored++;
+                return Verdict::Ignored;
+            }
+
+            m_role = Role::Subscriber;
+            m_stats.yields++;
+            follow(_header, _nowMs);
+            return Verdict::Use;
+        }
+
+        if (m_role == Role::Standalone)
+        {
+            // Any fetcher is better than one more unit fetching on its own
+            m_role = Role::Subscriber;
+            m_stats.yields++;
+            follow(_header, _nowMs);
+            return Verdict::Use;
+        }
+
+        const bool leaderSilent = _nowMs - m_lastHeardMs >= getTakeoverMs();
+        if (!m_hasLeader || leaderSilent || _header.unitId < m_leaderId)
+        {
+            follow(_header, _nowMs);
+            return Verdict::Use;
+        }
+
+        if (_header.unitId != m_leaderId)
+        {
+            m_stats.ignored++;
+            return Verdict::Ignored;
+        }
+
+        const Known* leader = find(m_leaderId);
+        if (leader == nullptr || _header.epoch != leader->epoch)
+        {
+            // The fetcher rebooted, its sequence starts over
+            follow(_header, _nowMs);
+            return Verdict::Use;
+        }
+
+        const int32_t ahead = static_cast<int32_t>(_header.sequence - leader->sequence);
+        m_stats.lost += ahead - 1;
+        m_stats.used++;
+        remember(_header, _nowMs);
+        m_lastHeardMs = _nowMs;
+        return Verdict::Use;
+    }
+
+    Role Election::poll(uint32_t _nowMs)
+    {
+        if (m_role == Role::Subscriber && _nowMs - m_lastHeardMs >= getTakeoverMs())
+        {
+            m_role = m_epochStored ? Role::Fetcher : Role::Standalone;
+            m_hasLeader = false;
+            m_stats.takeovers++;
+        }
+        return m_role;
+    }
+
+    Header Election::makeHeader(uint32_t _sentAt)
+    {
+        Header header;
+        header.unitId = m_unitId;
+        header.epoch = m_epoch;
+        header.sequence = ++m_sequence;
+        header.sentAt = _sentAt;
+        return header;
+    }
+
+    bool Election::isStale(const Header& _header, uint32_t _nowMs) const
+    {
+        const Known* known = find(_header.unitId);
+        if (known == nullptr)
+            return false;
+
+        // Silent for the takeover time and for as long again after it, gone for good. It may
+        // come back with its boot counter lost, or after as many boots as it takes to wrap it.
+        if (_nowMs - known->heardMs >= 2 * getTakeoverMs())
+            return false;
+
+        // Both counters compared as newer than, so that they may wrap
+        const int32_t newerEpoch = static_cast<int32_t>(_header.epoch - known->epoch);
+        if (newerEpoch != 0)
+            return newerEpoch < 0;
+        return static_cast<int32_t>(_header.sequence - known->sequence) <= 0;
+    }
+
+    void Election::follow(const Header& _header, uint32_t _nowMs)
+    {
+        m_hasLeader = true;
+        m_leaderId = _header.unitId;
+        m_lastHeardMs = _nowMs;
+        remember(_header, _nowMs);
+        m_stats.used++;
+    }
+
+    const Election::Known* Election::find(uint32_t _unitId) const
+    {
+        for (uint8_t i = 0; i < m_knownCount; ++i)
+        {
+            if (m_known[i].unitId == _unitId)
+                return &m_known[i];
+        }
+        return nullptr;
+    }
+
+    void Election::remember(const Header& _header, uint32_t _nowMs)
+    {
+        Known* known = const_cast<Known*>(find(_header.unitId));
+        if (known == nullptr && m_knownCount < KnownCount)
+            known = &m_known[m_knownCount++];
+        if (known == nullptr)
+        {
+            known = &m_known[0];
+            for (uint8_t i = 1; i < KnownCount; ++i)
+            {
+                if (_nowMs - m_known[i].heardMs > _nowMs - known->heardMs)
+                    known = &m_known[i];
+            }
+        }
+
+        known->unitId = _header.unitId;
+        known->epoch = _header.epoch;
+        known->sequence = _header.sequence;
+        known->heardMs = _nowMs;
+    }
+
+    uint32_t Election::getTakeoverMs() const
+    {
+        return m_config.takeoverMs + (m_unitId % StaggerSlots) * m_config.staggerMs;
+    }
+
+} // namespace tr::fanout
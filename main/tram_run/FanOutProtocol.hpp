@@ -0,0 +1,140 @@
+#pragma once
+
+#include "tram_run/Departures.hpp"
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace tr::fanout
+{
+    // LAN fan-out: one unit fetches the departures and multicasts them, the others subscribe.
+    //
+    // Message, all little-endian:
+    //   "TRF1", uint8 type, uint8 departure count, uint16 reserved,
+    //   uint32 unit id, uint32 epoch (boot counter), uint32 sequence, uint32 unix time at the sender,
+    //   then per departure: uint32 time, uint32 vehicle id, char line[6], uint8 source, uint8 reserved
+    //
+    // The fetcher sends a snapshot when its board changes and at least every announce period,
+    // so the snapshots double as heartbeats. Receivers keep the last epoch and sequence of their
+    // fetcher and drop the duplicates and the late packets. A newer epoch means the fetcher
+    // rebooted, an older one is a packet of a previous boot and is dropped too. The last few
+    // fetchers are remembered, so that the replays of a previous fetcher are dropped as well.
+    // A fetcher that stays silent is forgotten one takeover time after the takeover, it may
+    // then come back with any epoch.
+    constexpr uint8_t Magic[4] = {'T', 'R', 'F', '1'};
+    constexpr size_t HeaderSize = 24;
+    constexpr size_t DepartureSize = 16;
+    constexpr size_t MaxMessageSize = HeaderSize + departures::MaxVisible * DepartureSize;
+
+    enum class Type : uint8_t
+    {
+        Snapshot = 1,
+    };
+
+    struct Header
+    {
+        Type type = Type::Snapshot;
+        uint32_t unitId = 0;
+        uint32_t epoch = 0;
+        uint32_t sequence = 0;
+        uint32_t sentAt = 0;
+    };
+
+    // Returns the message size, 0 when _size is too small
+    size_t encode(const Header& _header, const departures::Board& _board, uint8_t* _data, size_t _size);
+    bool decode(const uint8_t* _data, size_t _size, Header& _header, departures::Board& _board);
+
+    enum class Role : uint8_t
+    {
+        Subscriber,
+        Fetcher,
+        // Fetches for itself without announcing, the epoch of this boot could not be stored
+        Standalone,
+    };
+
+    enum class Verdict : uint8_t
+    {
+        Use,
+        Duplicate,      // An older epoch or the same epoch and an older sequence of the last fetcher
+        Ignored,        // Another fetcher than the followed one
+        Own,            // Our own packet looped back
+    };
+
+    struct Config
+    {
+        uint32_t announceMs = 5000;
+        // Silence of the fetcher before a subscriber takes over, plus a per unit stagger
+        // so that the subscribers do not all take over at once
+        uint32_t takeoverMs = 15000;
+        uint32_t staggerMs = 500;
+    };
+
+    struct Stats
+    {
+        uint32_t used = 0;
+        uint32_t duplicates = 0;
+        uint32_t lost = 0;          // Sequence gaps
+        uint32_t ignored = 0;
+        uint32_t takeovers = 0;
+        uint32_t yields = 0;
+    };
+
+    // Who fetches. Pure logic driven by the received headers and a millisecond clock.
+    // The lowest unit id wins: a fetcher hearing a lower one yields to it, a subscriber
+    // follows the lowest fetcher it hears and takes over when it stays silent.
+    class Election final
+    {
+    public:
+        Election(uint32_t _unitId, uint32_t _epoch, Config _config);
+
+        // Starts listening as a subscriber. Without _epochStored a takeover only goes Standalone:
+        // after a reboot the receivers would drop our snapshots as the ones of a previous boot.
+        void start(uint32_t _nowMs, bool _epochStored);
+        Verdict onMessage(const Header& _header, uint32_t _nowMs);
+        // Takes over when the fetcher went silent, returns the current role
+        Role poll(uint32_t _nowMs);
+
+        Role getRole() const { return m_role; }
+        bool hasLeader() const { return m_hasLeader; }
+        // The header of the next snapshot to send as the Fetcher
+        Header makeHeader(uint32_t _sentAt);
+        const Stats& getStats() const { return m_stats; }
+
+    private:
+        // The last epoch and sequence used from a fetcher
+        struct Known
+        {
+            uint32_t unitId = 0;
+            uint32_t epoch = 0;
+            uint32_t sequence = 0;
+            uint32_t heardMs = 0;
+        };
+
+        static constexpr uint8_t KnownCount = 4;
+
+        // From a fetcher we still remember and not newer than what we already have from it
+        bool isStale(const Header& _header, uint32_t _nowMs) const;
+        void follow(const Header& _header, uint32_t _nowMs);
+        const Known* find(uint32_t _unitId) const;
+        // Takes the place of the fetcher heard the longest ago when they are all taken
+        void remember(const Header& _header, uint32_t _nowMs);
+        uint32_t getTakeoverMs() const;
+
+        uint32_t m_unitId;
+        uint32_t m_epoch;
+        Config m_config;
+
+        Role m_role = Role::Subscriber;
+        bool m_epochStored = false;
+        bool m_hasLeader = false;
+        uint32_t m_leaderId = 0;
+        uint32_t m_lastHeardMs = 0;
+        // Kept for a takeover time after a takeover, an old fetcher may come back or its
+        // packets may arrive late
+        Known m_known[KnownCount];
+        uint8_t m_knownCount = 0;
+        uint32_t m_sequence = 0;
+        Stats m_stats;
+    };
+
+} // namespace tr::fanout
@@ -0,0 +1,249 @@
+#include "tram_run/Fetcher.hpp"
+#include "tram_run/Monitor.hpp"
+#include "tram_run/Persist.hpp"
+#include "tram_run/Power.hpp"
+#include "tram_run/Rtos.hpp"
+
+#include "sdkconfig.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_crt_bundle.h"
+#include "esp_http_client.h"
+#include "esp_log.h"
+
+#include <atomic>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+namespace
+{
+    static const char* TAG = "TR_FETCHER";
+
+    constexpr size_t MaxStopIdLength = 16;
+    constexpr size_t MaxUrlLength = 160;
+    constexpr uint32_t HttpTimeoutMs = 5000;
+    // Every stop may run into the HTTP timeout
+    constexpr uint32_t MonitorBudgetMs = HttpTimeoutMs * tr::departures::MaxSources;
+
+    static tr::rtos::StaticTask<CONFIG_TR_FETCHER_TASK_STACK> g_taskStorage;
+    static TaskHandle_t g_task = nullptr;
+
+    static tr::fetcher::OnBoardChangedCallback g_callback{};
+    static char g_stops[tr::departures::MaxSources][MaxStopIdLength];
+    static uint8_t g_stopCount = 0;
+
+    static tr::departures::RecordParser g_parser;
+    static tr::departures::Aggregator g_aggregator{CONFIG_TR_VISIBLE_DEPARTURES};
+    static tr::Snapshot<tr::departures::Board> g_board;
+    static std::atomic<uint32_t> g_arrivalUs{0};
+
+    // Fan-out subscriber: the boards come from another unit and the HTTP fetch is skipped
+    constexpr uint32_t FetchBit = 1;
+    constexpr uint32_t RemoteBit = 2;
+    static std::atomic<bool> g_remote{false};
+    static portMUX_TYPE g_remoteLock = portMUX_INITIALIZER_UNLOCKED;
+    static tr::departures::Board g_remoteBoard;
+    static uint32_t g_remoteArrivalUs = 0;
+
+    void parseStops()
+    {
+        const char* stops = CONFIG_TR_STOPS;
+        while (*stops != '\0' && g_stopCount < tr::departures::MaxSources)
+        {
+            const size_t length = strcspn(stops, ",");
+            if (length > 0 && length < MaxStopIdLength)
+            {
+                memcpy(g_stops[g_stopCount], stops, length);
+                g_stops[g_stopCount][length] = '\0';
+                g_stopCount++;
+            }
+            stops += length;
+            if (*stops == ',')
+                stops++;
+        }
+        ESP_LOGI(TAG, "%u stops", g_stopCount);
+    }
+
+    esp_err_t onHttpEvent(esp_http_client_event_t* _event)
+    {
+        if (_event->event_id == HTTP_EVENT_ON_DATA)
+            g_parser.feed(static_cast<const char*>(_event->data), _event->data_len);
+        return ESP_OK;
+    }
+
+    bool fetchAll()
+    {
+        char url[MaxUrlLength];
+        snprintf(url, sizeof(url), CONFIG_TR_DEPARTURES_URL, g_stops[0]);
+
+        // One client for all the stops: with keep-alive the requests go over the same connection,
+        // so there is a single TCP (and TLS) handshake per round
+        esp_http_client_config_t config = {};
+        config.url = url;
+        config.timeout_ms = HttpTimeoutMs;
+        config.keep_alive_enable = true;
+        config.event_handler = onHttpEvent;
+#if CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
+        config.crt_bundle_attach = esp_crt_bundle_attach;
+#endif
+        esp_http_client_handle_t client = esp_http_client_init(&config);
+        if (client == nullptr)
+            return false;
+
+        bool changed = false;
+        for (uint8_t source = 0; source < g_stopCount; ++source)
+        {
+            snprintf(url, sizeof(url), CONFIG_TR_DEPARTURES_URL, g_stops[source]);
+            esp_http_client_set_url(client, url);
+
+            g_parser.reset();
+            const esp_err_t err = esp_http_client_perform(client);
+            if (err != ESP_OK || esp_http_client_get_status_code(client) != 200)
+            {
+                // Keep the last list of the stop rather than showing nothing
+                ESP_LOGW(TAG, "Stop %s failed: %s, status %d", g_stops[source], esp_err_to_name(err), esp_http_client_get_status_code(client));
+                continue;
+            }
+            g_parser.endRecord();
+
+            changed |= g_aggregator.update(source, g_parser.items, g_parser.count, time(nullptr));
+        }
+        changed |= g_aggregator.expire(time(nullptr));
+
+        esp_http_client_cleanup(client);
+        return changed;
+    }
+
+    // The last good board is shown until the first fetch, as long as it is not all in the past.
+    // After the overnight deep sleep it is still in RTC memory, the flash is not read.
+    void restoreBoard()
+    {
+        tr::departures::Board saved;
+        if (tr::power::isWarmBoot())
+            saved = tr::power::getRetained().board;
+        else if (!tr::persist::get(tr::persist::Key::Departures, saved))
+            return;
+
+        const time_t now = time(nullptr);
+        struct tm local;
+        localtime_r(&now, &local);
+        if (!tr::power::isTimeValid(local))
+            return;
+
+        for (uint8_t source = 0; source < tr::departures::MaxSources; ++source)
+        {
+            tr::departures::Departure items[tr::departures::MaxVisible];
+            uint8_t count = 0;
+            for (uint8_t i = 0; i < saved.count && i < tr::departures::MaxVisible; ++i)
+            {
+                if (saved.items[i].source == source)
+                    items[count++] = saved.items[i];
+            }
+            g_aggregator.update(source, items, count, now);
+        }
+
+        *g_board.beginWrite() = g_aggregator.getBoard();
+        g_board.publish();
+        ESP_LOGI(TAG, "Restored %u departures", g_aggregator.getBoard().count);
+    }
+
+    // Only called from the fetcher task, which keeps it the single writer of the snapshot
+    void publish(const tr::departures::Board& _board, uint32_t _arrivalUs)
+    {
+        // The App unpins the board quickly, only this task ever waits
+        tr::departures::Board* board = nullptr;
+        while ((board = g_board.beginWrite()) == nullptr)
+            vTaskDelay(1);
+        *board = _board;
+        g_board.publish();
+
+        // The store coalesces the writes, most boards never reach the flash
+        tr::persist::set(tr::persist::Key::Departures, _board);
+
+        g_arrivalUs.store(_arrivalUs);
+        g_callback();
+    }
+
+    void task(void* _pvParameter)
+    {
+        while (true)
+        {
+            uint32_t bits = 0;
+            xTaskNotifyWait(0, FetchBit | RemoteBit, &bits, portMAX_DELAY);
+            tr::monitor::begin(tr::monitor::Task::Fetcher);
+
+            if (bits & RemoteBit)
+            {
+                taskENTER_CRITICAL(&g_remoteLock);
+                const tr::departures::Board board = g_remoteBoard;
+                const uint32_t arrivalUs = g_remoteArrivalUs;
+                taskEXIT_CRITICAL(&g_remoteLock);
+
+                publish(board, arrivalUs);
+            }
+
+            if ((bits & FetchBit) && !g_remote.load())
+            {
+                tr::power::setBusy(true);
+                const bool changed = fetchAll();
+                tr::power::setBusy(false);
+
+                if (changed)
+                    publish(g_aggregator.getBoard(), tr::monitor::now());
+            }
+            tr::monitor::end(tr::monitor::Task::Fetcher);
+        }
+    }
+
+} // namespace
+
+namespace tr::fetcher
+{
+    void init(OnBoardChangedCallback _callback)
+    {
+        ESP_LOGI(TAG, "Init");
+
+        g_callback = _callback;
+        parseStops();
+        restoreBoard();
+
+        g_task = g_taskStorage.create(task, "FetcherTask", NULL, 5);
+        tr::monitor::addTask(tr::monitor::Task::Fetcher, g_task, nullptr, MonitorBudgetMs);
+    }
+
+    void request()
+    {
+        if (g_stopCount > 0 && !g_remote.load())
+            xTaskNotify(g_task, FetchBit, eSetBits);
+    }
+
+    void setRemote(bool _remote)
+    {
+        g_remote.store(_remote);
+    }
+
+    void publishRemote(const departures::Board& _board)
+    {
+        const uint32_t arrivalUs = monitor::now();
+        taskENTER_CRITICAL(&g_remoteLock);
+        g_remoteBoard = _board;
+        g_remoteArrivalUs = arrivalUs;
+        taskEXIT_CRITICAL(&g_remoteLock);
+
+        xTaskNotify(g_task, RemoteBit, eSetBits);
+    }
+
+    Snapshot<departures::Board>::Reader readBoard()
+    {
+        return g_board.read();
+    }
+
+    uint32_t getArrivalUs()
+    {
+        return g_arrivalUs.load();
+    }
+
+} // namespace tr::fetcher
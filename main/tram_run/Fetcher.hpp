@@ -0,0 +1,24 @@
+#pragma once
+
+#include "tram_run/Delegate.hpp"
+#include "tram_run/Departures.hpp"
+#include "tram_run/Snapshot.hpp"
+
+namespace tr::fetcher
+{
+    // Called from the fetcher task whenever the visible board changed
+    using OnBoardChangedCallback = Delegate<void()>;
+
+    void init(OnBoardChangedCallback _callback);
+    // Fetches all the configured stops once, in the background
+    void request();
+
+    // Fan-out subscriber mode: request() does nothing and the boards come through publishRemote()
+    void setRemote(bool _remote);
+    void publishRemote(const departures::Board& _board);
+    // The last published board, used in place, never blocked by a fetch in progress
+    Snapshot<departures::Board>::Reader readBoard();
+    // monitor::now() when the data of the last published board arrived
+    uint32_t getArrivalUs();
+
+} // namespace tr::fetcher
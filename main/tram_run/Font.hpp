@@ -0,0 +1,204 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <array>
+#include <string_view>
+
+namespace tr::display::font
+{
+    // Glyphs are stored in the SSD1306 memory layout: one byte is a column of 8 vertical pixels
+    // and a glyph is Pages rows of Width such bytes, so every glyph page goes to the panel as is.
+    template <uint8_t W, uint8_t P, size_t Count>
+    struct Atlas
+    {
+        std::string_view charset;
+        std::array<std::array<uint8_t, W * P>, Count> glyphs{};
+    };
+
+    // Type-erased view over an atlas, used both for compile-time layout and by the renderer
+    struct View
+    {
+        std::string_view charset;
+        const uint8_t* glyphs = nullptr;
+        uint8_t width = 0;
+        uint8_t pages = 0;
+        uint8_t spacing = 0;
+
+        constexpr uint8_t cellWidth() const { return width + spacing; }
+
+        // Unknown characters fall back to the first glyph of the charset, which is always a blank
+        constexpr uint8_t indexOf(char _c) const
+        {
+            if (_c >= 'a' && _c <= 'z')
+                _c = static_cast<char>(_c - 'a' + 'A');
+            const size_t index = charset.find(_c);
+            return index == std::string_view::npos ? 0 : static_cast<uint8_t>(index);
+        }
+
+        constexpr const uint8_t* page(uint8_t _glyph, uint8_t _page) const
+        {
+            return glyphs + (_glyph * pages + _page) * width;
+        }
+
+        constexpr unsigned measure(std::string_view _text) const
+        {
+            return _text.empty() ? 0 : _text.size() * cellWidth() - spacing;
+        }
+
+        constexpr uint8_t centerColumn(std::string_view _text, unsigned _screenWidth = 128) const
+        {
+            const unsigned width = measure(_text);
+            return width >= _screenWidth ? 0 : static_cast<uint8_t>((_screenWidth - width) / 2);
+        }
+    };
+
+    template <uint8_t W, uint8_t P, size_t Count>
+    constexpr View makeView(const Atlas<W, P, Count>& _atlas)
+    {
+        static_assert(sizeof(_atlas.glyphs) == W * P * Count, "Glyphs must be contiguous");
+        return View{_atlas.charset, _atlas.glyphs[0].data(), W, P, static_cast<uint8_t>(1 + W / 8)};
+    }
+
+    namespace detail
+    {
+        enum Segment : uint8_t
+        {
+            A = 1 << 0, B = 1 << 1, C = 1 << 2, D = 1 << 3, E = 1 << 4, F = 1 << 5, G = 1 << 6
+        };
+
+        // Seven-segment masks for " 0123456789-"
+        constexpr uint8_t DigitSegments[] = {
+            0,
+            A | B | C | D | E | F,
+            B | C,
+            A | B | D | E | G,
+            A | B | C | D | G,
+            B | C | F | G,
+            A | C | D | F | G,
+            A | C | D | E | F | G,
+            A | B | C,
+            A | B | C | D | E | F | G,
+            A | B | C | D | F | G,
+            G,
+        };
+
+        template <uint8_t W, uint8_t P>
+        constexpr bool isSegmentPixel(uint8_t _segments, unsigned _x, unsigned _y)
+        {
+            constexpr unsigned H = P * 8;
+            constexpr unsigned T = W / 5 > 2 ? W / 5 : 2;
+            constexpr unsigned Mid = H / 2;
+
+            const bool left = _x < T;
+            const bool right = _x >= W - T;
+            const bool inner = !left && !right;
+            const bool upper = _y >= T && _y < Mid;
+            const bool lower = _y >= Mid && _y < H - T;
+
+            return ((_segments & A) && inner && _y < T)
+                || ((_segments & B) && right && upper)
+                || ((_segments & C) && right && lower)
+                || ((_segments & D) && inner && _y >= H - T)
+                || ((_segments & E) && left && lower)
+                || ((_segments & F) && left && upper)
+                || ((_segments & G) && inner && _y >= Mid - T / 2 && _y < Mid - T / 2 + T);
+        }
+
+        template <uint8_t W, uint8_t P>
+        constexpr auto makeDigits()
+        {
+            Atlas<W, P, sizeof(DigitSegments)> atlas{" 0123456789-"};
+            for (size_t g = 0; g < sizeof(DigitSegments); ++g)
+            {
+                for (unsigned page = 0; page < P; ++page)
+                {
+                    for (unsigned x = 0; x < W; ++x)
+                    {
+                        uint8_t column = 0;
+                        for (unsigned bit = 0; bit < 8; ++bit)
+                        {
+                            if (isSegmentPixel<W, P>(DigitSegments[g], x, page * 8 + bit))
+                                column |= 1 << bit;
+                        }
+                        atlas.glyphs[g][page * W + x] = column;
+                    }
+                }
+            }
+            return atlas;
+        }
+
+        constexpr auto makeSmall()
+        {
+            // Classic 5x7 font, column-major, bit 0 is the top row
+            constexpr uint8_t Columns[][5] = {
+                {0x00, 0x00, 0x00, 0x00, 0x00}, // ' '
+                {0x3E, 0x51, 0x49, 0x45, 0x3E}, // 0
+                {0x00, 0x42, 0x7F, 0x40, 0x00}, // 1
+                {0x42, 0x61, 0x51, 0x49, 0x46}, // 2
+                {0x21, 0x41, 0x45, 0x4B, 0x31}, // 3
+                {0x18, 0x14, 0x12, 0x7F, 0x10}, // 4
+                {0x27, 0x45, 0x45, 0x45, 0x39}, // 5
+                {0x3C, 0x4A, 0x49, 0x49, 0x30}, // 6
+                {0x01, 0x71, 0x09, 0x05, 0x03}, // 7
+                {0x36, 0x49, 0x49, 0x49, 0x36}, // 8
+                {0x06, 0x49, 0x49, 0x29, 0x1E}, // 9
+                {0x7E, 0x11, 0x11, 0x11, 0x7E}, // A
+                {0x7F, 0x49, 0x49, 0x49, 0x36}, // B
+                {0x3E, 0x41, 0x41, 0x41, 0x22}, // C
+                {0x7F, 0x41, 0x41, 0x22, 0x1C}, // D
+                {0x7F, 0x49, 0x49, 0x49, 0x41}, // E
+                {0x7F, 0x09, 0x09, 0x01, 0x01}, // F
+                {0x3E, 0x41, 0x41, 0x51, 0x32}, // G
+                {0x7F, 0x08, 0x08, 0x08, 0x7F}, // H
+                {0x00, 0x41, 0x7F, 0x41, 0x00}, // I
+                {0x20, 0x40, 0x41, 0x3F, 0x01}, // J
+                {0x7F, 0x08, 0x14, 0x22, 0x41}, // K
+                {0x7F, 0x40, 0x40, 0x40, 0x40}, // L
+                {0x7F, 0x02, 0x04, 0x02, 0x7F}, // M
+                {0x7F, 0x04, 0x08, 0x10, 0x7F}, // N
+                {0x3E, 0x41, 0x41, 0x41, 0x3E}, // O
+                {0x7F, 0x09, 0x09, 0x09, 0x06}, // P
+                {0x3E, 0x41, 0x51, 0x21, 0x5E}, // Q
+                {0x7F, 0x09, 0x19, 0x29, 0x46}, // R
+                {0x46, 0x49, 0x49, 0x49, 0x31}, // S
+                {0x01, 0x01, 0x7F, 0x01, 0x01}, // T
+                {0x3F, 0x40, 0x40, 0x40, 0x3F}, // U
+                {0x1F, 0x20, 0x40, 0x20, 0x1F}, // V
+                {0x7F, 0x20, 0x18, 0x20, 0x7F}, // W
+                {0x63, 0x14, 0x08, 0x14, 0x63}, // X
+                {0x03, 0x04, 0x78, 0x04, 0x03}, // Y
+                {0x61, 0x51, 0x49, 0x45, 0x43}, // Z
+                {0x08, 0x08, 0x08, 0x08, 0x08}, // -
+                {0x00, 0x60, 0x60, 0x00, 0x00}, // .
+                {0x00, 0x36, 0x36, 0x00, 0x00}, // :
+                {0x20, 0x10, 0x08, 0x04, 0x02}, // /
+            };
+            constexpr size_t Count = sizeof(Columns) / sizeof(Columns[0]);
+
+            Atlas<5, 1, Count> atlas{" 0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ-.:/"};
+            for (size_t g = 0; g < Count; ++g)
+            {
+                for (size_t x = 0; x < 5; ++x)
+                    atlas.glyphs[g][x] = Columns[g][x];
+            }
+            return atlas;
+        }
+
+        inline constexpr auto SmallAtlas = makeSmall();
+        inline constexpr auto Digits16Atlas = makeDigits<10, 2>();
+        inline constexpr auto Digits32Atlas = makeDigits<16, 4>();
+    } // namespace detail
+
+    // Line names and labels, one page high
+    inline constexpr View Small = makeView(detail::SmallAtlas);
+    // Countdown digits readable across a room, two and four pages high
+    inline constexpr View Digits16 = makeView(detail::Digits16Atlas);
+    inline constexpr View Digits32 = makeView(detail::Digits32Atlas);
+
+    static_assert(Small.charset.size() == detail::SmallAtlas.glyphs.size());
+    static_assert(Small.indexOf('?') == 0 && Small.indexOf('a') == Small.indexOf('A'));
+    static_assert(Digits32.measure("12") == 2 * 16 + Digits32.spacing);
+
+} // namespace tr::display::font
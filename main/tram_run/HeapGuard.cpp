@@ -0,0 +1,89 @@
+#include "tram_run/HeapGuard.hpp"
+#include "tram_run/Profiler.hpp"
+
+#include "sdkconfig.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_attr.h"
+#include "esp_log.h"
+
+#include <atomic>
+#include <stdlib.h>
+
+#if CONFIG_TR_HEAP_GUARD
+#include "esp_heap_caps.h"
+#endif
+
+namespace
+{
+    [[maybe_unused]] static const char* TAG = "TR_HEAP_GUARD";
+
+    constexpr unsigned MaxArmedTasks = 8;
+
+    static std::atomic<TaskHandle_t> g_armedTasks[MaxArmedTasks] = {};
+    static std::atomic<uint32_t> g_violationCount{0};
+
+    [[maybe_unused]] IRAM_ATTR bool isCurrentTaskArmed()
+    {
+        const TaskHandle_t current = xTaskGetCurrentTaskHandle();
+        for (const auto& armed : g_armedTasks)
+        {
+            if (armed.load(std::memory_order_relaxed) == current)
+                return true;
+        }
+        return false;
+    }
+} // namespace
+
+// The heap hooks are also the profiler's, the IDF allows a single definition of them
+#if CONFIG_TR_HEAP_GUARD || CONFIG_TR_PROFILE
+extern "C" IRAM_ATTR void esp_heap_trace_alloc_hook(void* _ptr, size_t _size, uint32_t _caps)
+{
+    tr::profiler::onAlloc(_ptr, _size);
+
+#if CONFIG_TR_HEAP_GUARD
+    if (!isCurrentTaskArmed())
+        return;
+
+    g_violationCount.fetch_add(1, std::memory_order_relaxed);
+#if CONFIG_TR_HEAP_GUARD_ABORT
+    abort();
+#endif
+#endif
+}
+
+extern "C" IRAM_ATTR void esp_heap_trace_free_hook(void* _ptr)
+{
+    tr::profiler::onFree(_ptr);
+}
+#endif
+
+namespace tr::heap_guard
+{
+    void armCurrentTask()
+    {
+#if CONFIG_TR_HEAP_GUARD
+        if (isCurrentTaskArmed())
+            return;
+
+        const TaskHandle_t current = xTaskGetCurrentTaskHandle();
+        ESP_LOGI(TAG, "Arm %s", pcTaskGetName(current));
+
+        for (auto& armed : g_armedTasks)
+        {
+            TaskHandle_t expected = nullptr;
+            if (armed.compare_exchange_strong(expected, current))
+                return;
+        }
+        configASSERT(false);
+#endif
+    }
+
+    uint32_t getViolationCount()
+    {
+        return g_violationCount.load(std::memory_order_relaxed);
+    }
+
+} // namespace tr::heap_guard
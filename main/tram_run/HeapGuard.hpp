@@ -0,0 +1,15 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace tr::heap_guard
+{
+    // After a task calls armCurrentTask() every heap allocation made from it is a violation,
+    // arming an armed task again does nothing.
+    // Violations are counted, or abort the firmware when CONFIG_TR_HEAP_GUARD_ABORT is set.
+    // Without CONFIG_TR_HEAP_GUARD all of it compiles to nothing.
+
+    void armCurrentTask();
+    uint32_t getViolationCount();
+
+} // namespace tr::heap_guard
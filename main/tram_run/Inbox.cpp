@@ -0,0 +1,154 @@
+#include "tram_run/Inbox.hpp"
+
+#include "esp_log.h"
+
+namespace
+{
+    static const char* TAG = "TR_INBOX";
+
+    static_assert(static_cast<unsigned>(tr::app::Event::Type::Count) <= 32, "The pending types must fit the mask");
+
+    uint32_t toBit(tr::app::Event::Type _type)
+    {
+        return 1u << static_cast<uint8_t>(_type);
+    }
+} // namespace
+
+namespace tr::app
+{
+    void Inbox::setReceiver(TaskHandle_t _task)
+    {
+        m_receiver = _task;
+    }
+
+    bool Inbox::post(const Event& _event)
+    {
+        const bool inIsr = xPortInIsrContext();
+        if (inIsr)
+            taskENTER_CRITICAL_ISR(&m_lock);
+        else
+            taskENTER_CRITICAL(&m_lock);
+
+        Ring& ring = m_lanes[static_cast<uint8_t>(getLane(_event.type))];
+        bool accepted = true;
+        bool queued = false;
+
+        if (isCoalesced(_event.type) && (m_pendingTypes & toBit(_event.type)))
+        {
+            ring.stats.coalesced++;
+        }
+        else if (ring.size == LaneCapacity)
+        {
+            ring.stats.overflows++;
+            accepted = false;
+        }
+        else
+        {
+            ring.events[(ring.head + ring.size) % LaneCapacity] = _event;
+            ring.size++;
+            ring.stats.posted++;
+            if (ring.size > ring.stats.highWaterMark)
+                ring.stats.highWaterMark = ring.size;
+
+            m_pendingTypes |= toBit(_event.type);
+            queued = true;
+        }
+
+        if (inIsr)
+            taskEXIT_CRITICAL_ISR(&m_lock);
+        else
+            taskEXIT_CRITICAL(&m_lock);
+
+        if (queued && m_receiver != nullptr)
+        {
+            if (inIsr)
+            {
+                BaseType_t higherPriorityTaskWoken = pdFALSE;
+                vTaskNotifyGiveFromISR(m_receiver, &higherPriorityTaskWoken);
+                portYIELD_FROM_ISR(higherPriorityTaskWoken);
+            }
+            else
+            {
+                xTaskNotifyGive(m_receiver);
+            }
+        }
+        return accepted;
+    }
+
+    bool Inbox::pop(Event& _event)
+    {
+        bool popped = false;
+
+        taskENTER_CRITICAL(&m_lock);
+        for (Ring& ring : m_lanes)
+        {
+            if (ring.size == 0)
+                continue;
+
+            _event = ring.events[ring.head];
+            ring.head = (ring.head + 1) % LaneCapacity;
+            ring.size--;
+            popped = true;
+            break;
+        }
+
+        if (popped)
+        {
+            // Another event of the same type may still wait if the type is not coalesced
+            bool stillPending = false;
+            for (const Ring& ring : m_lanes)
+            {
+                for (uint8_t i = 0; i < ring.size && !stillPending; ++i)
+                    stillPending = ring.events[(ring.head + i) % LaneCapacity].type == _event.type;
+            }
+            if (!stillPending)
+                m_pendingTypes &= ~toBit(_event.type);
+        }
+        taskEXIT_CRITICAL(&m_lock);
+
+        return popped;
+    }
+
+    Inbox::LaneStats Inbox::getStats(Lane _lane) const
+    {
+        taskENTER_CRITICAL(&m_lock);
+        const LaneStats stats = m_lanes[static_cast<uint8_t>(_lane)].stats;
+        taskEXIT_CRITICAL(&m_lock);
+        return stats;
+    }
+
+    void Inbox::logStats() const
+    {
+        const char* names[] = {"control", "bulk"};
+        for (uint8_t lane = 0; lane < static_cast<uint8_t>(Lane::Count); ++lane)
+        {
+            const LaneStats stats = getStats(static_cast<Lane>(lane));
+            ESP_LOGI(TAG, "Lane %s: posted %lu, coalesced %lu, overflows %lu, high water %u/%u",
+                names[lane], stats.posted, stats.coalesced, stats.overflows, stats.highWaterMark, LaneCapacity);
+        }
+    }
+
+    Inbox::Lane Inbox::getLane(Event::Type _type)
+    {
+        switch (_type)
+        {
+            case Event::Type::ButtonPress:
+            case Event::Type::ButtonLongPress:
+            case Event::Type::OtaDone:
+            case Event::Type::OtaFail:
+            case Event::Type::WifiFail:
+            case Event::Type::WifiReady:
+                return Lane::Control;
+            default:
+                return Lane::Bulk;
+        }
+    }
+
+    bool Inbox::isCoalesced(Event::Type _type)
+    {
+        // Every press counts, a long press steps the calibration to its next point.
+        // The rest are level-like signals where only the latest matters.
+        return _type != Event::Type::ButtonPress && _type != Event::Type::ButtonLongPress;
+    }
+
+} // namespace tr::app
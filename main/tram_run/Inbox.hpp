@@ -0,0 +1,67 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "tram_run/Event.hpp"
+
+namespace tr::app
+{
+    // The App event inbox. Posting never blocks and is safe from tasks, the event loop and ISRs,
+    // so a busy main task can never stall the producers.
+    // Control events (Wi-Fi, buttons) have their own lane that is always drained first.
+    // Apart from the short and long presses, which all count, an event type that is already
+    // waiting in the inbox is coalesced instead of queued twice:
+    // the waiting event keeps its place in the lane and its payload, the new one is dropped.
+    // That is only right for signals without a payload, a type whose latest value matters
+    // (the timeouts, polled from the TimerService) must not be posted as a coalesced type.
+    class Inbox final
+    {
+    public:
+        enum class Lane : uint8_t
+        {
+            Control,
+            Bulk,
+
+            Count // Keep last
+        };
+
+        struct LaneStats
+        {
+            uint32_t posted = 0;
+            uint32_t coalesced = 0;
+            uint32_t overflows = 0;
+            uint8_t highWaterMark = 0;
+        };
+
+        static constexpr uint8_t LaneCapacity = 8;
+
+        // The task woken up by a post
+        void setReceiver(TaskHandle_t _task);
+
+        // False when the lane is full, the event is dropped and counted
+        bool post(const Event& _event);
+        bool pop(Event& _event);
+
+        LaneStats getStats(Lane _lane) const;
+        void logStats() const;
+
+    private:
+        struct Ring
+        {
+            Event events[LaneCapacity];
+            uint8_t head = 0;
+            uint8_t size = 0;
+            LaneStats stats;
+        };
+
+        static Lane getLane(Event::Type _type);
+        static bool isCoalesced(Event::Type _type);
+
+        mutable portMUX_TYPE m_lock = portMUX_INITIALIZER_UNLOCKED;
+        Ring m_lanes[static_cast<uint8_t>(Lane::Count)];
+        uint32_t m_pendingTypes = 0;
+        TaskHandle_t m_receiver = nullptr;
+    };
+
+} // namespace tr::app
@@ -1,4 +1,9 @@
 #include "tram_run/Input.hpp"
+#include "tram_run/HeapGuard.hpp"
+#include "tram_run/Monitor.hpp"
+#include "tram_run/Rtos.hpp"
+
+#include "sdkconfig.h"
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -6,19 +11,26 @@
 #include "driver/gpio.h"
 #include "esp_log.h"
 
+#include <atomic>
+
 namespace
 {
     static const char* TAG = "TR_INPUT";
 
+    // One poll of the button, the callbacks only post to the App
+    constexpr uint32_t MonitorBudgetMs = 50;
+
     static gpio_num_t g_gpio = gpio_num_t::GPIO_NUM_NC;
     static tr::input::OnButtonPressCallback g_pressCb;
     static tr::input::OnButtonPressCallback g_longPressCb;
 
+    static tr::rtos::StaticTask<CONFIG_TR_INPUT_TASK_STACK> g_taskStorage;
     static TaskHandle_t g_task = nullptr;
+    static std::atomic<uint8_t> g_injectedPresses{0};
 
     void task(void* _pvParameter)
     {
-        const TickType_t xFrequency = pdMS_TO_TICKS(200); // TODO add to config
+        const TickType_t xFrequency = pdMS_TO_TICKS(tr::input::PollPeriodMs);
 
         {
             gpio_config_t io_conf = {};
@@ -32,10 +44,13 @@ namespace
             configASSERT(config_result == ESP_OK);
         }
 
+        tr::heap_guard::armCurrentTask();
+
         TickType_t pressTime = 0;
         bool pressed = false;
         while (true)
         {
+            tr::monitor::begin(tr::monitor::Task::Input);
             if (gpio_get_level(g_gpio) == 0)
             {
                 if (!pressed)
@@ -58,6 +73,14 @@ namespace
                 }
             }
 
+            uint8_t injected = g_injectedPresses.load();
+            while (injected > 0 && !g_injectedPresses.compare_exchange_weak(injected, injected - 1))
+            {
+            }
+            if (injected > 0)
+                g_pressCb();
+
+            tr::monitor::end(tr::monitor::Task::Input);
             vTaskDelay(xFrequency);
         }
     }
@@ -74,8 +97,8 @@ namespace tr::input
         g_pressCb = _pressCb;
         g_longPressCb = _longPressCb;
 
-        BaseType_t ret = xTaskCreate(task, "DisplayTask", 2048, NULL, 9, &g_task);
-        configASSERT(ret == pdPASS);
+        g_task = g_taskStorage.create(task, "InputTask", NULL, 9);
+        tr::monitor::addTask(tr::monitor::Task::Input, g_task, nullptr, MonitorBudgetMs);
     }
 
     void deinit()
@@ -83,4 +106,9 @@ namespace tr::input
         vTaskDelete(g_task);
     }
 
+    void injectPresses(uint8_t _count)
+    {
+        g_injectedPresses.fetch_add(_count);
+    }
+
 } // namespace tr::input
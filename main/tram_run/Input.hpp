@@ -1,14 +1,19 @@
 #pragma once
 
 #include "driver/gpio.h"
-#include <functional>
+#include "tram_run/Delegate.hpp"
 
 namespace tr::input
 {
-    using OnButtonPressCallback = std::function<void()>;
-    using OnButtonPressCallback = std::function<void()>;
+    using OnButtonPressCallback = Delegate<void()>;
+
+    constexpr uint32_t PollPeriodMs = 200; // TODO add to config
 
     void init(gpio_num_t _gpio, OnButtonPressCallback _pressCb, OnButtonPressCallback _longPressCb);
     void deinit();
 
+    // Presses delivered by the input task as if the button was pressed, for the profiling scenario.
+    // One press per poll, as fast as a real button, so the App inbox never has to hold all of them.
+    void injectPresses(uint8_t _count);
+
 } // namespace tr::input
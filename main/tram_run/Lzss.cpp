@@ -0,0 +1,116 @@
+#include "tram_run/Lzss.hpp"
+
+#include <string.h>
+
+namespace tr::lzss
+{
+    void Decoder::reset(Sink _sink)
+    {
+        m_sink = _sink;
+        memset(m_window, 0, sizeof(m_window));
+        m_windowPos = 0;
+        m_outputSize = 0;
+        m_headerSize = 0;
+        m_headerDone = false;
+        m_expectedSize = 0;
+        m_produced = 0;
+        m_flags = 0;
+        m_flagsLeft = 0;
+        m_referencePending = false;
+    }
+
+    Decoder::Status Decoder::feed(const uint8_t* _data, size_t _size)
+    {
+        for (size_t i = 0; i < _size; ++i)
+        {
+            const uint8_t byte = _data[i];
+
+            if (!m_headerDone)
+            {
+                m_header[m_headerSize++] = byte;
+                if (m_headerSize < sizeof(m_header))
+                    continue;
+
+                if (memcmp(m_header, Magic, sizeof(Magic)) != 0)
+                    return Status::BadHeader;
+                m_expectedSize = m_header[4] | (m_header[5] << 8) | (m_header[6] << 16) | (uint32_t(m_header[7]) << 24);
+                m_headerDone = true;
+                continue;
+            }
+
+            if (m_referencePending)
+            {
+                m_referencePending = false;
+
+                const uint16_t reference = (m_referenceHigh << 8) | byte;
+                const unsigned distance = (reference >> LengthBits) + 1;
+                const unsigned length = (reference & ((1u << LengthBits) - 1)) + MinMatch;
+                if (distance > m_produced)
+                    return Status::BadReference;
+                for (unsigned n = 0; n < length; ++n)
+                {
+                    const Status status = put(m_window[(m_windowPos - distance) & (WindowSize - 1)]);
+                    if (status != Status::Ok)
+                        return status;
+                }
+                continue;
+            }
+
+            if (m_flagsLeft == 0)
+            {
+                m_flags = byte;
+                m_flagsLeft = 8;
+                continue;
+            }
+
+            const bool literal = m_flags & 1;
+            m_flags >>= 1;
+            m_flagsLeft--;
+
+            if (literal)
+            {
+                const Status status = put(byte);
+                if (status != Status::Ok)
+                    return status;
+            }
+            else
+            {
+                m_referenceHigh = byte;
+                m_referencePending = true;
+            }
+        }
+        return Status::Ok;
+    }
+
+    Decoder::Status Decoder::finish()
+    {
+        const Status status = flush();
+        if (status != Status::Ok)
+            return status;
+        return isComplete() ? Status::Ok : Status::Truncated;
+    }
+
+    Decoder::Status Decoder::put(uint8_t _byte)
+    {
+        if (m_produced == m_expectedSize)
+            return Status::Overrun;
+
+        m_window[m_windowPos] = _byte;
+        m_windowPos = (m_windowPos + 1) & (WindowSize - 1);
+        m_output[m_outputSize++] = _byte;
+        m_produced++;
+
+        return m_outputSize == OutputSize ? flush() : Status::Ok;
+    }
+
+    Decoder::Status Decoder::flush()
+    {
+        if (m_outputSize == 0)
+            return Status::Ok;
+
+        const bool ok = m_sink(m_output, m_outputSize);
+        m_outputSize = 0;
+        return ok ? Status::Ok : Status::SinkFailed;
+    }
+
+} // namespace tr::lzss
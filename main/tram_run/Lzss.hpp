@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tram_run/Delegate.hpp"
+
+namespace tr::lzss
+{
+    // Streaming decoder for the images packed by tools/ota_pack.py.
+    //
+    // Stream: "TRZ1", uint32 LE size of the decoded data, then groups of one flag byte and 8 items.
+    // Flag bit set (LSB first): a literal byte. Clear: a big-endian uint16 reference,
+    // the high 11 bits are distance - 1 and the low 5 bits are length - MinMatch.
+    //
+    // RAM use is the fixed window plus the output buffer, whatever the image size.
+    constexpr uint8_t Magic[4] = {'T', 'R', 'Z', '1'};
+    constexpr unsigned WindowBits = 11;
+    constexpr unsigned WindowSize = 1u << WindowBits;
+    constexpr unsigned LengthBits = 5;
+    constexpr unsigned MinMatch = 3;
+    constexpr unsigned MaxMatch = MinMatch + (1u << LengthBits) - 1;
+
+    class Decoder final
+    {
+    public:
+        // Receives the decoded data in chunks of up to OutputSize bytes
+        using Sink = Delegate<bool(const uint8_t*, size_t)>;
+        static constexpr size_t OutputSize = 1024;
+
+        enum class Status : uint8_t
+        {
+            Ok,
+            BadHeader,
+            Overrun,        // More data than the header announced
+            BadReference,   // A reference before the start of the data
+            Truncated,      // Less data than the header announced, from finish()
+            SinkFailed,
+        };
+
+        // Starts a new stream
+        void reset(Sink _sink);
+
+        Status feed(const uint8_t* _data, size_t _size);
+        // Flushes the rest of the output at the end of the stream
+        Status finish();
+
+        bool isComplete() const { return m_headerDone && m_produced == m_expectedSize; }
+        uint32_t getExpectedSize() const { return m_expectedSize; }
+        uint32_t getProducedSize() const { return m_produced; }
+
+    private:
+        Status put(uint8_t _byte);
+        Status flush();
+
+        Sink m_sink;
+
+        uint8_t m_window[WindowSize];
+        uint16_t m_windowPos = 0;
+
+        uint8_t m_output[OutputSize];
+        size_t m_outputSize = 0;
+
+        uint8_t m_header[8];
+        uint8_t m_headerSize = 0;
+        bool m_headerDone = false;
+        uint32_t m_expectedSize = 0;
+        uint32_t m_produced = 0;
+
+        uint8_t m_flags = 0;
+        uint8_t m_flagsLeft = 0;
+        uint8_t m_referenceHigh = 0;
+        bool m_referencePending = false;
+    };
+
+} // namespace tr::lzss
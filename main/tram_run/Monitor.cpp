@@ -0,0 +1,231 @@
+#include "tram_run/Monitor.hpp"
+#include "tram_run/Deadline.hpp"
+#include "tram_run/HeapGuard.hpp"
+#include "tram_run/Rtos.hpp"
+
+#include "sdkconfig.h"
+
+#include "esp_log.h"
+#include "esp_task_wdt.h"
+#include "esp_timer.h"
+
+namespace
+{
+    static const char* TAG = "TR_MONITOR";
+
+    constexpr uint8_t TaskCount = static_cast<uint8_t>(tr::monitor::Task::Count);
+    constexpr uint8_t PathCount = static_cast<uint8_t>(tr::monitor::Path::Count);
+    static_assert(TaskCount + PathCount <= tr::deadline::MaxChannels);
+
+    constexpr const char* TaskNames[] = {"main", "input", "display", "servo", "fetcher"};
+    constexpr const char* PathNames[] = {"screen", "pointer"};
+    static_assert(sizeof(TaskNames) / sizeof(TaskNames[0]) == TaskCount);
+    static_assert(sizeof(PathNames) / sizeof(PathNames[0]) == PathCount);
+
+    // Indexed by eTaskState
+    constexpr const char* StateNames[] = {"running", "ready", "blocked", "suspended", "deleted", "invalid"};
+
+#if CONFIG_TR_MONITOR_WDT
+    constexpr uint32_t StarvingFactor = CONFIG_TR_MONITOR_WDT_FACTOR;
+#else
+    constexpr uint32_t StarvingFactor = UINT32_MAX;
+#endif
+
+    constexpr uint8_t toChannel(tr::monitor::Task _task)
+    {
+        return static_cast<uint8_t>(_task);
+    }
+
+    constexpr uint8_t toChannel(tr::monitor::Path _path)
+    {
+        return TaskCount + static_cast<uint8_t>(_path);
+    }
+
+    // What the tasks were doing when a budget was exceeded
+    struct Capture
+    {
+        struct TaskState
+        {
+            eTaskState state = eInvalid;
+            UBaseType_t queued = 0;
+            uint32_t busyUs = 0;
+        };
+
+        uint32_t atUs = 0;
+        uint32_t valueUs = 0;
+        uint8_t channel = 0;
+        TaskState tasks[TaskCount];
+    };
+
+    static tr::deadline::Tracker g_tracker;
+    static TaskHandle_t g_handles[TaskCount] = {};
+    static QueueHandle_t g_queues[TaskCount] = {};
+
+    // The first capture is kept until the monitor task logs it, the later ones are only counted
+    static portMUX_TYPE g_captureLock = portMUX_INITIALIZER_UNLOCKED;
+    static Capture g_capture;
+    static bool g_capturePending = false;
+    static uint32_t g_captures = 0;
+    static uint32_t g_capturesDropped = 0;
+
+    static tr::rtos::StaticTask<CONFIG_TR_MONITOR_TASK_STACK> g_taskStorage;
+    static TaskHandle_t g_task = nullptr;
+
+    void capture(uint8_t _channel, uint32_t _valueUs)
+    {
+        // Gathered outside of the lock, the task states cannot be read in a critical section
+        Capture capture;
+        capture.atUs = tr::monitor::now();
+        capture.valueUs = _valueUs;
+        capture.channel = _channel;
+        for (uint8_t i = 0; i < TaskCount; ++i)
+        {
+            if (g_handles[i] != nullptr)
+                capture.tasks[i].state = eTaskGetState(g_handles[i]);
+            if (g_queues[i] != nullptr)
+                capture.tasks[i].queued = uxQueueMessagesWaiting(g_queues[i]);
+            capture.tasks[i].busyUs = g_tracker.getBusyUs(i, capture.atUs);
+        }
+
+        taskENTER_CRITICAL(&g_captureLock);
+        g_captures++;
+        if (g_capturePending)
+            g_capturesDropped++;
+        else
+        {
+            g_capture = capture;
+            g_capturePending = true;
+        }
+        taskEXIT_CRITICAL(&g_captureLock);
+    }
+
+    void logPendingCapture()
+    {
+        taskENTER_CRITICAL(&g_captureLock);
+        const bool pending = g_capturePending;
+        const Capture capture = g_capture;
+        g_capturePending = false;
+        taskEXIT_CRITICAL(&g_captureLock);
+
+        if (!pending)
+            return;
+
+        ESP_LOGW(TAG, "%s over budget: %lu us (budget %lu us) at %lu us", g_tracker.getName(capture.channel),
+            capture.valueUs, g_tracker.getBudgetUs(capture.channel), capture.atUs);
+        for (uint8_t i = 0; i < TaskCount; ++i)
+        {
+            const Capture::TaskState& task = capture.tasks[i];
+            ESP_LOGW(TAG, "  %-8s %-9s busy %lu us, %u queued", TaskNames[i],
+                StateNames[task.state <= eInvalid ? task.state : eInvalid], task.busyUs, (unsigned)task.queued);
+        }
+    }
+
+    void task(void* _pvParameter)
+    {
+#if CONFIG_TR_MONITOR_WDT
+        esp_task_wdt_user_handle_t wdt = nullptr;
+        ESP_ERROR_CHECK(esp_task_wdt_add_user("tr_monitor", &wdt));
+#endif
+        tr::heap_guard::armCurrentTask();
+
+        while (true)
+        {
+            const tr::deadline::Poll poll = g_tracker.poll(tr::monitor::now(), StarvingFactor);
+            for (uint8_t i = 0; i < tr::deadline::MaxChannels; ++i)
+            {
+                // Caught while still stuck, the end of the span records it again in the histogram
+                if (poll.newlyStalled & (1u << i))
+                    capture(i, g_tracker.getBusyUs(i, tr::monitor::now()));
+            }
+            logPendingCapture();
+
+#if CONFIG_TR_MONITOR_WDT
+            // The watchdog only knows the monitor as its user, the capture logged above names the task
+            if (poll.starving == 0)
+                esp_task_wdt_reset_user(wdt);
+            else
+                ESP_LOGE(TAG, "Task stuck, starving the task watchdog (0x%lx)", poll.starving);
+#endif
+            vTaskDelay(pdMS_TO_TICKS(CONFIG_TR_MONITOR_PERIOD_MS));
+        }
+    }
+
+} // namespace
+
+namespace tr::monitor
+{
+    void init()
+    {
+        ESP_LOGI(TAG, "Init");
+
+        // Above every monitored task, so a busy one cannot hide the others
+        g_task = g_taskStorage.create(task, "MonitorTask", NULL, 10);
+    }
+
+    void addTask(Task _task, TaskHandle_t _handle, QueueHandle_t _queue, uint32_t _budgetMs)
+    {
+        const uint8_t index = static_cast<uint8_t>(_task);
+        g_handles[index] = _handle;
+        g_queues[index] = _queue;
+        g_tracker.configure(toChannel(_task), TaskNames[index], _budgetMs * 1000);
+    }
+
+    void addPath(Path _path, uint32_t _budgetMs)
+    {
+        g_tracker.configure(toChannel(_path), PathNames[static_cast<uint8_t>(_path)], _budgetMs * 1000);
+    }
+
+    void begin(Task _task)
+    {
+        g_tracker.begin(toChannel(_task), now());
+    }
+
+    void end(Task _task)
+    {
+        const uint8_t channel = toChannel(_task);
+        const uint32_t nowUs = now();
+        const uint32_t busyUs = g_tracker.getBusyUs(channel, nowUs);
+        if (g_tracker.end(channel, nowUs))
+            capture(channel, busyUs);
+    }
+
+    uint32_t now()
+    {
+        const uint32_t us = static_cast<uint32_t>(esp_timer_get_time());
+        return us != 0 ? us : 1;
+    }
+
+    void record(Path _path, uint32_t _originUs)
+    {
+        if (_originUs == 0)
+            return;
+
+        const uint8_t channel = toChannel(_path);
+        const uint32_t latencyUs = now() - _originUs;
+        if (g_tracker.record(channel, latencyUs))
+            capture(channel, latencyUs);
+    }
+
+    void report()
+    {
+        for (uint8_t i = 0; i < deadline::MaxChannels; ++i)
+        {
+            if (!g_tracker.isEnabled(i))
+                continue;
+
+            // Buckets: up to 1/4, 1/2 and 1 budget, then the misses up to 2, 4, 8, 16 budgets and longer
+            const deadline::Stats stats = g_tracker.getStats(i);
+            ESP_LOGI(TAG, "%-8s budget %lu us, max %lu us, %lu of %lu missed: %lu %lu %lu | %lu %lu %lu %lu %lu",
+                g_tracker.getName(i), g_tracker.getBudgetUs(i), stats.maxUs, stats.misses, stats.count,
+                stats.buckets[0], stats.buckets[1], stats.buckets[2], stats.buckets[3],
+                stats.buckets[4], stats.buckets[5], stats.buckets[6], stats.buckets[7]);
+        }
+
+        taskENTER_CRITICAL(&g_captureLock);
+        const uint32_t captures = g_captures;
+        const uint32_t dropped = g_capturesDropped;
+        taskEXIT_CRITICAL(&g_captureLock);
+        ESP_LOGI(TAG, "Captures %lu (%lu not logged)", captures, dropped);
+    }
+
+} // namespace tr::monitor
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+
+#include <stdint.h>
+
+namespace tr::monitor
+{
+    // Deadline monitor: the TramRun tasks report their busy spans and the end-to-end latencies,
+    // see Deadline.hpp. A span or a latency over its budget captures the queue depths and the task
+    // states on the spot, the monitor task logs the capture. A task busy for more than
+    // CONFIG_TR_MONITOR_WDT_FACTOR times its budget stops the monitor feeding the task watchdog,
+    // which then reports and resets as for any hung task.
+    enum class Task : uint8_t
+    {
+        Main,
+        Input,
+        Display,
+        Servo,
+        Fetcher,
+        Count,
+    };
+
+    // From the departures arriving in the fetcher task to the digits drawn and the servo commanded
+    enum class Path : uint8_t
+    {
+        Screen,
+        Pointer,
+        Count,
+    };
+
+    void init();
+    // From the module init, right after creating the task. _queue is nullptr without an input queue.
+    void addTask(Task _task, TaskHandle_t _handle, QueueHandle_t _queue, uint32_t _budgetMs);
+    void addPath(Path _path, uint32_t _budgetMs);
+
+    // From the task itself, around each unit of work
+    void begin(Task _task);
+    void end(Task _task);
+
+    // Microseconds since boot, the origin of the paths. Never 0, which marks an untimed event.
+    uint32_t now();
+    void record(Path _path, uint32_t _originUs);
+
+    // Logs the histograms of every task and path
+    void report();
+
+} // namespace tr::monitor
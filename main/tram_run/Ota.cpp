@@ -0,0 +1,176 @@
+#include "tram_run/Ota.hpp"
+#include "tram_run/Lzss.hpp"
+#include "tram_run/Rtos.hpp"
+
+#include "sdkconfig.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_crt_bundle.h"
+#include "esp_heap_caps.h"
+#include "esp_http_client.h"
+#include "esp_log.h"
+#include "esp_ota_ops.h"
+#include "esp_timer.h"
+
+namespace
+{
+    static const char* TAG = "TR_OTA";
+
+    constexpr size_t ChunkSize = 1024;
+
+    // TLS needs the bigger stack
+    static tr::rtos::StaticTask<CONFIG_TR_OTA_TASK_STACK> g_taskStorage;
+    static TaskHandle_t g_task = nullptr;
+    static tr::ota::OnDoneCallback g_callback{};
+
+    // All the buffers are static, so the RAM use doesn't depend on the image size
+    static tr::lzss::Decoder g_decoder;
+    static uint8_t g_chunk[ChunkSize];
+
+    struct Stats
+    {
+        int64_t startUs = 0;
+        uint32_t received = 0;
+        size_t freeAtStart = 0;
+        size_t minFree = 0;
+    };
+
+    void sampleHeap(Stats& _stats)
+    {
+        const size_t free = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+        if (free < _stats.minFree)
+            _stats.minFree = free;
+    }
+
+    bool download(esp_http_client_handle_t _client, esp_ota_handle_t _ota, Stats& _stats)
+    {
+        g_decoder.reset(
+            [&_ota](const uint8_t* _data, size_t _size) {
+                return esp_ota_write(_ota, _data, _size) == ESP_OK;
+            }
+        );
+
+        while (true)
+        {
+            const int read = esp_http_client_read(_client, reinterpret_cast<char*>(g_chunk), sizeof(g_chunk));
+            if (read < 0)
+            {
+                ESP_LOGE(TAG, "Read failed");
+                return false;
+            }
+            if (read == 0)
+                break;
+
+            _stats.received += read;
+            sampleHeap(_stats);
+
+            const tr::lzss::Decoder::Status status = g_decoder.feed(g_chunk, read);
+            if (status != tr::lzss::Decoder::Status::Ok)
+            {
+                ESP_LOGE(TAG, "Decoding failed: %d", (int)status);
+                return false;
+            }
+        }
+
+        if (g_decoder.finish() != tr::lzss::Decoder::Status::Ok)
+        {
+            ESP_LOGE(TAG, "Incomplete image: %lu of %lu bytes", g_decoder.getProducedSize(), g_decoder.getExpectedSize());
+            return false;
+        }
+        return esp_http_client_is_complete_data_received(_client);
+    }
+
+    bool update()
+    {
+        const esp_partition_t* partition = esp_ota_get_next_update_partition(NULL);
+        if (partition == nullptr)
+        {
+            ESP_LOGE(TAG, "No OTA partition");
+            return false;
+        }
+        ESP_LOGI(TAG, "Updating %s from %s", partition->label, CONFIG_TR_OTA_URL);
+
+        Stats stats;
+        stats.startUs = esp_timer_get_time();
+        stats.freeAtStart = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+        stats.minFree = stats.freeAtStart;
+
+        esp_http_client_config_t config = {};
+        config.url = CONFIG_TR_OTA_URL;
+        config.timeout_ms = 10000;
+        config.buffer_size = ChunkSize;
+#if CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
+        config.crt_bundle_attach = esp_crt_bundle_attach;
+#endif
+
+        esp_http_client_handle_t client = esp_http_client_init(&config);
+        if (client == nullptr)
+            return false;
+
+        bool ok = esp_http_client_open(client, 0) == ESP_OK
+            && esp_http_client_fetch_headers(client) >= 0
+            && esp_http_client_get_status_code(client) == 200;
+        if (!ok)
+            ESP_LOGE(TAG, "Request failed, status %d", esp_http_client_get_status_code(client));
+
+        esp_ota_handle_t ota = 0;
+        if (ok)
+            ok = esp_ota_begin(partition, OTA_WITH_SEQUENTIAL_WRITES, &ota) == ESP_OK;
+
+        if (ok)
+        {
+            ok = download(client, ota, stats);
+            sampleHeap(stats);
+
+            // Checks the image header, the segments and the appended digest
+            if (ok)
+                ok = esp_ota_end(ota) == ESP_OK;
+            else
+                esp_ota_abort(ota);
+        }
+
+        esp_http_client_close(client);
+        esp_http_client_cleanup(client);
+
+        if (ok)
+            ok = esp_ota_set_boot_partition(partition) == ESP_OK;
+
+        const int64_t durationMs = (esp_timer_get_time() - stats.startUs) / 1000;
+        const uint32_t written = g_decoder.getProducedSize();
+        ESP_LOGI(TAG, "%s: %lu bytes received, %lu bytes written in %lld ms, %lu KB/s, peak heap %u bytes",
+            ok ? "Done" : "Failed",
+            stats.received,
+            written,
+            durationMs,
+            durationMs > 0 ? static_cast<uint32_t>(written / durationMs) : 0,
+            (unsigned)(stats.freeAtStart - stats.minFree));
+
+        return ok;
+    }
+
+    void task(void* _pvParameter)
+    {
+        while (true)
+        {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            const bool ok = update();
+            g_callback(ok ? tr::ota::Result::Done : tr::ota::Result::Failed);
+        }
+    }
+
+} // namespace
+
+namespace tr::ota
+{
+    void start(OnDoneCallback _callback)
+    {
+        g_callback = _callback;
+
+        if (g_task == nullptr)
+            g_task = g_taskStorage.create(task, "OtaTask", NULL, 5);
+        xTaskNotifyGive(g_task);
+    }
+
+} // namespace tr::ota
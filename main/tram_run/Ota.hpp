@@ -0,0 +1,18 @@
+#pragma once
+
+#include "tram_run/Delegate.hpp"
+
+namespace tr::ota
+{
+    enum class Result
+    {
+        Done,   // The new image is validated and set as the boot partition
+        Failed
+    };
+    using OnDoneCallback = Delegate<void(Result)>;
+
+    // Streams the packed image from CONFIG_TR_OTA_URL into the inactive OTA partition.
+    // Runs in its own task, the callback is called from it.
+    void start(OnDoneCallback _callback);
+
+} // namespace tr::ota
@@ -0,0 +1,172 @@
+#include "tram_run/Persist.hpp"
+#include "tram_run/Rtos.hpp"
+
+#include "sdkconfig.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_timer.h"
+#include "nvs.h"
+
+namespace
+{
+    static const char* TAG = "TR_PERSIST";
+
+    constexpr const char* Namespace = "tram_run";
+    constexpr const char* Names[] = {"state", "departures", "servo_cal", "wifi_hints", "fanout_epoch"};
+    static_assert(sizeof(Names) / sizeof(Names[0]) == static_cast<size_t>(tr::persist::Key::Count));
+    static_assert(static_cast<size_t>(tr::persist::Key::Count) <= tr::store::MaxKeys);
+
+    constexpr uint32_t CheckPeriodMs = 5000;
+    constexpr uint32_t ForcedFlushTimeoutMs = 2000;
+    constexpr uint32_t ForceBit = 1;
+    constexpr uint32_t NvsPageSize = 4096;
+    constexpr uint32_t NvsEndurance = 100000;   // Erase cycles of the flash sectors
+
+    static nvs_handle_t g_nvs = 0;
+
+    bool readNvs(const char* _key, void* _data, size_t& _size)
+    {
+        return nvs_get_blob(g_nvs, _key, _data, &_size) == ESP_OK;
+    }
+
+    bool writeNvs(const char* _key, const void* _data, size_t _size)
+    {
+        const esp_err_t err = nvs_set_blob(g_nvs, _key, _data, _size);
+        if (err != ESP_OK)
+            ESP_LOGE(TAG, "Unable to write %s: %s", _key, esp_err_to_name(err));
+        return err == ESP_OK;
+    }
+
+    bool commitNvs()
+    {
+        return nvs_commit(g_nvs) == ESP_OK;
+    }
+
+    tr::store::Policy makePolicy()
+    {
+        tr::store::Policy policy;
+        policy.minIntervalMs = CONFIG_TR_PERSIST_MIN_INTERVAL_S * 1000;
+        policy.maxBytesPerHour = CONFIG_TR_PERSIST_MAX_BYTES_PER_HOUR;
+        return policy;
+    }
+
+    static tr::store::Store g_store{Names, static_cast<uint8_t>(tr::persist::Key::Count),
+        {readNvs, writeNvs, commitNvs}, makePolicy()};
+    static tr::store::Batch g_batch;
+
+    // Held for the shadow copies only, never across the flash writes
+    static StaticSemaphore_t g_mutexStorage;
+    static SemaphoreHandle_t g_mutex = nullptr;
+    static StaticSemaphore_t g_flushedStorage;
+    static SemaphoreHandle_t g_flushed = nullptr;
+
+    static tr::rtos::StaticTask<CONFIG_TR_PERSIST_TASK_STACK> g_taskStorage;
+    static TaskHandle_t g_task = nullptr;
+
+    uint32_t getNowMs()
+    {
+        return esp_timer_get_time() / 1000;
+    }
+
+    struct StoreLock
+    {
+        void lock() { xSemaphoreTake(g_mutex, portMAX_DELAY); }
+        void unlock() { xSemaphoreGive(g_mutex); }
+    };
+
+    void flushNow(bool _force)
+    {
+        StoreLock lock;
+        const auto getNowUs = []() { return static_cast<uint32_t>(esp_timer_get_time()); };
+        if (!tr::store::flush(g_store, g_batch, getNowMs(), _force, lock, getNowUs))
+            return;
+
+        // Only this task completes the flushes, the stats need no lock here
+        ESP_LOGD(TAG, "Flushed %u values in %lu us", g_batch.count, g_store.getStats().lastFlushUs);
+    }
+
+    void task(void* _pvParameter)
+    {
+        while (true)
+        {
+            uint32_t bits = 0;
+            xTaskNotifyWait(0, ForceBit, &bits, pdMS_TO_TICKS(CheckPeriodMs));
+
+            const bool force = bits & ForceBit;
+            flushNow(force);
+            if (force)
+                xSemaphoreGive(g_flushed);
+        }
+    }
+
+} // namespace
+
+namespace tr::persist
+{
+    void init()
+    {
+        ESP_LOGI(TAG, "Init");
+
+        ESP_ERROR_CHECK(nvs_open(Namespace, NVS_READWRITE, &g_nvs));
+        g_store.load();
+
+        g_mutex = xSemaphoreCreateMutexStatic(&g_mutexStorage);
+        g_flushed = xSemaphoreCreateBinaryStatic(&g_flushedStorage);
+        g_task = g_taskStorage.create(task, "PersistTask", NULL, 3);
+    }
+
+    bool getRaw(Key _key, void* _data, size_t _size)
+    {
+        xSemaphoreTake(g_mutex, portMAX_DELAY);
+        const bool found = g_store.get(static_cast<uint8_t>(_key), _data, _size);
+        xSemaphoreGive(g_mutex);
+        return found;
+    }
+
+    void setRaw(Key _key, const void* _data, size_t _size)
+    {
+        xSemaphoreTake(g_mutex, portMAX_DELAY);
+        g_store.set(static_cast<uint8_t>(_key), _data, _size);
+        xSemaphoreGive(g_mutex);
+    }
+
+    bool flush()
+    {
+        // The flash writes run on the persist task, with its stack, the caller only waits.
+        // A give left over from an earlier flush that timed out must not end this wait early.
+        xSemaphoreTake(g_flushed, 0);
+        xTaskNotify(g_task, ForceBit, eSetBits);
+        if (xSemaphoreTake(g_flushed, pdMS_TO_TICKS(ForcedFlushTimeoutMs)) != pdTRUE)
+        {
+            ESP_LOGW(TAG, "Forced flush timed out");
+            return false;
+        }
+
+        xSemaphoreTake(g_mutex, portMAX_DELAY);
+        const bool written = !g_store.isDirty();
+        xSemaphoreGive(g_mutex);
+        return written;
+    }
+
+    void report()
+    {
+        const esp_partition_t* partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_NVS, NULL);
+        const uint32_t pages = partition != nullptr ? partition->size / NvsPageSize : 1;
+
+        xSemaphoreTake(g_mutex, portMAX_DELAY);
+        const store::Stats stats = g_store.getStats();
+        const uint32_t eraseCycles = g_store.getEstimatedEraseCycles(pages);
+        xSemaphoreGive(g_mutex);
+
+        ESP_LOGI(TAG, "Sets %lu (%lu unchanged), flushes %lu (%lu forced, %lu deferred, %lu failed), %lu values written",
+            stats.sets, stats.unchanged, stats.flushes, stats.forcedFlushes, stats.deferred, stats.failures, stats.writes);
+        ESP_LOGI(TAG, "Flush latency %lu us last, %lu us max; %lu NVS entries, ~%lu erase cycles per page (%lu%% of the endurance)",
+            stats.lastFlushUs, stats.maxFlushUs, stats.nvsEntries, eraseCycles, eraseCycles * 100 / NvsEndurance);
+    }
+
+} // namespace tr::persist
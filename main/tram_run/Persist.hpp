@@ -0,0 +1,47 @@
+#pragma once
+
+#include "tram_run/Store.hpp"
+
+#include <type_traits>
+
+namespace tr::persist
+{
+    // Values kept in NVS across the reboots, written in the background by a store::Store
+    enum class Key : uint8_t
+    {
+        State,
+        Departures,
+        ServoCalibration,
+        WifiHints,
+        FanOutEpoch,
+        Count,
+    };
+
+    // Loads the values, needs nvs_flash_init() first
+    void init();
+
+    bool getRaw(Key _key, void* _data, size_t _size);
+    void setRaw(Key _key, const void* _data, size_t _size);
+
+    template <typename T>
+    bool get(Key _key, T& _value)
+    {
+        static_assert(std::is_trivially_copyable_v<T> && sizeof(T) <= store::MaxValueSize, "Not a persistent value");
+        return getRaw(_key, &_value, sizeof(T));
+    }
+
+    template <typename T>
+    void set(Key _key, const T& _value)
+    {
+        static_assert(std::is_trivially_copyable_v<T> && sizeof(T) <= store::MaxValueSize, "Not a persistent value");
+        setRaw(_key, &_value, sizeof(T));
+    }
+
+    // Writes every pending value now, before the deep sleep or the OTA update.
+    // False when the write failed or timed out, the values stay pending then.
+    bool flush();
+
+    // Logs the write counts, the flush latency and the estimated flash wear
+    void report();
+
+} // namespace tr::persist
@@ -0,0 +1,196 @@
+#include "tram_run/Power.hpp"
+
+#include "sdkconfig.h"
+
+#include "freertos/FreeRTOS.h"
+
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_pm.h"
+#include "esp_sleep.h"
+#include "esp_system.h"
+#include "esp_sntp.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+
+#include <atomic>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+namespace
+{
+    static const char* TAG = "TR_POWER";
+
+    constexpr uint32_t RetainedMagic = 0x54525057; // "TRPW"
+    constexpr int MinCpuFreqMhz = 40;
+    constexpr int MinValidYear = 2024;
+    constexpr int64_t UsPerMinute = 60ll * 1000 * 1000;
+
+    struct RtcData
+    {
+        uint32_t magic;
+        tr::power::Retained retained;
+        uint64_t awakeUs;
+        uint64_t modemSleepUs;      // Estimated, part of awakeUs
+        uint64_t deepSleepUs;
+        uint32_t deepSleepCount;
+        uint32_t lastSleepSeconds;
+    };
+
+    RTC_DATA_ATTR static RtcData g_rtc;
+
+    static bool g_warmBoot = false;
+    static int64_t g_lastActivityUs = 0;
+    static std::atomic<int> g_busyCount{0};
+    static portMUX_TYPE g_modemSleepLock = portMUX_INITIALIZER_UNLOCKED;
+    static tr::power::ModemSleepMeter g_modemSleep;
+
+    uint64_t getModemSleepUs(int64_t _nowUs)
+    {
+        taskENTER_CRITICAL(&g_modemSleepLock);
+        const uint64_t sleepUs = g_modemSleep.getSleepUs(_nowUs);
+        taskEXIT_CRITICAL(&g_modemSleepLock);
+        return sleepUs;
+    }
+
+    const tr::power::PolicyConfig g_policyConfig = {
+        .noServiceStartMinute = CONFIG_TR_NO_SERVICE_START_MINUTE,
+        .noServiceEndMinute = CONFIG_TR_NO_SERVICE_END_MINUTE,
+    };
+} // namespace
+
+namespace tr::power
+{
+    void init()
+    {
+        if (g_rtc.magic == RetainedMagic && esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_TIMER)
+        {
+            g_warmBoot = true;
+            g_rtc.deepSleepUs += g_rtc.lastSleepSeconds * 1000000ull;
+        }
+        else
+        {
+            g_rtc = RtcData{};
+            g_rtc.magic = RetainedMagic;
+        }
+        g_rtc.lastSleepSeconds = 0;
+
+        setenv("TZ", CONFIG_TR_TIMEZONE, 1);
+        tzset();
+
+#if CONFIG_PM_ENABLE
+        esp_pm_config_t config = {};
+        config.max_freq_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ;
+        config.min_freq_mhz = MinCpuFreqMhz;
+#if CONFIG_FREERTOS_USE_TICKLESS_IDLE
+        // Automatic light sleep whenever all the tasks are blocked
+        config.light_sleep_enable = true;
+#endif
+        ESP_ERROR_CHECK(esp_pm_configure(&config));
+#else
+        ESP_LOGW(TAG, "Power management is disabled in the sdkconfig");
+#endif
+
+        ESP_LOGI(TAG, "Init, %s boot", g_warmBoot ? "warm" : "cold");
+    }
+
+    bool isWarmBoot()
+    {
+        return g_warmBoot;
+    }
+
+    bool isPowerOnReset()
+    {
+        return esp_reset_reason() == ESP_RST_POWERON;
+    }
+
+    Retained& getRetained()
+    {
+        return g_rtc.retained;
+    }
+
+    bool isTimeValid(const struct tm& _local)
+    {
+        return _local.tm_year + 1900 >= MinValidYear;
+    }
+
+    void onNetworkReady()
+    {
+        if (!esp_sntp_enabled())
+        {
+            esp_sntp_setoperatingmode(ESP_SNTP_OPMODE_POLL);
+            esp_sntp_setservername(0, CONFIG_TR_SNTP_SERVER);
+            esp_sntp_init();
+        }
+
+        ESP_ERROR_CHECK(esp_wifi_set_ps(WIFI_PS_MAX_MODEM));
+
+        taskENTER_CRITICAL(&g_modemSleepLock);
+        g_modemSleep.start(esp_timer_get_time());
+        taskEXIT_CRITICAL(&g_modemSleepLock);
+    }
+
+    void notifyActivity()
+    {
+        g_lastActivityUs = esp_timer_get_time();
+    }
+
+    void setBusy(bool _busy)
+    {
+        taskENTER_CRITICAL(&g_modemSleepLock);
+        const int count = g_busyCount += _busy ? 1 : -1;
+        // The modem stays awake from the first busy window opened to the last one closed
+        if (count == (_busy ? 1 : 0))
+            g_modemSleep.setBusy(_busy, esp_timer_get_time());
+        taskEXIT_CRITICAL(&g_modemSleepLock);
+    }
+
+    Decision evaluate()
+    {
+        PolicyInput input;
+
+        const time_t now = time(nullptr);
+        struct tm local;
+        localtime_r(&now, &local);
+
+        input.timeValid = isTimeValid(local);
+        input.minuteOfDay = local.tm_hour * 60 + local.tm_min;
+        input.second = local.tm_sec;
+        input.minutesSinceActivity = (esp_timer_get_time() - g_lastActivityUs) / UsPerMinute;
+        input.busy = g_busyCount > 0;
+
+        return decide(g_policyConfig, input);
+    }
+
+    void enterDeepSleep(uint32_t _seconds)
+    {
+        ESP_LOGI(TAG, "Deep sleep for %lu s", _seconds);
+
+        const int64_t now = esp_timer_get_time();
+        g_rtc.awakeUs += now;
+        g_rtc.modemSleepUs += getModemSleepUs(now);
+        g_rtc.deepSleepCount++;
+        g_rtc.lastSleepSeconds = _seconds;
+
+        esp_wifi_stop();
+        esp_deep_sleep(_seconds * 1000000ull);
+    }
+
+    void report()
+    {
+        const int64_t now = esp_timer_get_time();
+        const uint64_t awakeS = (g_rtc.awakeUs + now) / 1000000;
+        const uint64_t modemSleepS = (g_rtc.modemSleepUs + getModemSleepUs(now)) / 1000000;
+        const uint64_t deepSleepS = g_rtc.deepSleepUs / 1000000;
+
+        ESP_LOGI(TAG, "Awake %llu s (~%llu s of it in modem sleep), deep sleep %llu s in %lu nights",
+            awakeS, modemSleepS, deepSleepS, g_rtc.deepSleepCount);
+
+#if CONFIG_PM_PROFILING
+        // Splits the awake time into the CPU frequency modes and light sleep
+        esp_pm_dump_locks(stdout);
+#endif
+    }
+
+} // namespace tr::power
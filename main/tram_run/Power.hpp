@@ -0,0 +1,41 @@
+#pragma once
+
+#include "tram_run/Departures.hpp"
+#include "tram_run/PowerPolicy.hpp"
+#include "tram_run/State.hpp"
+
+#include <time.h>
+
+namespace tr::power
+{
+    // Kept in RTC memory, so it survives deep sleep and the wake-up can skip the full re-init
+    struct Retained
+    {
+        state::Id state = state::Id::Init;
+        // The board shown when going to sleep, restored without reading the flash
+        departures::Board board;
+    };
+
+    void init();
+
+    // True when the device woke up from its own deep sleep and the retained data is valid
+    bool isWarmBoot();
+    // True after the power was applied, someone is likely at the unit
+    bool isPowerOnReset();
+    Retained& getRetained();
+
+    // True once the clock was synchronized, before that the local time is meaningless
+    bool isTimeValid(const struct tm& _local);
+
+    // Starts the clock synchronization and lets the modem sleep between the beacons
+    void onNetworkReady();
+    void notifyActivity();
+    void setBusy(bool _busy);
+
+    Decision evaluate();
+    [[noreturn]] void enterDeepSleep(uint32_t _seconds);
+
+    // Logs the estimated time spent in every power state since the first cold boot
+    void report();
+
+} // namespace tr::power
@@ -0,0 +1,78 @@
+#include "tram_run/PowerPolicy.hpp"
+
+namespace
+{
+    constexpr uint16_t MinutesPerDay = 24 * 60;
+} // namespace
+
+namespace tr::power
+{
+    bool isInWindow(uint16_t _start, uint16_t _end, uint16_t _minute)
+    {
+        if (_start == _end)
+            return false;
+        if (_start < _end)
+            return _minute >= _start && _minute < _end;
+        // The window crosses midnight
+        return _minute >= _start || _minute < _end;
+    }
+
+    uint16_t minutesUntil(uint16_t _from, uint16_t _to)
+    {
+        return (_to + MinutesPerDay - _from) % MinutesPerDay;
+    }
+
+    Decision decide(const PolicyConfig& _config, const PolicyInput& _input)
+    {
+        Decision decision;
+
+        if (!_input.timeValid || _input.busy)
+            return decision;
+        if (_input.minutesSinceActivity < _config.activityHoldMinutes)
+            return decision;
+        if (!isInWindow(_config.noServiceStartMinute, _config.noServiceEndMinute, _input.minuteOfDay))
+            return decision;
+
+        const uint16_t minutesLeft = minutesUntil(_input.minuteOfDay, _config.noServiceEndMinute);
+        if (minutesLeft < _config.minDeepSleepMinutes)
+            return decision;
+
+        decision.mode = Mode::DeepSleep;
+        decision.sleepSeconds = minutesLeft * 60u - _input.second;
+        return decision;
+    }
+
+    void ModemSleepMeter::start(int64_t _nowUs)
+    {
+        if (m_started)
+            return;
+
+        m_started = true;
+        m_startUs = _nowUs;
+        // A window already open only counts from now on
+        m_busySinceUs = _nowUs;
+    }
+
+    void ModemSleepMeter::setBusy(bool _busy, int64_t _nowUs)
+    {
+        if (_busy == m_busy)
+            return;
+
+        m_busy = _busy;
+        if (_busy)
+            m_busySinceUs = _nowUs;
+        else if (m_started)
+            m_busyUs += _nowUs - m_busySinceUs;
+    }
+
+    uint64_t ModemSleepMeter::getSleepUs(int64_t _nowUs) const
+    {
+        if (!m_started)
+            return 0;
+
+        const int64_t busyUs = m_busyUs + (m_busy ? _nowUs - m_busySinceUs : 0);
+        const int64_t sleepUs = _nowUs - m_startUs - busyUs;
+        return sleepUs > 0 ? sleepUs : 0;
+    }
+
+} // namespace tr::power
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace tr::power
+{
+    // The sleep decision, kept free of ESP-IDF so it can be reasoned about (and run) anywhere.
+    // Light sleep and modem sleep are automatic while awake, the policy only decides when
+    // the device is allowed to go down completely.
+
+    enum class Mode : uint8_t
+    {
+        Awake,
+        DeepSleep,
+    };
+
+    struct PolicyConfig
+    {
+        uint16_t noServiceStartMinute = 0;  // Minute of the day, local time
+        uint16_t noServiceEndMinute = 0;    // Equal to the start disables deep sleep
+        uint16_t minDeepSleepMinutes = 10;  // Shorter windows are not worth a cold boot
+        uint16_t activityHoldMinutes = 5;   // A button press keeps the device awake that long
+    };
+
+    struct PolicyInput
+    {
+        bool timeValid = false;             // False until the clock has been synchronized once
+        uint16_t minuteOfDay = 0;
+        uint8_t second = 0;
+        uint32_t minutesSinceActivity = UINT32_MAX;
+        bool busy = false;                  // An update or a flash write must not be interrupted
+    };
+
+    struct Decision
+    {
+        Mode mode = Mode::Awake;
+        uint32_t sleepSeconds = 0;
+    };
+
+    bool isInWindow(uint16_t _start, uint16_t _end, uint16_t _minute);
+    uint16_t minutesUntil(uint16_t _from, uint16_t _to);
+
+    Decision decide(const PolicyConfig& _config, const PolicyInput& _input);
+
+    // Estimated modem sleep time. The Wi-Fi driver does not report it: from start() on the modem
+    // sleeps between the beacons, except in the busy windows (fetches, update) that keep it awake.
+    class ModemSleepMeter final
+    {
+    public:
+        // The Wi-Fi power save was enabled, later calls are ignored
+        void start(int64_t _nowUs);
+        // The outermost busy window only opens and closes
+        void setBusy(bool _busy, int64_t _nowUs);
+        uint64_t getSleepUs(int64_t _nowUs) const;
+
+    private:
+        bool m_started = false;
+        bool m_busy = false;
+        int64_t m_startUs = 0;
+        int64_t m_busySinceUs = 0;
+        int64_t m_busyUs = 0;
+    };
+
+} // namespace tr::power
@@ -0,0 +1,211 @@
+#include "tram_run/Profiler.hpp"
+
+#include "sdkconfig.h"
+
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace
+{
+    [[maybe_unused]] static const char* TAG = "TR_PROFILER";
+
+#if CONFIG_TR_PROFILE
+    constexpr uint8_t MaxTasks = 12;
+    constexpr uint32_t MaxAllocations = 512;    // Live allocations of the tracked tasks, a power of two
+    constexpr uint8_t NoTask = 0xFF;
+
+    struct TaskStats
+    {
+        TaskHandle_t handle;
+        uint32_t stackSize;
+        size_t heapInUse;
+        size_t heapPeak;
+        size_t largestAllocation;
+        uint32_t allocations;
+    };
+
+    // Open addressing with linear probing, a null ptr is a free slot
+    struct Allocation
+    {
+        void* ptr;
+        uint32_t size;
+        uint8_t task;
+    };
+
+    static portMUX_TYPE g_lock = portMUX_INITIALIZER_UNLOCKED;
+    static TaskStats g_tasks[MaxTasks];
+    static uint8_t g_taskCount = 0;
+    static Allocation g_allocations[MaxAllocations];
+    static uint32_t g_untracked = 0;
+
+    IRAM_ATTR uint32_t getHome(void* _ptr)
+    {
+        return (reinterpret_cast<uintptr_t>(_ptr) >> 3) & (MaxAllocations - 1);
+    }
+
+    IRAM_ATTR uint8_t findCurrentTask()
+    {
+        const TaskHandle_t current = xTaskGetCurrentTaskHandle();
+        for (uint8_t i = 0; i < g_taskCount; ++i)
+        {
+            if (g_tasks[i].handle == current)
+                return i;
+        }
+        return NoTask;
+    }
+
+    IRAM_ATTR void insert(void* _ptr, uint32_t _size, uint8_t _task)
+    {
+        uint32_t slot = getHome(_ptr);
+        for (uint32_t probe = 0; probe < MaxAllocations; ++probe)
+        {
+            if (g_allocations[slot].ptr == nullptr)
+            {
+                g_allocations[slot] = {_ptr, _size, _task};
+                return;
+            }
+            slot = (slot + 1) & (MaxAllocations - 1);
+        }
+        g_untracked++;
+    }
+
+    IRAM_ATTR bool remove(void* _ptr, Allocation& _allocation)
+    {
+        uint32_t slot = getHome(_ptr);
+        for (uint32_t probe = 0; probe < MaxAllocations && g_allocations[slot].ptr != nullptr; ++probe)
+        {
+            if (g_allocations[slot].ptr != _ptr)
+            {
+                slot = (slot + 1) & (MaxAllocations - 1);
+                continue;
+            }
+            _allocation = g_allocations[slot];
+
+            // Backward shift, so the probe sequences of the following entries stay unbroken
+            uint32_t hole = slot;
+            uint32_t next = (slot + 1) & (MaxAllocations - 1);
+            while (g_allocations[next].ptr != nullptr)
+            {
+                const uint32_t home = getHome(g_allocations[next].ptr);
+                const uint32_t distanceNext = (next - home) & (MaxAllocations - 1);
+                const uint32_t distanceHole = (hole - home) & (MaxAllocations - 1);
+                if (distanceHole <= distanceNext)
+                {
+                    g_allocations[hole] = g_allocations[next];
+                    hole = next;
+                }
+                next = (next + 1) & (MaxAllocations - 1);
+            }
+            g_allocations[hole].ptr = nullptr;
+            return true;
+        }
+        return false;
+    }
+
+    // "FetcherTask" -> "FETCHER", "mainTask" -> "MAIN"
+    void getConfigName(const char* _taskName, char* _name, size_t _size)
+    {
+        size_t length = strlen(_taskName);
+        if (length > 4 && strcasecmp(_taskName + length - 4, "task") == 0)
+            length -= 4;
+
+        size_t i = 0;
+        for (; i < length && i + 1 < _size; ++i)
+            _name[i] = toupper(static_cast<unsigned char>(_taskName[i]));
+        _name[i] = '\0';
+    }
+#endif
+} // namespace
+
+namespace tr::profiler
+{
+    void trackTask([[maybe_unused]] TaskHandle_t _task, [[maybe_unused]] uint32_t _stackSize)
+    {
+#if CONFIG_TR_PROFILE
+        taskENTER_CRITICAL(&g_lock);
+        configASSERT(g_taskCount < MaxTasks);
+        g_tasks[g_taskCount++] = {_task, _stackSize, 0, 0, 0, 0};
+        taskEXIT_CRITICAL(&g_lock);
+#endif
+    }
+
+    IRAM_ATTR void onAlloc([[maybe_unused]] void* _ptr, [[maybe_unused]] size_t _size)
+    {
+#if CONFIG_TR_PROFILE
+        if (_ptr == nullptr)
+            return;
+
+        portENTER_CRITICAL_SAFE(&g_lock);
+        const uint8_t task = findCurrentTask();
+        if (task != NoTask)
+        {
+            TaskStats& stats = g_tasks[task];
+            stats.allocations++;
+            stats.heapInUse += _size;
+            if (stats.heapInUse > stats.heapPeak)
+                stats.heapPeak = stats.heapInUse;
+            if (_size > stats.largestAllocation)
+                stats.largestAllocation = _size;
+            insert(_ptr, _size, task);
+        }
+        portEXIT_CRITICAL_SAFE(&g_lock);
+#endif
+    }
+
+    IRAM_ATTR void onFree([[maybe_unused]] void* _ptr)
+    {
+#if CONFIG_TR_PROFILE
+        if (_ptr == nullptr)
+            return;
+
+        // Charged to the task that allocated it, whoever frees it
+        portENTER_CRITICAL_SAFE(&g_lock);
+        Allocation allocation;
+        if (remove(_ptr, allocation))
+            g_tasks[allocation.task].heapInUse -= allocation.size;
+        portEXIT_CRITICAL_SAFE(&g_lock);
+#endif
+    }
+
+    void report()
+    {
+#if CONFIG_TR_PROFILE
+        taskENTER_CRITICAL(&g_lock);
+        const uint8_t taskCount = g_taskCount;
+        TaskStats tasks[MaxTasks];
+        memcpy(tasks, g_tasks, sizeof(tasks));
+        const uint32_t untracked = g_untracked;
+        taskEXIT_CRITICAL(&g_lock);
+
+        ESP_LOGI(TAG, "%-12s %6s %6s %8s %8s %6s", "Task", "Stack", "Peak", "HeapPeak", "Largest", "Allocs");
+        for (uint8_t i = 0; i < taskCount; ++i)
+        {
+            const TaskStats& stats = tasks[i];
+            const uint32_t peak = stats.stackSize - uxTaskGetStackHighWaterMark(stats.handle);
+            ESP_LOGI(TAG, "%-12s %6lu %6lu %8u %8u %6lu", pcTaskGetName(stats.handle),
+                stats.stackSize, peak, stats.heapPeak, stats.largestAllocation, stats.allocations);
+        }
+        ESP_LOGI(TAG, "Heap: %u free, %u at the lowest, %u largest block, %lu allocations not tracked",
+            heap_caps_get_free_size(MALLOC_CAP_8BIT), heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT),
+            heap_caps_get_largest_free_block(MALLOC_CAP_8BIT), untracked);
+
+        // Plain stdout, so it can be pasted into sdkconfig.defaults as is
+        printf("# Recommended stack sizes, %d%% margin over the measured peak\n", CONFIG_TR_PROFILE_STACK_MARGIN);
+        for (uint8_t i = 0; i < taskCount; ++i)
+        {
+            const TaskStats& stats = tasks[i];
+            const uint32_t peak = stats.stackSize - uxTaskGetStackHighWaterMark(stats.handle);
+
+            char name[configMAX_TASK_NAME_LEN];
+            getConfigName(pcTaskGetName(stats.handle), name, sizeof(name));
+            printf("CONFIG_TR_%s_TASK_STACK=%lu\n", name, recommendStackSize(peak, CONFIG_TR_PROFILE_STACK_MARGIN));
+        }
+#endif
+    }
+
+} // namespace tr::profiler
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace tr::profiler
+{
+    // Profiling mode (CONFIG_TR_PROFILE): records the peak stack, the peak heap and the largest
+    // allocation of every TramRun task while the App runs its scripted scenario, then prints the
+    // recommended stack sizes. FreeRTOS already fills the new stacks with a known pattern for
+    // the high water mark, so the stacks need no extra painting.
+    // Without CONFIG_TR_PROFILE all of it compiles to nothing.
+
+    constexpr uint32_t StackGranularity = 256;
+
+    // Peak use plus the margin, rounded up so the recommendation does not change on every run
+    constexpr uint32_t recommendStackSize(uint32_t _peak, uint32_t _marginPercent)
+    {
+        const uint32_t withMargin = _peak + (_peak * _marginPercent + 99) / 100;
+        return (withMargin + StackGranularity - 1) / StackGranularity * StackGranularity;
+    }
+
+    // Called by rtos::StaticTask. The Kconfig symbol is derived from the task name,
+    // "FetcherTask" is CONFIG_TR_FETCHER_TASK_STACK.
+    void trackTask(TaskHandle_t _task, uint32_t _stackSize);
+
+    // Called from the heap hooks, see HeapGuard.cpp
+    void onAlloc(void* _ptr, size_t _size);
+    void onFree(void* _ptr);
+
+    void report();
+
+} // namespace tr::profiler
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+
+#include "tram_run/Profiler.hpp"
+
+namespace tr::rtos
+{
+    // Statically allocated FreeRTOS objects, so the long-lived tasks and queues
+    // never come from the heap. Declare them at namespace scope next to their owners.
+
+    template <uint32_t StackSize>
+    class StaticTask final
+    {
+    public:
+        TaskHandle_t create(TaskFunction_t _function, const char* _name, void* _parameter, UBaseType_t _priority)
+        {
+            TaskHandle_t handle = xTaskCreateStatic(_function, _name, StackSize, _parameter, _priority, m_stack, &m_tcb);
+            configASSERT(handle != nullptr);
+            profiler::trackTask(handle, StackSize);
+            return handle;
+        }
+
+    private:
+        StackType_t m_stack[StackSize];
+        StaticTask_t m_tcb;
+    };
+
+    template <typename T, UBaseType_t Length>
+    class StaticQueue final
+    {
+    public:
+        QueueHandle_t create()
+        {
+            QueueHandle_t handle = xQueueCreateStatic(Length, sizeof(T), m_storage, &m_queue);
+            configASSERT(handle != nullptr);
+            return handle;
+        }
+
+    private:
+        uint8_t m_storage[Length * sizeof(T)];
+        StaticQueue_t m_queue;
+    };
+
+} // namespace tr::rtos
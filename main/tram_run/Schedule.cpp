@@ -0,0 +1,67 @@
+#include "tram_run/Schedule.hpp"
+#include "tram_run/Power.hpp"
+#include "tram_run/Timetable.hpp"
+
+#include "sdkconfig.h"
+
+#include "esp_log.h"
+#include "esp_partition.h"
+
+namespace
+{
+    static const char* TAG = "TR_SCHEDULE";
+
+    constexpr const char* PartitionLabel = "timetable";
+    constexpr esp_partition_subtype_t PartitionSubtype = static_cast<esp_partition_subtype_t>(0x40);
+
+    // The image stays in flash, the reads go through the cache
+    static esp_partition_mmap_handle_t g_mapHandle;
+    static tr::timetable::Reader g_reader;
+    static tr::departures::Aggregator g_aggregator{CONFIG_TR_VISIBLE_DEPARTURES};
+} // namespace
+
+namespace tr::schedule
+{
+    void init()
+    {
+        const esp_partition_t* partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, PartitionSubtype, PartitionLabel);
+        if (partition == nullptr)
+        {
+            ESP_LOGW(TAG, "No timetable partition");
+            return;
+        }
+
+        const void* image = nullptr;
+        const esp_err_t err = esp_partition_mmap(partition, 0, partition->size, ESP_PARTITION_MMAP_DATA, &image, &g_mapHandle);
+        if (err != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Unable to map the timetable: %s", esp_err_to_name(err));
+            return;
+        }
+
+        if (!g_reader.open(static_cast<const uint8_t*>(image), partition->size))
+        {
+            // Erased or never flashed, see "idf.py flash"
+            ESP_LOGW(TAG, "No valid timetable");
+            esp_partition_munmap(g_mapHandle);
+            return;
+        }
+        ESP_LOGI(TAG, "Timetable with %u services", g_reader.getServiceCount());
+    }
+
+    bool getBoard(time_t _now, departures::Board& _board)
+    {
+        if (!g_reader.isOpen())
+            return false;
+
+        struct tm local;
+        localtime_r(&_now, &local);
+        if (!power::isTimeValid(local))
+            return false;
+
+        const uint16_t minute = local.tm_hour * 60 + local.tm_min;
+        const uint32_t midnight = _now - minute * 60 - local.tm_sec;
+        return g_reader.collectBoard(local.tm_wday, minute, midnight, _now, g_aggregator, _board);
+    }
+
+} // namespace tr::schedule
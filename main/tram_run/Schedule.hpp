@@ -0,0 +1,16 @@
+#pragma once
+
+#include "tram_run/Departures.hpp"
+
+#include <time.h>
+
+namespace tr::schedule
+{
+    // Maps the timetable partition, see tools/timetable_pack
+    void init();
+
+    // The scheduled board at the given time, false without a timetable or a synchronized clock.
+    // Only called from the App task.
+    bool getBoard(time_t _now, departures::Board& _board);
+
+} // namespace tr::schedule
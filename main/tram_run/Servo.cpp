@@ -1,4 +1,9 @@
 #include "tram_run/Servo.hpp"
+#include "tram_run/HeapGuard.hpp"
+#include "tram_run/Monitor.hpp"
+#include "tram_run/Rtos.hpp"
+
+#include "sdkconfig.h"
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -11,20 +16,15 @@ namespace
 {
     static const char* TAG = "TR_SERVO";
 
-    constexpr unsigned ServoMinPulsewidthUs = 500;  // Minimum pulse width in microsecond
-    constexpr unsigned ServoMaxPulsewidthUs = 2500; // Maximum pulse width in microsecond
-    constexpr int ServoMinDegree = -90;             // Minimum angle
-    constexpr int ServoMaxDegree = 90;              // Maximum angle
+    constexpr uint32_t MonitorBudgetMs = 50;
 
     constexpr unsigned ServoTimebaseResolutionHz = 1000000; // 1MHz, 1us per tick
     constexpr unsigned ServoTimebasePeriod = 20000;         // 20000 ticks, 20ms
 
     constexpr int GroupId = 1;
 
-    static inline uint32_t angleToCompare(int _angleDeg)
-    {
-        return (_angleDeg - ServoMinDegree) * (ServoMaxPulsewidthUs - ServoMinPulsewidthUs) / (ServoMaxDegree - ServoMinDegree) + ServoMinPulsewidthUs;
-    }
+    // Longer than a full swing of the needle
+    constexpr TickType_t SettleTime = pdMS_TO_TICKS(500);
 
     class Servo
     {
@@ -32,13 +32,20 @@ namespace
         Servo();
         ~Servo();
 
-        void rotate(int _angleDeg);
+        void setCompare(uint16_t _ticks);
+        // Stops the pulses once the needle has settled. The running timer holds a PM lock that
+        // keeps the chip out of light sleep, the unloaded needle stays put without the pulses.
+        void release();
+        bool isRunning() const { return m_running; }
 
     private:
+        void run();
+
         mcpwm_timer_handle_t m_timer = NULL;
         mcpwm_oper_handle_t m_operator = NULL;
         mcpwm_cmpr_handle_t m_comparator = NULL;
         mcpwm_gen_handle_t m_generator = NULL;
+        bool m_running = false;
     };
 
     Servo::Servo()
@@ -77,7 +84,7 @@ namespace
         ESP_ERROR_CHECK(mcpwm_new_generator(m_operator, &generator_config, &m_generator));
 
         // set the initial compare value, so that the servo will spin to the center position
-        ESP_ERROR_CHECK(mcpwm_comparator_set_compare_value(m_comparator, angleToCompare(0)));
+        ESP_ERROR_CHECK(mcpwm_comparator_set_compare_value(m_comparator, tr::servo::toCompareTicks(0)));
 
         ESP_LOGI(TAG, "Set generator action on timer and compare event");
         // go high on counter empty
@@ -90,9 +97,7 @@ namespace
             mcpwm_generator_set_action_on_compare_event(m_generator, MCPWM_GEN_COMPARE_EVENT_ACTION(MCPWM_TIMER_DIRECTION_UP, m_comparator, MCPWM_GEN_ACTION_LOW))
         );
 
-        ESP_LOGI(TAG, "Enable and start timer");
-        ESP_ERROR_CHECK(mcpwm_timer_enable(m_timer));
-        ESP_ERROR_CHECK(mcpwm_timer_start_stop(m_timer, MCPWM_TIMER_START_NO_STOP));
+        run();
     }
 
     Servo::~Servo()
@@ -100,31 +105,69 @@ namespace
         // TODO to think how to properly deinit everyting
     }
 
-    void Servo::rotate(int _angleDeg)
+    void Servo::setCompare(uint16_t _ticks)
     {
-        ESP_LOGI(TAG, "Angle of rotation: %d", _angleDeg);
-        if (_angleDeg < ServoMinDegree)
-            _angleDeg = ServoMinDegree;
-        else if (_angleDeg > ServoMaxDegree)
-            _angleDeg = ServoMaxDegree;
-        
-        ESP_ERROR_CHECK(mcpwm_comparator_set_compare_value(m_comparator, angleToCompare(_angleDeg)));
+        if (_ticks < tr::servo::MinCompareTicks)
+            _ticks = tr::servo::MinCompareTicks;
+        else if (_ticks > tr::servo::MaxCompareTicks)
+            _ticks = tr::servo::MaxCompareTicks;
+
+        ESP_ERROR_CHECK(mcpwm_comparator_set_compare_value(m_comparator, _ticks));
+        run();
+    }
+
+    void Servo::release()
+    {
+        if (!m_running)
+            return;
+
+        ESP_LOGI(TAG, "Stop timer");
+        // Hold the output low, a stopped timer would leave it wherever the period was
+        ESP_ERROR_CHECK(mcpwm_generator_set_force_level(m_generator, 0, true));
+        ESP_ERROR_CHECK(mcpwm_timer_start_stop(m_timer, MCPWM_TIMER_STOP_EMPTY));
+        ESP_ERROR_CHECK(mcpwm_timer_disable(m_timer));
+        m_running = false;
     }
 
+    void Servo::run()
+    {
+        if (m_running)
+            return;
+
+        ESP_LOGI(TAG, "Enable and start timer");
+        ESP_ERROR_CHECK(mcpwm_timer_enable(m_timer));
+        ESP_ERROR_CHECK(mcpwm_timer_start_stop(m_timer, MCPWM_TIMER_START_NO_STOP));
+        // The compare value is loaded on the first timer empty event, so the first pulse is already the new one
+        ESP_ERROR_CHECK(mcpwm_generator_set_force_level(m_generator, -1, true));
+        m_running = true;
+    }
+
+    static tr::rtos::StaticTask<CONFIG_TR_SERVO_TASK_STACK> g_taskStorage;
+    static tr::rtos::StaticQueue<tr::servo::Event, 3> g_queueStorage;
+
     static QueueHandle_t g_queue = nullptr;
     static TaskHandle_t g_task = nullptr;
     
     void task(void* _pvParameter)
     {
         Servo servo;
+        tr::heap_guard::armCurrentTask();
 
         tr::servo::Event event;
         while (true)
         {
-            if (xQueueReceive(g_queue, &event, portMAX_DELAY))
+            if (!xQueueReceive(g_queue, &event, servo.isRunning() ? SettleTime : portMAX_DELAY))
             {
-                ESP_LOGI(TAG, "Rotate, angle: %d", event.desiredRotationDeg);
-                servo.rotate(event.desiredRotationDeg);
+                servo.release();
+            }
+            else
+            {
+                tr::monitor::begin(tr::monitor::Task::Servo);
+                ESP_LOGI(TAG, "Compare ticks: %u", event.compareTicks);
+                servo.setCompare(event.compareTicks);
+                // The command, the needle itself follows within the servo transit time
+                tr::monitor::record(tr::monitor::Path::Pointer, event.originUs);
+                tr::monitor::end(tr::monitor::Task::Servo);
             }
         }
     }
@@ -142,19 +185,9 @@ namespace tr::servo
             ESP_ERROR_CHECK(ESP_FAIL);
         }
 
-        g_queue = xQueueCreate(3, sizeof(Event));
-
-        if (g_queue == nullptr)
-        {
-            ESP_ERROR_CHECK(ESP_FAIL);
-        }
-
-        // TODO the stack size is higher that it could be because the initialization needs more memory
-        BaseType_t ret = xTaskCreate(task, "ServoTask", 3062, NULL, 8, &g_task);
-        if (ret != pdPASS)
-        {
-            ESP_ERROR_CHECK(ESP_FAIL);
-        }
+        g_queue = g_queueStorage.create();
+        g_task = g_taskStorage.create(task, "ServoTask", NULL, 8);
+        tr::monitor::addTask(tr::monitor::Task::Servo, g_task, g_queue, MonitorBudgetMs);
     }
 
     void deinit()
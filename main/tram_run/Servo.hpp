@@ -3,9 +3,22 @@
 
 namespace tr::servo
 {
+    // One compare tick is one microsecond of pulse width
+    constexpr uint16_t MinCompareTicks = 500;
+    constexpr uint16_t MaxCompareTicks = 2500;
+    constexpr int MinDegree = -90;
+    constexpr int MaxDegree = 90;
+
+    constexpr uint16_t toCompareTicks(int _angleDeg)
+    {
+        const int angle = _angleDeg < MinDegree ? MinDegree : (_angleDeg > MaxDegree ? MaxDegree : _angleDeg);
+        return (angle - MinDegree) * (MaxCompareTicks - MinCompareTicks) / (MaxDegree - MinDegree) + MinCompareTicks;
+    }
+
     struct Event
     {
-        uint8_t desiredRotationDeg = 0;
+        uint16_t compareTicks = toCompareTicks(0);
+        uint32_t originUs = 0;  // monitor::now() when the data shown arrived, 0 when not timed
     };
 
     void init();
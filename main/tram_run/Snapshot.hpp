@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+
+namespace tr
+{
+    // Double buffer shared between one writer and any number of readers, with no lock.
+    //
+    // Readers pin the published buffer and use it in place, a reader never waits and never copies.
+    // The writer fills the other buffer and publishes it with a single store, so a reader always
+    // sees a complete value. Before reusing a buffer the writer waits for its readers to unpin it:
+    // beginWrite() returns nullptr until then, the caller decides how to wait.
+    //
+    // A reader increments the count of the buffer it loaded, then checks the buffer is still the
+    // published one. Both sides use sequentially consistent operations, so either the writer sees
+    // the count and waits, or the reader sees the new index and retries on it.
+    template <typename T>
+    class Snapshot final
+    {
+    public:
+        class Reader final
+        {
+        public:
+            Reader(const Reader&) = delete;
+            Reader& operator=(const Reader&) = delete;
+            ~Reader() { m_snapshot.m_readers[m_index].fetch_sub(1); }
+
+            const T& get() const { return m_snapshot.m_buffers[m_index]; }
+            const T& operator*() const { return get(); }
+            const T* operator->() const { return &get(); }
+
+        private:
+            friend class Snapshot;
+
+            Reader(const Snapshot& _snapshot, uint8_t _index)
+                : m_snapshot{_snapshot}
+                , m_index{_index}
+            {
+            }
+
+            const Snapshot& m_snapshot;
+            uint8_t m_index;
+        };
+
+        // Pins the published value until the reader goes out of scope, keep it short
+        Reader read() const
+        {
+            while (true)
+            {
+                const uint8_t index = m_published.load();
+                m_readers[index].fetch_add(1);
+                if (m_published.load() == index)
+                    return Reader(*this, index);
+                m_readers[index].fetch_sub(1);
+            }
+        }
+
+        // Single writer: the buffer to fill, or nullptr while readers still pin it
+        T* beginWrite()
+        {
+            const uint8_t index = m_published.load() ^ 1;
+            return m_readers[index].load() == 0 ? &m_buffers[index] : nullptr;
+        }
+
+        // Makes the buffer returned by beginWrite() the published one
+        void publish()
+        {
+            m_published.store(m_published.load() ^ 1);
+        }
+
+    private:
+        T m_buffers[2] = {};
+        mutable std::atomic<uint16_t> m_readers[2] = {};
+        std::atomic<uint8_t> m_published{0};
+    };
+
+} // namespace tr
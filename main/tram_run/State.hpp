@@ -8,8 +8,9 @@ namespace tr::state
     {
         Init,
         ConnectingToWifi,
-        Run
-
+        Run,
+        Update,
+        Calibrate,
     };
 
     enum class Transit : uint8_t
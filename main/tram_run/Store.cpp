@@ -0,0 +1,159 @@
+#include "tram_run/Store.hpp"
+
+#include <string.h>
+
+namespace
+{
+    constexpr uint32_t HourMs = 60 * 60 * 1000;
+} // namespace
+
+namespace tr::store
+{
+    Store::Store(const char* const* _names, uint8_t _count, Backend _backend, Policy _policy)
+        : m_names{_names}
+        , m_count{_count < MaxKeys ? _count : MaxKeys}
+        , m_backend{_backend}
+        , m_policy{_policy}
+    {
+    }
+
+    void Store::load()
+    {
+        for (uint8_t key = 0; key < m_count; ++key)
+        {
+            Value& value = m_values[key];
+            size_t size = sizeof(value.data);
+            value.size = m_backend.read(m_names[key], value.data, size) ? size : 0;
+            value.dirty = false;
+        }
+    }
+
+    bool Store::get(uint8_t _key, void* _data, size_t _size) const
+    {
+        if (_key >= m_count || m_values[_key].size != _size)
+            return false;
+
+        memcpy(_data, m_values[_key].data, _size);
+        return true;
+    }
+
+    void Store::set(uint8_t _key, const void* _data, size_t _size)
+    {
+        if (_key >= m_count || _size > MaxValueSize)
+            return;
+
+        Value& value = m_values[_key];
+        m_stats.sets++;
+        if (value.size == _size && memcmp(value.data, _data, _size) == 0)
+        {
+            m_stats.unchanged++;
+            return;
+        }
+
+        memcpy(value.data, _data, _size);
+        value.size = _size;
+        value.dirty = true;
+    }
+
+    bool Store::isDirty() const
+    {
+        for (uint8_t key = 0; key < m_count; ++key)
+        {
+            if (m_values[key].dirty)
+                return true;
+        }
+        return false;
+    }
+
+    bool Store::collect(uint32_t _nowMs, bool _force, Batch& _batch)
+    {
+        _batch.count = 0;
+        uint32_t bytes = 0;
+        for (uint8_t key = 0; key < m_count; ++key)
+        {
+            if (m_values[key].dirty)
+                bytes += getNvsEntries(m_values[key].size) * NvsEntrySize;
+        }
+        if (bytes == 0)
+            return false;
+
+        if (_nowMs - m_windowStartMs >= HourMs)
+        {
+            m_windowStartMs = _nowMs;
+            m_windowBytes = 0;
+        }
+
+        if (!_force)
+        {
+            if (m_flushed && _nowMs - m_lastFlushMs < m_policy.minIntervalMs)
+                return false;
+
+            // A flush bigger than the whole cap still goes through once per hour
+            if (m_windowBytes > 0 && m_windowBytes + bytes > m_policy.maxBytesPerHour)
+            {
+                m_stats.deferred++;
+                return false;
+            }
+        }
+
+        for (uint8_t key = 0; key < m_count; ++key)
+        {
+            Value& value = m_values[key];
+            if (!value.dirty)
+                continue;
+
+            Batch::Item& item = _batch.items[_batch.count++];
+            item.key = key;
+            item.size = value.size;
+            memcpy(item.data, value.data, value.size);
+            value.dirty = false;
+        }
+
+        m_flushed = true;
+        m_lastFlushMs = _nowMs;
+        m_windowBytes += bytes;
+        if (_force)
+            m_stats.forcedFlushes++;
+        return true;
+    }
+
+    bool Store::write(const Batch& _batch) const
+    {
+        bool ok = true;
+        for (uint8_t i = 0; i < _batch.count; ++i)
+        {
+            const Batch::Item& item = _batch.items[i];
+            ok &= m_backend.write(m_names[item.key], item.data, item.size);
+        }
+        return m_backend.commit() && ok;
+    }
+
+    void Store::complete(const Batch& _batch, bool _ok, uint32_t _latencyUs)
+    {
+        m_stats.flushes++;
+        m_stats.lastFlushUs = _latencyUs;
+        if (_latencyUs > m_stats.maxFlushUs)
+            m_stats.maxFlushUs = _latencyUs;
+
+        for (uint8_t i = 0; i < _batch.count; ++i)
+        {
+            m_stats.writes++;
+            m_stats.nvsEntries += getNvsEntries(_batch.items[i].size);
+        }
+
+        // Retried with the next flush, a newer value set in between simply wins
+        if (!_ok)
+        {
+            m_stats.failures++;
+            for (uint8_t i = 0; i < _batch.count; ++i)
+                m_values[_batch.items[i].key].dirty = true;
+        }
+    }
+
+    uint32_t Store::getEstimatedEraseCycles(uint32_t _pages) const
+    {
+        const uint32_t usablePages = _pages > 1 ? _pages - 1 : 1;
+        return m_stats.nvsEntries / (NvsEntriesPerPage * usablePages);
+    }
+
+} // namespace tr::store
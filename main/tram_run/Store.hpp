@@ -0,0 +1,142 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tram_run/Delegate.hpp"
+
+namespace tr::store
+{
+    // RAM shadow of a few small persistent values with coalesced, rate limited writes.
+    //
+    // set() only updates the shadow and marks the value dirty, unchanged values are dropped.
+    // A flush writes every dirty value at once, at most every minIntervalMs and within
+    // maxBytesPerHour of flash, unless forced. The flush is split so the caller can keep the
+    // slow part out of its lock: collect() copies the dirty values into a batch, write() sends
+    // the batch to the backend, complete() records the result.
+    //
+    // No threading and no flash access in here, the backend is a set of delegates,
+    // see Persist.cpp for the NVS one.
+
+    constexpr uint8_t MaxKeys = 6;
+    constexpr size_t MaxValueSize = 96;
+
+    // NVS stores values in 32 byte entries, 126 of them per 4 KB page. A blob costs its data
+    // entries plus a header and an index entry.
+    constexpr size_t NvsEntrySize = 32;
+    constexpr uint32_t NvsEntriesPerPage = 126;
+
+    constexpr uint32_t getNvsEntries(size_t _size)
+    {
+        return 2 + (_size + NvsEntrySize - 1) / NvsEntrySize;
+    }
+
+    struct Backend
+    {
+        // _size is the capacity on input and the stored size on output
+        Delegate<bool(const char*, void*, size_t&)> read;
+        Delegate<bool(const char*, const void*, size_t)> write;
+        Delegate<bool()> commit;
+    };
+
+    struct Policy
+    {
+        uint32_t minIntervalMs = 60 * 1000;
+        uint32_t maxBytesPerHour = 4096;
+    };
+
+    struct Stats
+    {
+        uint32_t sets = 0;
+        uint32_t unchanged = 0;     // set() with the value already in the shadow
+        uint32_t flushes = 0;
+        uint32_t forcedFlushes = 0;
+        uint32_t deferred = 0;      // Flushes postponed by the bytes per hour cap
+        uint32_t failures = 0;
+        uint32_t writes = 0;        // Values written
+        uint32_t nvsEntries = 0;    // Flash entries used by the writes
+        uint32_t lastFlushUs = 0;
+        uint32_t maxFlushUs = 0;
+    };
+
+    struct Batch
+    {
+        struct Item
+        {
+            uint8_t key;
+            uint8_t size;
+            uint8_t data[MaxValueSize];
+        };
+
+        Item items[MaxKeys];
+        uint8_t count = 0;
+    };
+
+    class Store final
+    {
+    public:
+        // _names are the backend keys, they must outlive the store
+        Store(const char* const* _names, uint8_t _count, Backend _backend, Policy _policy);
+
+        // Reads every value from the backend into the shadow
+        void load();
+
+        // False when the value is missing or was stored with another size
+        bool get(uint8_t _key, void* _data, size_t _size) const;
+        void set(uint8_t _key, const void* _data, size_t _size);
+        bool isDirty() const;
+
+        // True with a non empty batch when a flush is due, _force skips the interval and the cap
+        bool collect(uint32_t _nowMs, bool _force, Batch& _batch);
+        bool write(const Batch& _batch) const;
+        void complete(const Batch& _batch, bool _ok, uint32_t _latencyUs);
+
+        const Stats& getStats() const { return m_stats; }
+        // Erase cycles of every NVS page so far, assuming the writes spread over _pages - 1 pages
+        // (NVS keeps one page free for the garbage collection)
+        uint32_t getEstimatedEraseCycles(uint32_t _pages) const;
+
+    private:
+        struct Value
+        {
+            uint8_t data[MaxValueSize];
+            uint8_t size = 0;
+            bool dirty = false;
+        };
+
+        const char* const* m_names;
+        uint8_t m_count;
+        Backend m_backend;
+        Policy m_policy;
+
+        Value m_values[MaxKeys];
+        bool m_flushed = false;
+        uint32_t m_lastFlushMs = 0;
+        uint32_t m_windowStartMs = 0;
+        uint32_t m_windowBytes = 0;
+        Stats m_stats;
+    };
+
+    // One flush as the persist task runs it: _lock (lock() and unlock()) is only held while the
+    // batch is collected and completed, never across the writes, which _getNowUs times.
+    // False when no flush was due.
+    template <typename Lock, typename Clock>
+    bool flush(Store& _store, Batch& _batch, uint32_t _nowMs, bool _force, Lock& _lock, Clock _getNowUs)
+    {
+        _lock.lock();
+        const bool due = _store.collect(_nowMs, _force, _batch);
+        _lock.unlock();
+        if (!due)
+            return false;
+
+        const uint32_t start = _getNowUs();
+        const bool ok = _store.write(_batch);
+        const uint32_t latencyUs = _getNowUs() - start;
+
+        _lock.lock();
+        _store.complete(_batch, ok, latencyUs);
+        _lock.unlock();
+        return true;
+    }
+
+} // namespace tr::store
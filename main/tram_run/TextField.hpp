@@ -0,0 +1,88 @@
+#pragma once
+
+#include "tram_run/Font.hpp"
+
+#include <stdint.h>
+#include <string.h>
+
+#include <string_view>
+
+namespace tr::display
+{
+    // Remembers which glyph every cell of a text field shows on the panel,
+    // so a redraw only sends the pages of the cells that actually changed.
+    class TextField final
+    {
+    public:
+        static constexpr uint8_t MaxCells = 16;
+        static constexpr unsigned ScreenWidth = 128;
+
+        TextField() = default;
+        TextField(const font::View& _font, uint8_t _page, uint8_t _column)
+            : m_font{&_font}
+            , m_page{_page}
+            , m_column{_column}
+        {
+            invalidate();
+        }
+
+        bool isAt(const font::View& _font, uint8_t _page, uint8_t _column) const
+        {
+            return m_font == &_font && m_page == _page && m_column == _column;
+        }
+
+        // The panel content is unknown, the next draw repaints every cell
+        void invalidate()
+        {
+            memset(m_cells, Unknown, sizeof(m_cells));
+        }
+
+        // The panel has just been cleared, blank cells don't have to be sent again
+        void markBlank()
+        {
+            memset(m_cells, 0, sizeof(m_cells));
+            m_usedCells = 0;
+        }
+
+        // _sink(page, column, bytes, width) is called for every glyph page that has to be written.
+        // Returns the number of bytes sent.
+        template <typename Sink>
+        unsigned draw(std::string_view _text, Sink&& _sink)
+        {
+            // Cells past the text are blanked only as far as the previous text reached,
+            // so the field never paints over whatever is to the right of it
+            const uint8_t cells = _text.size() < MaxCells ? _text.size() : MaxCells;
+            const uint8_t end = cells > m_usedCells ? cells : m_usedCells;
+            m_usedCells = cells;
+
+            unsigned written = 0;
+            for (uint8_t cell = 0; cell < end; ++cell)
+            {
+                const unsigned column = m_column + cell * m_font->cellWidth();
+                if (column + m_font->width > ScreenWidth)
+                    break;
+
+                const uint8_t glyph = cell < _text.size() ? m_font->indexOf(_text[cell]) : 0;
+                if (glyph == m_cells[cell])
+                    continue;
+
+                for (uint8_t page = 0; page < m_font->pages; ++page)
+                    _sink(m_page + page, column, m_font->page(glyph, page), m_font->width);
+
+                written += m_font->pages * m_font->width;
+                m_cells[cell] = glyph;
+            }
+            return written;
+        }
+
+    private:
+        static constexpr uint8_t Unknown = 0xFF;
+
+        const font::View* m_font = nullptr;
+        uint8_t m_page = 0;
+        uint8_t m_column = 0;
+        uint8_t m_usedCells = 0;
+        uint8_t m_cells[MaxCells];
+    };
+
+} // namespace tr::display
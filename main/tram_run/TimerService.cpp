@@ -0,0 +1,121 @@
+#include "tram_run/TimerService.hpp"
+
+#include "esp_log.h"
+
+namespace
+{
+    static const char* TAG = "TR_TIMER";
+
+    uint32_t toTicks(uint32_t _ms)
+    {
+        return (_ms + tr::app::TimerService::ResolutionMs - 1) / tr::app::TimerService::ResolutionMs;
+    }
+} // namespace
+
+namespace tr::app
+{
+    void TimerService::init(Inbox& _inbox)
+    {
+        m_inbox = &_inbox;
+
+        esp_timer_create_args_t args = {};
+        args.callback = &onEspTimer;
+        args.arg = this;
+        args.dispatch_method = ESP_TIMER_TASK;
+        args.name = "TrTimer";
+        ESP_ERROR_CHECK(esp_timer_create(&args, &m_espTimer));
+    }
+
+    TimerService::Id TimerService::startOneShot(Timer _timer, uint32_t _delayMs, uint8_t _owner)
+    {
+        return start(_timer, _delayMs, 0, _owner);
+    }
+
+    TimerService::Id TimerService::startPeriodic(Timer _timer, uint32_t _periodMs, uint8_t _owner)
+    {
+        return start(_timer, _periodMs, _periodMs, _owner);
+    }
+
+    TimerService::Id TimerService::start(Timer _timer, uint32_t _delayMs, uint32_t _periodMs, uint8_t _owner)
+    {
+        const uint32_t now = getNow();
+        const uint32_t delay = toTicks(_delayMs);
+        const Id id = m_wheel.arm(now, delay, toTicks(_periodMs), _owner, static_cast<uint8_t>(_timer));
+        if (id == InvalidId)
+        {
+            ESP_LOGE(TAG, "Out of timers, increase CONFIG_TR_TIMER_CAPACITY");
+            configASSERT(false);
+        }
+
+        // A later deadline is found by the poll after the armed one
+        const uint32_t deadline = now + (delay > 0 ? delay : 1);
+        if (!m_espTimerArmed || static_cast<int32_t>(deadline - m_espTimerDeadline) < 0)
+            armEspTimer(deadline);
+        return id;
+    }
+
+    void TimerService::cancel(Id _id)
+    {
+        m_wheel.cancel(_id);
+    }
+
+    void TimerService::cancelOwner(uint8_t _owner)
+    {
+        m_wheel.cancelOwner(_owner);
+    }
+
+    bool TimerService::poll(Event& _event, uint8_t& _owner)
+    {
+        TimerWheel<CONFIG_TR_TIMER_CAPACITY>::Expired expired;
+        if (!m_wheel.poll(getNow(), expired))
+        {
+            reschedule();
+            return false;
+        }
+
+        _event.type = Event::Type::Timeout;
+        _event.timer = static_cast<Timer>(expired.tag);
+        _owner = expired.owner;
+        return true;
+    }
+
+    void TimerService::onEspTimer(void* _arg)
+    {
+        TimerService& service = *static_cast<TimerService*>(_arg);
+
+        Event event;
+        event.type = Event::Type::TimerTick;
+        service.m_inbox->post(event);
+    }
+
+    void TimerService::reschedule()
+    {
+        const uint32_t ticks = m_wheel.getTicksToNext();
+        if (ticks == UINT32_MAX)
+        {
+            esp_timer_stop(m_espTimer);
+            m_espTimerArmed = false;
+            return;
+        }
+
+        // The wheel counts from its last poll, which may lag behind the real time
+        armEspTimer(m_wheel.getNow() + ticks);
+    }
+
+    void TimerService::armEspTimer(uint32_t _deadline)
+    {
+        esp_timer_stop(m_espTimer);
+
+        const int32_t ahead = static_cast<int32_t>(_deadline - getNow());
+        const uint64_t delayUs = ahead > 0 ? static_cast<uint64_t>(ahead) * ResolutionMs * 1000 : 0;
+        ESP_ERROR_CHECK(esp_timer_start_once(m_espTimer, delayUs));
+        m_espTimerArmed = true;
+        m_espTimerDeadline = _deadline;
+    }
+
+    uint32_t TimerService::getNow() const
+    {
+        return esp_timer_get_time() / (ResolutionMs * 1000);
+    }
+
+} // namespace tr::app
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "sdkconfig.h"
+
+#include "esp_timer.h"
+
+#include "tram_run/Event.hpp"
+#include "tram_run/Inbox.hpp"
+#include "tram_run/TimerWheel.hpp"
+
+namespace tr::app
+{
+    // Timeouts for the App states, delivered as Event::Type::Timeout.
+    // A single esp_timer is programmed for the earliest deadline and only posts a TimerTick
+    // into the inbox, the wheel itself is only touched from the main task.
+    // Start and cancel stay O(1): a start only moves the esp_timer to an earlier deadline, a
+    // cancelled deadline is left armed and its TimerTick finds nothing. The next deadline is only
+    // searched for once the expired timers were polled.
+    class TimerService final
+    {
+    public:
+        using Id = uint32_t;
+        static constexpr Id InvalidId = 0;
+        // Timers of this owner survive the state transitions
+        static constexpr uint8_t GlobalOwner = 0xFF;
+        static constexpr uint32_t ResolutionMs = 10;
+
+        void init(Inbox& _inbox);
+
+        Id startOneShot(Timer _timer, uint32_t _delayMs, uint8_t _owner);
+        Id startPeriodic(Timer _timer, uint32_t _periodMs, uint8_t _owner);
+        void cancel(Id _id);
+        void cancelOwner(uint8_t _owner);
+
+        // Called on a TimerTick, returns the expired timers one by one
+        bool poll(Event& _event, uint8_t& _owner);
+
+    private:
+        static void onEspTimer(void* _arg);
+
+        Id start(Timer _timer, uint32_t _delayMs, uint32_t _periodMs, uint8_t _owner);
+        void reschedule();
+        // _deadline in ticks of getNow()
+        void armEspTimer(uint32_t _deadline);
+        uint32_t getNow() const;
+
+        TimerWheel<CONFIG_TR_TIMER_CAPACITY> m_wheel;
+        esp_timer_handle_t m_espTimer = nullptr;
+        bool m_espTimerArmed = false;
+        uint32_t m_espTimerDeadline = 0;
+        Inbox* m_inbox = nullptr;
+    };
+
+} // namespace tr::app
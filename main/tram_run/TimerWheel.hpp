@@ -0,0 +1,246 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace tr::app
+{
+    // Hashed timing wheel over a fixed pool of timers.
+    // Arm and cancel are O(1), advancing costs one slot per elapsed tick. The timers of an owner
+    // are also linked together, so cancelling them all only visits them.
+    // The wheel knows nothing about the real clock, the caller passes "now" in ticks,
+    // so the same code runs on a virtual clock. Tick arithmetic wraps around safely.
+    template <uint16_t Capacity, uint16_t Slots = 256>
+    class TimerWheel final
+    {
+    public:
+        using Id = uint32_t;
+        static constexpr Id InvalidId = 0;
+
+        struct Expired
+        {
+            Id id = InvalidId;
+            uint8_t owner = 0;
+            uint8_t tag = 0;
+        };
+
+        explicit TimerWheel(uint32_t _now = 0)
+            : m_now{_now}
+        {
+            for (uint16_t i = 0; i < ListCount; ++i)
+                m_heads[i] = Nil;
+            for (uint16_t i = 0; i < OwnerCount; ++i)
+                m_ownerHeads[i] = Nil;
+            for (uint16_t i = 0; i < Capacity; ++i)
+            {
+                m_nodes[i].next = i + 1 < Capacity ? i + 1 : Nil;
+                m_nodes[i].list = FreeList;
+            }
+            m_heads[FreeList] = 0;
+        }
+
+        // A zero _period makes a one-shot timer. Returns InvalidId when the pool is exhausted.
+        Id arm(uint32_t _now, uint32_t _delay, uint32_t _period, uint8_t _owner, uint8_t _tag)
+        {
+            const uint16_t index = m_heads[FreeList];
+            if (index == Nil)
+                return InvalidId;
+
+            unlink(index);
+            Node& node = m_nodes[index];
+            node.generation = node.generation + 1 == 0 ? 1 : node.generation + 1;
+            node.period = _period;
+            node.owner = _owner;
+            node.tag = _tag;
+            linkOwner(index);
+            schedule(index, _now + _delay);
+            m_armed++;
+
+            return toId(index);
+        }
+
+        void cancel(Id _id)
+        {
+            const uint16_t index = _id & 0xFFFF;
+            if (index >= Capacity || toId(index) != _id || m_nodes[index].list == FreeList)
+                return;
+
+            release(index);
+        }
+
+        // Cancels every timer of the owner, O(timers of the owner)
+        void cancelOwner(uint8_t _owner)
+        {
+            while (m_ownerHeads[_owner] != Nil)
+                release(m_ownerHeads[_owner]);
+        }
+
+        // Returns the expired timers one by one, so the caller may arm and cancel in between.
+        // Periodic timers are re-armed before they are returned.
+        bool poll(uint32_t _now, Expired& _expired)
+        {
+            while (m_heads[ExpiredList] == Nil && m_now != _now)
+            {
+                m_now++;
+                const uint16_t slot = m_now % Slots;
+                for (uint16_t i = m_heads[slot]; i != Nil;)
+                {
+                    const uint16_t next = m_nodes[i].next;
+                    if (m_nodes[i].rounds > 0)
+                    {
+                        m_nodes[i].rounds--;
+                    }
+                    else
+                    {
+                        unlink(i);
+                        push(ExpiredList, i);
+                    }
+                    i = next;
+                }
+            }
+
+            const uint16_t index = m_heads[ExpiredList];
+            if (index == Nil)
+                return false;
+
+            _expired.id = toId(index);
+            _expired.owner = m_nodes[index].owner;
+            _expired.tag = m_nodes[index].tag;
+
+            unlink(index);
+            if (m_nodes[index].period > 0)
+                schedule(index, m_now + m_nodes[index].period);
+            else
+                release(index, false);
+            return true;
+        }
+
+        // Ticks from the last poll until the earliest deadline, UINT32_MAX without armed timers.
+        // O(Slots + timers in the visited slots).
+        uint32_t getTicksToNext() const
+        {
+            if (m_heads[ExpiredList] != Nil)
+                return 0;
+
+            uint32_t best = UINT32_MAX;
+            for (uint32_t k = 1; k <= Slots; ++k)
+            {
+                for (uint16_t i = m_heads[(m_now + k) % Slots]; i != Nil; i = m_nodes[i].next)
+                {
+                    const uint32_t ticks = k + m_nodes[i].rounds * Slots;
+                    if (ticks < best)
+                        best = ticks;
+                }
+                // Anything in the later slots is further away
+                if (best <= k)
+                    break;
+            }
+            return best;
+        }
+
+        uint32_t getNow() const { return m_now; }
+        uint16_t getArmedCount() const { return m_armed; }
+
+    private:
+        static constexpr uint16_t Nil = 0xFFFF;
+        static constexpr uint16_t ExpiredList = Slots;
+        static constexpr uint16_t FreeList = Slots + 1;
+        static constexpr uint16_t ListCount = Slots + 2;
+        static constexpr uint16_t OwnerCount = 256;
+
+        static_assert(Capacity < Nil && ListCount < Nil, "Indices must fit 16 bits");
+        // The slot of a tick stays in step across the wraparound of the tick counter only then
+        static_assert((Slots & (Slots - 1)) == 0, "Slots must be a power of two");
+
+        struct Node
+        {
+            uint32_t rounds = 0;
+            uint32_t period = 0;
+            uint16_t next = Nil;
+            uint16_t prev = Nil;
+            uint16_t list = Nil;
+            uint16_t ownerNext = Nil;
+            uint16_t ownerPrev = Nil;
+            uint16_t generation = 0;
+            uint8_t owner = 0;
+            uint8_t tag = 0;
+        };
+
+        Id toId(uint16_t _index) const
+        {
+            return (static_cast<uint32_t>(m_nodes[_index].generation) << 16) | _index;
+        }
+
+        void schedule(uint16_t _index, uint32_t _deadline)
+        {
+            // Never in the past: a deadline already reached fires on the next tick
+            uint32_t ahead = _deadline - m_now;
+            if (ahead == 0 || ahead > UINT32_MAX / 2)
+                ahead = 1;
+
+            m_nodes[_index].rounds = (ahead - 1) / Slots;
+            push((m_now + ahead) % Slots, _index);
+        }
+
+        void release(uint16_t _index, bool _unlink = true)
+        {
+            if (_unlink)
+                unlink(_index);
+            unlinkOwner(_index);
+            push(FreeList, _index);
+            m_armed--;
+        }
+
+        void push(uint16_t _list, uint16_t _index)
+        {
+            Node& node = m_nodes[_index];
+            node.list = _list;
+            node.prev = Nil;
+            node.next = m_heads[_list];
+            if (node.next != Nil)
+                m_nodes[node.next].prev = _index;
+            m_heads[_list] = _index;
+        }
+
+        void unlink(uint16_t _index)
+        {
+            Node& node = m_nodes[_index];
+            if (node.prev != Nil)
+                m_nodes[node.prev].next = node.next;
+            else
+                m_heads[node.list] = node.next;
+            if (node.next != Nil)
+                m_nodes[node.next].prev = node.prev;
+            node.next = node.prev = Nil;
+            node.list = Nil;
+        }
+
+        void linkOwner(uint16_t _index)
+        {
+            Node& node = m_nodes[_index];
+            node.ownerPrev = Nil;
+            node.ownerNext = m_ownerHeads[node.owner];
+            if (node.ownerNext != Nil)
+                m_nodes[node.ownerNext].ownerPrev = _index;
+            m_ownerHeads[node.owner] = _index;
+        }
+
+        void unlinkOwner(uint16_t _index)
+        {
+            Node& node = m_nodes[_index];
+            if (node.ownerPrev != Nil)
+                m_nodes[node.ownerPrev].ownerNext = node.ownerNext;
+            else
+                m_ownerHeads[node.owner] = node.ownerNext;
+            if (node.ownerNext != Nil)
+                m_nodes[node.ownerNext].ownerPrev = node.ownerPrev;
+            node.ownerNext = node.ownerPrev = Nil;
+        }
+
+        Node m_nodes[Capacity];
+        uint16_t m_heads[ListCount];
+        uint16_t m_ownerHeads[OwnerCount];
+        uint32_t m_now = 0;
+        uint16_t m_armed = 0;
+    };
+
+} // namespace tr::app
@@ -0,0 +1,196 @@
+#include "tram_run/Timetable.hpp"
+
+#include <string.h>
+
+namespace
+{
+    uint16_t readU16(const uint8_t* _data)
+    {
+        return _data[0] | (_data[1] << 8);
+    }
+
+    uint32_t readU32(const uint8_t* _data)
+    {
+        return _data[0] | (_data[1] << 8) | (_data[2] << 16) | (uint32_t(_data[3]) << 24);
+    }
+
+    // Keeps the _max soonest departures ordered by time, returns false when _departure did not fit
+    bool insert(tr::departures::Departure* _departures, uint8_t& _count, uint8_t _max,
+        const tr::departures::Departure& _departure)
+    {
+        if (_count == _max && (_max == 0 || _departure.time >= _departures[_count - 1].time))
+            return false;
+
+        uint8_t i = _count < _max ? _count++ : _max - 1;
+        while (i > 0 && _departures[i - 1].time > _departure.time)
+        {
+            _departures[i] = _departures[i - 1];
+            --i;
+        }
+        _departures[i] = _departure;
+        return true;
+    }
+} // namespace
+
+namespace tr::timetable
+{
+    bool Reader::open(const uint8_t* _image, size_t _size)
+    {
+        m_image = nullptr;
+        m_size = 0;
+        m_serviceCount = 0;
+
+        if (_image == nullptr || _size < HeaderSize || memcmp(_image, Magic, sizeof(Magic)) != 0)
+            return false;
+
+        const uint16_t serviceCount = readU16(_image + 4);
+        const uint32_t imageSize = readU32(_image + 8);
+        if (imageSize > _size || HeaderSize + size_t(serviceCount) * ServiceSize > imageSize)
+            return false;
+
+        m_image = _image;
+        m_size = imageSize;
+        m_serviceCount = serviceCount;
+
+        for (uint16_t i = 0; i < serviceCount; ++i)
+        {
+            const Service service = getService(i);
+            const uint16_t checkpoints = (service.tripCount + CheckpointStride - 1) / CheckpointStride;
+            if (service.checkpointCount != checkpoints
+                || service.offset + size_t(service.checkpointCount) * CheckpointSize > imageSize)
+            {
+                m_image = nullptr;
+                m_size = 0;
+                m_serviceCount = 0;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    Service Reader::getService(uint16_t _index) const
+    {
+        const uint8_t* entry = m_image + HeaderSize + size_t(_index) * ServiceSize;
+
+        Service service;
+        service.stop = entry[0];
+        service.weekdays = entry[1];
+        memcpy(service.line, entry + 2, sizeof(service.line));
+        service.tripCount = readU16(entry + 8);
+        service.checkpointCount = readU16(entry + 10);
+        service.offset = readU32(entry + 12);
+        return service;
+    }
+
+    uint8_t Reader::findNext(const Service& _service, uint16_t _minute, uint16_t* _trips, uint8_t _max) const
+    {
+        if (_service.tripCount == 0 || _max == 0)
+            return 0;
+
+        const uint8_t* checkpoints = m_image + _service.offset;
+        const size_t deltasStart = _service.offset + size_t(_service.checkpointCount) * CheckpointSize;
+
+        // The first checkpoint at or after _minute, the search starts from the one before it,
+        // so equal trips on both sides of a checkpoint are not skipped
+        uint16_t low = 0;
+        uint16_t high = _service.checkpointCount;
+        while (low < high)
+        {
+            const uint16_t middle = (low + high) / 2;
+            if (readU16(checkpoints + middle * CheckpointSize) < _minute)
+                low = middle + 1;
+            else
+                high = middle;
+        }
+
+        // The trip at index, its minute and the position of the next delta
+        int32_t index = -1;
+        uint16_t minute = 0;
+        size_t position = deltasStart;
+        if (low > 0)
+        {
+            const uint8_t* checkpoint = checkpoints + (low - 1) * CheckpointSize;
+            index = (low - 1) * CheckpointStride;
+            minute = readU16(checkpoint);
+            position = deltasStart + readU16(checkpoint + 2);
+        }
+
+        uint8_t count = 0;
+        while (true)
+        {
+            if (index >= 0 && minute >= _minute)
+            {
+                _trips[count++] = minute;
+                if (count == _max)
+                    break;
+            }
+            if (++index >= _service.tripCount || position >= m_size)
+                break;
+
+            uint16_t delta = m_image[position++];
+            if (delta == DeltaEscape)
+            {
+                if (position + 2 > m_size)
+                    break;
+                delta = readU16(m_image + position);
+                position += 2;
+            }
+            minute += delta;
+        }
+        return count;
+    }
+
+    uint8_t Reader::collect(uint8_t _stop, int _weekday, uint16_t _minute, uint32_t _midnight,
+        departures::Departure* _departures, uint8_t _max) const
+    {
+        uint8_t count = 0;
+        uint16_t trips[departures::MaxPerSource];
+        const uint8_t maxTrips = _max < departures::MaxPerSource ? _max : departures::MaxPerSource;
+
+        // Yesterday's night trips, then today and tomorrow
+        for (int day = -1; day <= 1; ++day)
+        {
+            const int weekday = (_weekday + day + 7) % 7;
+            const int serviceMinute = int(_minute) - day * MinutesPerDay;
+            if (serviceMinute > MaxMinute)
+                continue;
+
+            for (uint16_t i = 0; i < m_serviceCount; ++i)
+            {
+                const Service service = getService(i);
+                if (service.stop != _stop || !service.runsOn(weekday))
+                    continue;
+
+                const uint8_t found = findNext(service, serviceMinute > 0 ? serviceMinute : 0, trips, maxTrips);
+                for (uint8_t n = 0; n < found; ++n)
+                {
+                    departures::Departure departure;
+                    departure.time = _midnight + (day * MinutesPerDay + trips[n]) * 60;
+                    departure.vehicleId = (uint32_t(i) << 14) | (uint32_t(day + 1) << 12) | trips[n];
+                    memcpy(departure.line, service.line, sizeof(departure.line));
+                    departure.source = _stop;
+
+                    // The trips come in order, so the rest of them would not fit either
+                    if (!insert(_departures, count, _max, departure))
+                        break;
+                }
+            }
+        }
+        return count;
+    }
+
+    bool Reader::collectBoard(int _weekday, uint16_t _minute, uint32_t _midnight, uint32_t _now,
+        departures::Aggregator& _aggregator, departures::Board& _board) const
+    {
+        departures::Departure items[departures::MaxPerSource];
+        for (uint8_t stop = 0; stop < departures::MaxSources; ++stop)
+        {
+            const uint8_t count = collect(stop, _weekday, _minute, _midnight, items, departures::MaxPerSource);
+            _aggregator.update(stop, items, count, _now);
+        }
+
+        _board = _aggregator.getBoard();
+        return _board.count > 0;
+    }
+
+} // namespace tr::timetable
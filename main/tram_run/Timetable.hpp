@@ -0,0 +1,76 @@
+#pragma once
+
+#include "tram_run/Departures.hpp"
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace tr::timetable
+{
+    // Compact static timetable, packed by tools/timetable_pack and read in place from flash.
+    //
+    // Image: a 16 byte header, the service table, then the trips of every service.
+    //   Header:  "TRT1", uint16 service count, uint16 reserved, uint32 image size, uint32 reserved
+    //   Service: uint8 stop index, uint8 weekday mask (bit 0 is Sunday, as tm_wday),
+    //            char line[6], uint16 trip count, uint16 checkpoint count, uint32 data offset
+    //   Data:    the checkpoints, then the delta stream
+    //
+    // Trips are minutes since the midnight starting the service day, they may go past 24:00 for
+    // the night trips. The delta stream holds the difference to the previous trip, one byte when
+    // under 255, otherwise 255 followed by an uint16. Every CheckpointStride-th trip gets a
+    // checkpoint {uint16 minute, uint16 offset of the next delta}, so a lookup is a binary search
+    // over the checkpoints followed by at most CheckpointStride - 1 decoded deltas.
+    //
+    // All the fields are little-endian and read byte by byte, so nothing has to be aligned.
+    constexpr uint8_t Magic[4] = {'T', 'R', 'T', '1'};
+    constexpr size_t HeaderSize = 16;
+    constexpr size_t ServiceSize = 16;
+    constexpr size_t CheckpointSize = 4;
+    constexpr uint16_t CheckpointStride = 16;
+    constexpr uint8_t DeltaEscape = 255;
+    constexpr uint16_t MinutesPerDay = 24 * 60;
+    constexpr uint16_t MaxMinute = 2 * MinutesPerDay - 1;
+
+    struct Service
+    {
+        uint8_t stop = 0;
+        uint8_t weekdays = 0;
+        char line[departures::MaxLineLength] = {};
+        uint16_t tripCount = 0;
+        uint16_t checkpointCount = 0;
+        uint32_t offset = 0;
+
+        bool runsOn(int _weekday) const { return weekdays & (1u << _weekday); }
+    };
+
+    class Reader final
+    {
+    public:
+        // Checks the header and the service table, the image is used in place and must outlive the reader
+        bool open(const uint8_t* _image, size_t _size);
+        bool isOpen() const { return m_image != nullptr; }
+
+        uint16_t getServiceCount() const { return m_serviceCount; }
+        Service getService(uint16_t _index) const;
+
+        // Copies up to _max trips of the service at or after _minute, in order, returns the count
+        uint8_t findNext(const Service& _service, uint16_t _minute, uint16_t* _trips, uint8_t _max) const;
+
+        // The soonest departures of a stop at the given local time, from the services of yesterday
+        // still running past midnight, today and tomorrow. _midnight is the unix time of today's
+        // local midnight. The departures are ordered by time and get a vehicle id unique per trip.
+        uint8_t collect(uint8_t _stop, int _weekday, uint16_t _minute, uint32_t _midnight,
+            departures::Departure* _departures, uint8_t _max) const;
+
+        // The soonest departures of every stop merged by _aggregator, what the Run state shows
+        // without live departures. False when nothing runs.
+        bool collectBoard(int _weekday, uint16_t _minute, uint32_t _midnight, uint32_t _now,
+            departures::Aggregator& _aggregator, departures::Board& _board) const;
+
+    private:
+        const uint8_t* m_image = nullptr;
+        size_t m_size = 0;
+        uint16_t m_serviceCount = 0;
+    };
+
+} // namespace tr::timetable
@@ -0,0 +1,95 @@
+#include "tram_run/TimetableEncoder.hpp"
+
+#include <string.h>
+
+namespace
+{
+    void writeU16(std::vector<uint8_t>& _out, size_t _at, uint16_t _value)
+    {
+        _out[_at] = _value & 0xFF;
+        _out[_at + 1] = _value >> 8;
+    }
+
+    void writeU32(std::vector<uint8_t>& _out, size_t _at, uint32_t _value)
+    {
+        writeU16(_out, _at, _value & 0xFFFF);
+        writeU16(_out, _at + 2, _value >> 16);
+    }
+} // namespace
+
+namespace tr::timetable
+{
+    bool Encoder::addService(uint8_t _stop, uint8_t _weekdays, std::string_view _line, std::vector<uint16_t> _trips)
+    {
+        if (_line.empty() || _line.size() > departures::MaxLineLength || _trips.size() > MaxMinute + 1u)
+            return false;
+
+        for (size_t i = 0; i < _trips.size(); ++i)
+        {
+            if (_trips[i] > MaxMinute || (i > 0 && _trips[i] < _trips[i - 1]))
+                return false;
+        }
+
+        Entry entry;
+        entry.service.stop = _stop;
+        entry.service.weekdays = _weekdays;
+        memcpy(entry.service.line, _line.data(), _line.size());
+        entry.service.tripCount = _trips.size();
+        entry.service.checkpointCount = (_trips.size() + CheckpointStride - 1) / CheckpointStride;
+        entry.trips = std::move(_trips);
+        m_entries.push_back(std::move(entry));
+        return true;
+    }
+
+    std::vector<uint8_t> Encoder::build() const
+    {
+        std::vector<uint8_t> out(HeaderSize + m_entries.size() * ServiceSize, 0);
+        memcpy(out.data(), Magic, sizeof(Magic));
+        writeU16(out, 4, m_entries.size());
+
+        for (size_t i = 0; i < m_entries.size(); ++i)
+        {
+            const Entry& entry = m_entries[i];
+            const size_t serviceAt = HeaderSize + i * ServiceSize;
+            const size_t checkpointsAt = out.size();
+
+            out[serviceAt] = entry.service.stop;
+            out[serviceAt + 1] = entry.service.weekdays;
+            memcpy(&out[serviceAt + 2], entry.service.line, sizeof(entry.service.line));
+            writeU16(out, serviceAt + 8, entry.service.tripCount);
+            writeU16(out, serviceAt + 10, entry.service.checkpointCount);
+            writeU32(out, serviceAt + 12, checkpointsAt);
+
+            out.resize(out.size() + entry.service.checkpointCount * CheckpointSize);
+            const size_t deltasAt = out.size();
+
+            uint16_t previous = 0;
+            for (size_t n = 0; n < entry.trips.size(); ++n)
+            {
+                const uint16_t delta = entry.trips[n] - previous;
+                previous = entry.trips[n];
+                if (delta < DeltaEscape)
+                {
+                    out.push_back(delta);
+                }
+                else
+                {
+                    out.push_back(DeltaEscape);
+                    out.push_back(delta & 0xFF);
+                    out.push_back(delta >> 8);
+                }
+
+                if (n % CheckpointStride == 0)
+                {
+                    const size_t checkpointAt = checkpointsAt + (n / CheckpointStride) * CheckpointSize;
+                    writeU16(out, checkpointAt, entry.trips[n]);
+                    writeU16(out, checkpointAt + 2, out.size() - deltasAt);
+                }
+            }
+        }
+
+        writeU32(out, 8, out.size());
+        return out;
+    }
+
+} // namespace tr::timetable
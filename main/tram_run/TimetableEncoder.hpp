@@ -0,0 +1,30 @@
+#pragma once
+
+#include "tram_run/Timetable.hpp"
+
+#include <string_view>
+#include <vector>
+
+namespace tr::timetable
+{
+    // Packs the image read by Reader, see Timetable.hpp for the format.
+    // Host side only, built into tools/timetable_pack and not into the firmware.
+    class Encoder final
+    {
+    public:
+        // Returns false when the trips are not sorted or out of range
+        bool addService(uint8_t _stop, uint8_t _weekdays, std::string_view _line, std::vector<uint16_t> _trips);
+
+        std::vector<uint8_t> build() const;
+
+    private:
+        struct Entry
+        {
+            Service service;
+            std::vector<uint16_t> trips;
+        };
+
+        std::vector<Entry> m_entries;
+    };
+
+} // namespace tr::timetable
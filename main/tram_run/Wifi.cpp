@@ -1,10 +1,12 @@
 #include "tram_run/Wifi.hpp"
+#include "tram_run/Persist.hpp"
 
 #include <stdio.h>
 #include <string.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_system.h"
+#include "esp_mac.h"
 #include "esp_wifi.h"
 #include "esp_event.h"
 #include "esp_log.h"
@@ -25,6 +27,37 @@ namespace
     static esp_event_handler_instance_t g_instanceGotIp = nullptr;
 
     static unsigned g_retryNum = 0;
+    static uint8_t g_channelHint = 0;
+
+    // Where the AP was found last time, so the reconnect after a reboot scans a single channel and
+    // goes straight to the same access point
+    struct Hints
+    {
+        uint8_t channel = 0;
+        uint8_t bssid[6] = {};
+    };
+
+    void saveHints()
+    {
+        wifi_ap_record_t ap;
+        if (esp_wifi_sta_get_ap_info(&ap) != ESP_OK)
+            return;
+
+        Hints hints;
+        hints.channel = ap.primary;
+        memcpy(hints.bssid, ap.bssid, sizeof(hints.bssid));
+        tr::persist::set(tr::persist::Key::WifiHints, hints);
+    }
+
+    void dropChannelHint()
+    {
+        wifi_config_t wifiConfig;
+        ESP_ERROR_CHECK(esp_wifi_get_config(WIFI_IF_STA, &wifiConfig));
+        wifiConfig.sta.channel = 0;
+        wifiConfig.sta.bssid_set = false;
+        ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifiConfig));
+        g_channelHint = 0;
+    }
     static tr::wifi::OnWifiStateCallback g_callback{};
 
     static void event_handler(void* _arg, esp_event_base_t _eventBase, int32_t _eventId, void* _eventData)
@@ -47,6 +80,12 @@ namespace
                 case WIFI_EVENT_STA_DISCONNECTED:
                 {
                     ESP_LOGW(TAG, "WIFI_EVENT_STA_DISCONNECTED: Lost connection.");
+                    // The AP may have moved to another channel, scan them all from now on
+                    if (g_channelHint != 0)
+                    {
+                        ESP_LOGI(TAG, "Dropping the channel and BSSID hints");
+                        dropChannelHint();
+                    }
                     if (g_retryNum < TR_ESP_MAXIMUM_RETRY)
                     {
                         esp_wifi_connect();
@@ -77,6 +116,7 @@ namespace
                     ip_event_got_ip_t* event = (ip_event_got_ip_t*) _eventData;
                     ESP_LOGI(TAG, "IP_EVENT_STA_GOT_IP: Got IP:" IPSTR, IP2STR(&event->ip_info.ip));
                     g_retryNum = 0;
+                    saveHints();
 
                     g_callback(tr::wifi::State::Ready);
                     break;
@@ -122,6 +162,18 @@ namespace tr::wifi
             };
 
             staConfig.threshold.authmode = WIFI_AUTH_WPA2_PSK;
+            // Wake up for every third beacon only while the modem sleeps
+            staConfig.listen_interval = 3;
+
+            Hints hints;
+            if (tr::persist::get(tr::persist::Key::WifiHints, hints))
+            {
+                ESP_LOGI(TAG, "Channel hint %u, BSSID " MACSTR, hints.channel, MAC2STR(hints.bssid));
+                staConfig.channel = hints.channel;
+                staConfig.bssid_set = true;
+                memcpy(staConfig.bssid, hints.bssid, sizeof(staConfig.bssid));
+                g_channelHint = hints.channel;
+            }
             wifiConfig.sta = staConfig;
         }
 
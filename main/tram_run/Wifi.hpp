@@ -1,6 +1,6 @@
 #pragma once
 
-#include <functional>
+#include "tram_run/Delegate.hpp"
 
 namespace tr::wifi
 {
@@ -9,7 +9,7 @@ namespace tr::wifi
         Ready,
         NotAbleToConnect
     };
-    using OnWifiStateCallback = std::function<void(State)>;
+    using OnWifiStateCallback = Delegate<void(State)>;
 
     void init(OnWifiStateCallback _callback);
     void deinit();
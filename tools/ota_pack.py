@@ -0,0 +1,116 @@
+#!/usr/bin/env python3
+"""Packs a firmware image for the streaming OTA update, see main/tram_run/Lzss.hpp.
+
+    idf.py build
+    tools/ota_pack.py build/TramRun.bin build/tramrun.trz
+    cd build && python3 -m http.server 8070
+
+and point CONFIG_TR_OTA_URL at http://<host>:8070/tramrun.trz, then long press the button in the Run state.
+"""
+
+import argparse
+import struct
+import sys
+
+MAGIC = b"TRZ1"
+WINDOW_BITS = 11
+WINDOW_SIZE = 1 << WINDOW_BITS
+LENGTH_BITS = 5
+MIN_MATCH = 3
+MAX_MATCH = MIN_MATCH + (1 << LENGTH_BITS) - 1
+MAX_CANDIDATES = 32
+
+
+def compress(data: bytes) -> bytes:
+    out = bytearray(MAGIC + struct.pack("<I", len(data)))
+    chains = {}  # 3-byte prefix -> recent positions, newest last
+
+    flags_pos = -1
+    flags_count = 8
+    pos = 0
+    while pos < len(data):
+        if flags_count == 8:
+            flags_pos = len(out)
+            out.append(0)
+            flags_count = 0
+
+        best_len, best_dist = 0, 0
+        key = data[pos:pos + MIN_MATCH]
+        if len(key) == MIN_MATCH:
+            limit = min(MAX_MATCH, len(data) - pos)
+            for candidate in reversed(chains.get(key, ())):
+                dist = pos - candidate
+                if dist > WINDOW_SIZE:
+                    break
+                length = MIN_MATCH
+                while length < limit and data[candidate + length] == data[pos + length]:
+                    length += 1
+                if length > best_len:
+                    best_len, best_dist = length, dist
+                    if length == limit:
+                        break
+
+        step = best_len if best_len >= MIN_MATCH else 1
+        if best_len >= MIN_MATCH:
+            reference = ((best_dist - 1) << LENGTH_BITS) | (best_len - MIN_MATCH)
+            out += struct.pack(">H", reference)
+        else:
+            out[flags_pos] |= 1 << flags_count
+            out.append(data[pos])
+        flags_count += 1
+
+        for p in range(pos, min(pos + step, len(data) - MIN_MATCH + 1)):
+            chain = chains.setdefault(data[p:p + MIN_MATCH], [])
+            chain.append(p)
+            if len(chain) > MAX_CANDIDATES:
+                del chain[0]
+        pos += step
+
+    return bytes(out)
+
+
+def decompress(packed: bytes) -> bytes:
+    if packed[:4] != MAGIC:
+        raise ValueError("bad magic")
+    (size,) = struct.unpack("<I", packed[4:8])
+    out = bytearray()
+    i = 8
+    while len(out) < size:
+        flags = packed[i]
+        i += 1
+        for bit in range(8):
+            if len(out) == size:
+                break
+            if flags & (1 << bit):
+                out.append(packed[i])
+                i += 1
+            else:
+                (reference,) = struct.unpack(">H", packed[i:i + 2])
+                i += 2
+                dist = (reference >> LENGTH_BITS) + 1
+                for _ in range((reference & ((1 << LENGTH_BITS) - 1)) + MIN_MATCH):
+                    out.append(out[-dist])
+    return bytes(out)
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("image")
+    parser.add_argument("output")
+    args = parser.parse_args()
+
+    with open(args.image, "rb") as f:
+        image = f.read()
+    packed = compress(image)
+    if decompress(packed) != image:
+        print("Round trip failed", file=sys.stderr)
+        return 1
+
+    with open(args.output, "wb") as f:
+        f.write(packed)
+    print(f"{len(image)} -> {len(packed)} bytes ({100 * len(packed) / max(len(image), 1):.1f}%)")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,162 @@
+// Packs the static timetable of the configured stops for the timetable partition, see main/tram_run/Timetable.hpp.
+//
+//     timetable_pack <timetable.csv> <stops> <output.bin> [partition size]
+//
+// Every line of the csv is "stop,line,days,trips": days is 7 characters from Monday, '-' when the line
+// does not run that day, and trips are space separated HH:MM, HH may go past 23 for the night trips:
+//
+//     1234,17,MTWTF--,05:12 05:24 05:36 24:10
+//
+// <stops> is CONFIG_TR_STOPS, the rows of the other stops are dropped.
+
+#include "tram_run/TimetableEncoder.hpp"
+
+#include <stdio.h>
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+namespace
+{
+    std::vector<std::string> split(const std::string& _text, char _separator)
+    {
+        std::vector<std::string> parts;
+        std::stringstream stream(_text);
+        std::string part;
+        while (std::getline(stream, part, _separator))
+        {
+            if (!part.empty())
+                parts.push_back(part);
+        }
+        return parts;
+    }
+
+    bool parseDays(const std::string& _text, uint8_t& _weekdays)
+    {
+        if (_text.size() != 7)
+            return false;
+
+        _weekdays = 0;
+        for (size_t day = 0; day < 7; ++day)
+        {
+            if (_text[day] != '-')
+                _weekdays |= 1u << ((day + 1) % 7);     // tm_wday counts from Sunday
+        }
+        return true;
+    }
+
+    bool parseTrips(const std::string& _text, std::vector<uint16_t>& _trips)
+    {
+        for (const std::string& trip : split(_text, ' '))
+        {
+            unsigned hours = 0;
+            unsigned minutes = 0;
+            char extra = 0;
+            if (sscanf(trip.c_str(), "%u:%u%c", &hours, &minutes, &extra) != 2 || minutes > 59)
+                return false;
+            _trips.push_back(hours * 60 + minutes);
+        }
+        return true;
+    }
+
+    bool verify(const std::vector<uint8_t>& _image, const std::vector<std::vector<uint16_t>>& _trips)
+    {
+        tr::timetable::Reader reader;
+        if (!reader.open(_image.data(), _image.size()) || reader.getServiceCount() != _trips.size())
+            return false;
+
+        for (uint16_t i = 0; i < reader.getServiceCount(); ++i)
+        {
+            const tr::timetable::Service service = reader.getService(i);
+            for (uint16_t trip : _trips[i])
+            {
+                uint16_t found = 0;
+                if (reader.findNext(service, trip, &found, 1) != 1 || found != trip)
+                    return false;
+            }
+        }
+        return true;
+    }
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc < 4)
+    {
+        std::cerr << "Usage: " << argv[0] << " <timetable.csv> <stops> <output.bin> [partition size]\n";
+        return 1;
+    }
+
+    std::ifstream input(argv[1]);
+    if (!input)
+    {
+        std::cerr << "Unable to open " << argv[1] << "\n";
+        return 1;
+    }
+
+    const std::vector<std::string> stops = split(argv[2], ',');
+    if (stops.size() > tr::departures::MaxSources)
+    {
+        std::cerr << "Too many stops, the maximum is " << int(tr::departures::MaxSources) << "\n";
+        return 1;
+    }
+
+    tr::timetable::Encoder encoder;
+    std::vector<std::vector<uint16_t>> services;
+    std::string line;
+    for (unsigned number = 1; std::getline(input, line); ++number)
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        const std::vector<std::string> fields = split(line, ',');
+        uint8_t weekdays = 0;
+        std::vector<uint16_t> trips;
+        if (fields.size() != 4 || !parseDays(fields[2], weekdays) || !parseTrips(fields[3], trips))
+        {
+            std::cerr << argv[1] << ":" << number << ": malformed line\n";
+            return 1;
+        }
+
+        size_t stop = 0;
+        while (stop < stops.size() && stops[stop] != fields[0])
+            ++stop;
+        if (stop == stops.size())
+            continue;
+
+        if (!encoder.addService(stop, weekdays, fields[1], trips))
+        {
+            std::cerr << argv[1] << ":" << number << ": unsorted trips, a trip past 47:59 or a line name over "
+                << tr::departures::MaxLineLength << " characters\n";
+            return 1;
+        }
+        services.push_back(std::move(trips));
+    }
+
+    const std::vector<uint8_t> image = encoder.build();
+    if (!verify(image, services))
+    {
+        std::cerr << "The packed timetable does not read back\n";
+        return 1;
+    }
+    if (argc > 4 && image.size() > std::stoul(argv[4], nullptr, 0))
+    {
+        std::cerr << "The timetable takes " << image.size() << " bytes, more than the partition\n";
+        return 1;
+    }
+
+    std::ofstream output(argv[3], std::ios::binary);
+    output.write(reinterpret_cast<const char*>(image.data()), image.size());
+    if (!output)
+    {
+        std::cerr << "Unable to write " << argv[3] << "\n";
+        return 1;
+    }
+
+    std::cout << "Timetable: " << services.size() << " services, " << image.size() << " bytes\n";
+    return 0;
+}
@@ -0,0 +1,228 @@
+// Reads random packed timetables back and compares every lookup with a brute force one over
+// the unpacked trips, then times the lookups on a timetable of a realistic size.
+//
+//     timetable_test [iterations]
+
+#include "tram_run/TimetableEncoder.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+
+namespace
+{
+    using namespace tr::timetable;
+
+    struct Unpacked
+    {
+        uint8_t stop;
+        uint8_t weekdays;
+        std::vector<uint16_t> trips;
+    };
+
+    unsigned g_failures = 0;
+
+    void check(bool _condition, const char* _what, unsigned _line)
+    {
+        if (_condition)
+            return;
+        if (g_failures++ < 20)
+            std::cerr << "timetable_test.cpp:" << _line << ": " << _what << "\n";
+    }
+
+#define CHECK(_condition) check(_condition, #_condition, __LINE__)
+
+    std::vector<uint16_t> randomTrips(std::mt19937& _random)
+    {
+        std::vector<uint16_t> trips;
+        uint16_t minute = _random() % 400;
+        const unsigned count = _random() % 120;
+        for (unsigned i = 0; i < count && minute <= MaxMinute; ++i)
+        {
+            trips.push_back(minute);
+            // Mostly short headways, some repeats and some gaps long enough for the escaped delta
+            const unsigned kind = _random() % 20;
+            minute += kind == 0 ? 0 : kind == 1 ? 255 + _random() % 600 : 1 + _random() % 30;
+        }
+        return trips;
+    }
+
+    std::vector<uint16_t> findNextReference(const std::vector<uint16_t>& _trips, uint16_t _minute, uint8_t _max)
+    {
+        std::vector<uint16_t> found;
+        for (uint16_t trip : _trips)
+        {
+            if (trip >= _minute && found.size() < _max)
+                found.push_back(trip);
+        }
+        return found;
+    }
+
+    std::vector<uint32_t> collectReference(const std::vector<Unpacked>& _services, uint8_t _stop, int _weekday,
+        uint16_t _minute, uint32_t _midnight, uint8_t _max)
+    {
+        std::vector<uint32_t> times;
+        for (int day = -1; day <= 1; ++day)
+        {
+            const int weekday = (_weekday + day + 7) % 7;
+            const int serviceMinute = int(_minute) - day * MinutesPerDay;
+            if (serviceMinute > MaxMinute)
+                continue;
+
+            for (const Unpacked& service : _services)
+            {
+                if (service.stop != _stop || !(service.weekdays & (1u << weekday)))
+                    continue;
+                for (uint16_t trip : service.trips)
+                {
+                    if (trip >= std::max(serviceMinute, 0))
+                        times.push_back(_midnight + (day * MinutesPerDay + trip) * 60);
+                }
+            }
+        }
+        std::sort(times.begin(), times.end());
+        if (times.size() > _max)
+            times.resize(_max);
+        return times;
+    }
+
+    std::vector<Unpacked> randomServices(std::mt19937& _random, Encoder& _encoder)
+    {
+        std::vector<Unpacked> services;
+        const unsigned count = 1 + _random() % 12;
+        for (unsigned i = 0; i < count; ++i)
+        {
+            Unpacked service{uint8_t(_random() % tr::departures::MaxSources), uint8_t(_random() % 128), randomTrips(_random)};
+            CHECK(_encoder.addService(service.stop, service.weekdays, std::to_string(_random() % 100), service.trips));
+            services.push_back(std::move(service));
+        }
+        return services;
+    }
+
+    void testAgainstReference(unsigned _iterations)
+    {
+        std::mt19937 random(2024);
+        constexpr uint32_t Midnight = 1700000000;
+
+        for (unsigned iteration = 0; iteration < _iterations; ++iteration)
+        {
+            Encoder encoder;
+            const std::vector<Unpacked> services = randomServices(random, encoder);
+            const std::vector<uint8_t> image = encoder.build();
+
+            Reader reader;
+            CHECK(reader.open(image.data(), image.size()));
+            CHECK(reader.getServiceCount() == services.size());
+
+            for (unsigned lookup = 0; lookup < 50; ++lookup)
+            {
+                const uint16_t index = random() % services.size();
+                const uint16_t minute = random() % (MaxMinute + 2);
+                const uint8_t max = 1 + random() % 8;
+
+                uint16_t trips[8];
+                const uint8_t found = reader.findNext(reader.getService(index), minute, trips, max);
+                CHECK(std::vector<uint16_t>(trips, trips + found) == findNextReference(services[index].trips, minute, max));
+
+                const uint8_t stop = random() % tr::departures::MaxSources;
+                const int weekday = random() % 7;
+                const uint16_t now = random() % MinutesPerDay;
+                tr::departures::Departure departures[tr::departures::MaxVisible];
+                const uint8_t collected = reader.collect(stop, weekday, now, Midnight, departures, tr::departures::MaxVisible);
+
+                std::vector<uint32_t> times;
+                for (uint8_t n = 0; n < collected; ++n)
+                {
+                    times.push_back(departures[n].time);
+                    CHECK(departures[n].source == stop);
+                }
+                CHECK(times == collectReference(services, stop, weekday, now, Midnight, tr::departures::MaxVisible));
+            }
+        }
+    }
+
+    void testBrokenImages()
+    {
+        Encoder encoder;
+        CHECK(encoder.addService(0, 0x7F, "17", {300, 310, 320}));
+        CHECK(!encoder.addService(0, 0x7F, "17", {310, 300}));
+        CHECK(!encoder.addService(0, 0x7F, "1234567", {300}));
+        CHECK(!encoder.addService(0, 0x7F, "17", {MaxMinute + 1}));
+        std::vector<uint8_t> image = encoder.build();
+
+        Reader reader;
+        CHECK(reader.open(image.data(), image.size()));
+        CHECK(!reader.open(image.data(), image.size() - 1));
+        CHECK(!reader.open(image.data(), HeaderSize - 1));
+
+        image[10]++;    // Checkpoint count of the first service
+        CHECK(!reader.open(image.data(), image.size()));
+        CHECK(!reader.isOpen());
+        image[10]--;
+
+        image[0] = 'X';
+        CHECK(!reader.open(image.data(), image.size()));
+    }
+
+    void benchmark()
+    {
+        using Clock = std::chrono::steady_clock;
+
+        // Four stops with ten lines each, a trip every 6 minutes from 5:00 to past midnight
+        Encoder encoder;
+        for (uint8_t stop = 0; stop < tr::departures::MaxSources; ++stop)
+        {
+            for (unsigned line = 0; line < 10; ++line)
+            {
+                std::vector<uint16_t> trips;
+                for (uint16_t minute = 5 * 60 + line; minute < 25 * 60; minute += 6)
+                    trips.push_back(minute);
+                encoder.addService(stop, line % 2 ? 0x3E : 0x7F, std::to_string(line + 1), trips);
+            }
+        }
+        const std::vector<uint8_t> image = encoder.build();
+        Reader reader;
+        reader.open(image.data(), image.size());
+
+        constexpr unsigned Lookups = 200000;
+        uint32_t sink = 0;
+
+        auto start = Clock::now();
+        for (unsigned i = 0; i < Lookups; ++i)
+        {
+            uint16_t trips[4];
+            const uint8_t found = reader.findNext(reader.getService(i % reader.getServiceCount()), i % MinutesPerDay, trips, 4);
+            sink += found > 0 ? trips[0] : 0;
+        }
+        const double findNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / Lookups;
+
+        start = Clock::now();
+        for (unsigned i = 0; i < Lookups / 10; ++i)
+        {
+            tr::departures::Departure departures[tr::departures::MaxVisible];
+            sink += reader.collect(i % tr::departures::MaxSources, i % 7, i % MinutesPerDay, 0, departures, tr::departures::MaxVisible);
+        }
+        const double collectNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / (Lookups / 10);
+
+        std::cout << "Image " << image.size() << " bytes, " << reader.getServiceCount() << " services: findNext "
+            << findNs << " ns, collect " << collectNs << " ns (" << sink % 10 << ")\n";
+    }
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const unsigned iterations = argc > 1 ? std::stoul(argv[1]) : 500;
+
+    testBrokenImages();
+    testAgainstReference(iterations);
+    benchmark();
+
+    if (g_failures > 0)
+    {
+        std::cerr << g_failures << " checks failed\n";
+        return 1;
+    }
+    return 0;
+}